@@ -4,6 +4,7 @@
 
 #include "bucket/Bucket.h"
 #include "bucket/BucketApplicator.h"
+#include "bucket/BucketIndex.h"
 #include "bucket/BucketManager.h"
 #include "bucket/BucketList.h"
 #include "bucket/LedgerCmp.h"
@@ -90,6 +91,7 @@ Bucket::~Bucket()
     {
         CLOG(TRACE, "Bucket") << "Bucket::~Bucket removing file: " << mFilename;
         std::remove(mFilename.c_str());
+        std::remove(BucketIndex::indexFilename(mFilename).c_str());
     }
 }
 
@@ -115,9 +117,21 @@ Bucket::setRetain(bool r)
     mRetain = r;
 }
 
+static LedgerKey
+bucketEntryKey(BucketEntry const& e)
+{
+    if (e.type() == BucketEntryType::LIVEENTRY)
+    {
+        return LedgerEntryKey(e.liveEntry());
+    }
+    return e.deadEntry();
+}
+
 /**
  * Helper class that reads from the file underlying a bucket, keeping the bucket
- * alive for the duration of its existence.
+ * alive for the duration of its existence. Alongside the current entry it
+ * keeps a view of that entry's raw record, which is what merging copies to the
+ * output. The file is memory-mapped, so the view costs no copy.
  */
 class Bucket::InputIterator
 {
@@ -126,13 +140,14 @@ class Bucket::InputIterator
     // Validity and current-value of the iterator is funneled into a pointer. If
     // non-null, it points to mEntry.
     BucketEntry const* mEntryPtr;
-    XDRInputFileStream mIn;
+    XDRMappedInputFileStream mIn;
     BucketEntry mEntry;
+    XDRRecordView mRecord;
 
     void
     loadEntry()
     {
-        if (mIn.readOne(mEntry))
+        if (mIn.readOne(mEntry, mRecord))
         {
             mEntryPtr = &mEntry;
         }
@@ -148,11 +163,18 @@ class Bucket::InputIterator
         return mEntryPtr != nullptr;
     }
 
-    BucketEntry const& operator*()
+    BucketEntry const& operator*() const
     {
         return *mEntryPtr;
     }
 
+    // Valid for as long as the iterator is.
+    XDRRecordView const&
+    record() const
+    {
+        return mRecord;
+    }
+
     InputIterator(std::shared_ptr<Bucket const> bucket)
         : mBucket(bucket), mEntryPtr(nullptr)
     {
@@ -188,25 +210,40 @@ class Bucket::InputIterator
 /**
  * Helper class that points to an output tempfile. Absorbs BucketEntries and
  * hashes them while writing to either destination. Produces a Bucket when done.
+ *
+ * Entries are buffered as their key and encoded record, so that entries coming
+ * from an InputIterator are written and hashed straight from the bytes that
+ * were read, without being encoded again or even copied: the buffered record
+ * is then a view into the iterator's file, so an iterator has to outlive the
+ * OutputIterator it's put into. If asked to, it also builds the
+ * bucket's point-lookup index from the keys as they go by.
  */
 class Bucket::OutputIterator
 {
     std::string mFilename;
     XDROutputFileStream mOut;
-    BucketEntryIdCmp mCmp;
-    std::unique_ptr<BucketEntry> mBuf;
+    LedgerEntryIdCmp mCmp;
+    bool mHaveBuf{false};
+    LedgerKey mBufKey;
+    XDRRecordView mBufRecord;
+    std::vector<char> mEncoded;
     std::unique_ptr<SHA256> mHasher;
     size_t mBytesPut{0};
     size_t mObjectsPut{0};
     bool mKeepDeadEntries{true};
+    std::unique_ptr<BucketIndex::Builder> mIndexBuilder;
 
   public:
-    OutputIterator(std::string const& tmpDir, bool keepDeadEntries)
+    OutputIterator(std::string const& tmpDir, bool keepDeadEntries,
+                   bool buildIndex = false)
         : mFilename(randomBucketName(tmpDir))
-        , mBuf(nullptr)
         , mHasher(SHA256::create())
         , mKeepDeadEntries(keepDeadEntries)
     {
+        if (buildIndex)
+        {
+            mIndexBuilder = make_unique<BucketIndex::Builder>();
+        }
         CLOG(TRACE, "Bucket")
             << "Bucket::OutputIterator opening file to write: " << mFilename;
         mOut.open(mFilename);
@@ -219,40 +256,39 @@ class Bucket::OutputIterator
         {
             return;
         }
+        auto key = bucketEntryKey(e);
+        flushIfAfterBuf(key);
+        mBufKey = std::move(key);
+        XDROutputFileStream::encodeRecord(e, mEncoded);
+        mBufRecord.data = mEncoded.data();
+        mBufRecord.size = mEncoded.size();
+        mHaveBuf = true;
+    }
 
-        // Check to see if there's an existing buffered entry.
-        if (mBuf)
-        {
-            // mCmp(e, *mBuf) means e < *mBuf; this should never be true since
-            // it would mean that we're getting entries out of order.
-            assert(!mCmp(e, *mBuf));
-
-            // Check to see if the new entry should flush (greater identity), or
-            // merely replace (same identity), the buffered entry.
-            if (mCmp(*mBuf, e))
-            {
-                mOut.writeOne(*mBuf, mHasher.get(), &mBytesPut);
-                mObjectsPut++;
-            }
-        }
-        else
+    void
+    put(Bucket::InputIterator const& in)
+    {
+        if (!mKeepDeadEntries && (*in).type() == BucketEntryType::DEADENTRY)
         {
-            mBuf = make_unique<BucketEntry>();
+            return;
         }
-
-        // In any case, replace *mBuf with e.
-        *mBuf = e;
+        // the key is only built for entries that make it to the output;
+        // entries are otherwise compared in place
+        auto key = bucketEntryKey(*in);
+        flushIfAfterBuf(key);
+        mBufKey = std::move(key);
+        mBufRecord = in.record();
+        mHaveBuf = true;
     }
 
     std::shared_ptr<Bucket>
     getBucket(BucketManager& bucketManager)
     {
         assert(mOut);
-        if (mBuf)
+        if (mHaveBuf)
         {
-            mOut.writeOne(*mBuf, mHasher.get(), &mBytesPut);
-            mObjectsPut++;
-            mBuf.reset();
+            writeBuf();
+            mHaveBuf = false;
         }
 
         mOut.close();
@@ -264,9 +300,45 @@ class Bucket::OutputIterator
             std::remove(mFilename.c_str());
             return std::make_shared<Bucket>();
         }
+        if (mIndexBuilder)
+        {
+            mIndexBuilder->finish()->save(BucketIndex::indexFilename(mFilename));
+        }
         return bucketManager.adoptFileAsBucket(mFilename, mHasher->finish(),
                                                mObjectsPut, mBytesPut);
     }
+
+  private:
+    void
+    writeBuf()
+    {
+        if (mIndexBuilder)
+        {
+            mIndexBuilder->add(mBufKey, mBytesPut);
+        }
+        mOut.writeRecord(mBufRecord, mHasher.get(), &mBytesPut);
+        mObjectsPut++;
+    }
+
+    // Writes out the buffered entry if `key` sorts after it; an entry with the
+    // same key merely replaces the buffered one.
+    void
+    flushIfAfterBuf(LedgerKey const& key)
+    {
+        if (!mHaveBuf)
+        {
+            return;
+        }
+
+        // mCmp(key, mBufKey) means key < mBufKey; this should never be true
+        // since it would mean that we're getting entries out of order.
+        assert(!mCmp(key, mBufKey));
+
+        if (mCmp(mBufKey, key))
+        {
+            writeBuf();
+        }
+    }
 };
 
 bool
@@ -285,6 +357,71 @@ Bucket::containsBucketIdentity(BucketEntry const& id) const
     return false;
 }
 
+std::shared_ptr<BucketIndex const>
+Bucket::getIndex() const
+{
+    if (mFilename.empty())
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mIndexMutex);
+    if (!mIndex)
+    {
+        auto indexFilename = BucketIndex::indexFilename(mFilename);
+        std::shared_ptr<BucketIndex const> index =
+            BucketIndex::load(indexFilename);
+        if (!index)
+        {
+            CLOG(DEBUG, "Bucket") << "Indexing bucket " << mFilename;
+            BucketIndex::Builder builder;
+            XDRMappedInputFileStream in;
+            in.open(mFilename);
+            BucketEntry entry;
+            for (size_t offset = in.pos(); in.readOne(entry);
+                 offset = in.pos())
+            {
+                builder.add(bucketEntryKey(entry), offset);
+            }
+            auto built = builder.finish();
+            built->save(indexFilename);
+            index = std::move(built);
+        }
+        mIndex = index;
+    }
+    return mIndex;
+}
+
+bool
+Bucket::getEntry(LedgerKey const& key, BucketEntry& out) const
+{
+    auto index = getIndex();
+    uint64_t offset;
+    if (!index || !index->findPage(key, offset))
+    {
+        return false;
+    }
+
+    LedgerEntryIdCmp cmp;
+    XDRInputFileStream in;
+    in.open(mFilename);
+    in.seek(static_cast<size_t>(offset));
+    for (size_t i = 0; i < BucketIndex::kPageSize && in.readOne(out); ++i)
+    {
+        auto entryKey = bucketEntryKey(out);
+        if (cmp(key, entryKey))
+        {
+            // Went past where key would be.
+            return false;
+        }
+        if (!cmp(entryKey, key))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 std::pair<size_t, size_t>
 Bucket::countLiveAndDeadEntries() const
 {
@@ -317,47 +454,38 @@ Bucket::apply(Database& db) const
 
 std::shared_ptr<Bucket>
 Bucket::fresh(BucketManager& bucketManager,
-              std::vector<LedgerEntry> const& liveEntries,
-              std::vector<LedgerKey> const& deadEntries)
+              std::vector<LedgerEntry> liveEntries,
+              std::vector<LedgerKey> deadEntries)
 {
-    std::vector<BucketEntry> live, dead, combined;
-    live.reserve(liveEntries.size());
-    dead.reserve(deadEntries.size());
+    // Written in a single sorted pass. Dead entries go after live ones and
+    // the sort is stable, so a key that is both live and dead ends up as a
+    // tombstone, just as it would merging a live bucket with a newer dead one.
+    std::vector<BucketEntry> entries(liveEntries.size() + deadEntries.size());
+    auto out = entries.begin();
 
-    for (auto const& e : liveEntries)
+    for (auto& e : liveEntries)
     {
-        BucketEntry ce;
-        ce.type(BucketEntryType::LIVEENTRY);
-        ce.liveEntry() = e;
-        live.push_back(ce);
+        out->type(BucketEntryType::LIVEENTRY);
+        out->liveEntry() = std::move(e);
+        ++out;
     }
 
-    for (auto const& e : deadEntries)
+    for (auto& e : deadEntries)
     {
-        BucketEntry ce;
-        ce.type(BucketEntryType::DEADENTRY);
-        ce.deadEntry() = e;
-        dead.push_back(ce);
+        out->type(BucketEntryType::DEADENTRY);
+        out->deadEntry() = std::move(e);
+        ++out;
     }
 
-    std::sort(live.begin(), live.end(), BucketEntryIdCmp());
-
-    std::sort(dead.begin(), dead.end(), BucketEntryIdCmp());
+    std::stable_sort(entries.begin(), entries.end(), BucketEntryIdCmp());
 
-    OutputIterator liveOut(bucketManager.getTmpDir(), true);
-    OutputIterator deadOut(bucketManager.getTmpDir(), true);
-    for (auto const& e : live)
-    {
-        liveOut.put(e);
-    }
-    for (auto const& e : dead)
+    OutputIterator bucketOut(bucketManager.getTmpDir(), true,
+                             bucketManager.isIndexingBuckets());
+    for (auto const& e : entries)
     {
-        deadOut.put(e);
+        bucketOut.put(e);
     }
-
-    auto liveBucket = liveOut.getBucket(bucketManager);
-    auto deadBucket = deadOut.getBucket(bucketManager);
-    return Bucket::merge(bucketManager, liveBucket, deadBucket);
+    return bucketOut.getBucket(bucketManager);
 }
 
 inline void
@@ -387,7 +515,7 @@ maybe_put(BucketEntryIdCmp const& cmp, Bucket::OutputIterator& out,
         }
     }
     // Nothing shadowed.
-    out.put(*in);
+    out.put(in);
 }
 
 std::shared_ptr<Bucket>
@@ -411,8 +539,11 @@ Bucket::merge(BucketManager& bucketManager,
                                                        shadows.end());
 
     auto timer = bucketManager.getMergeTimer().TimeScope();
-    Bucket::OutputIterator out(bucketManager.getTmpDir(), keepDeadEntries);
+    Bucket::OutputIterator out(bucketManager.getTmpDir(), keepDeadEntries,
+                               bucketManager.isIndexingBuckets());
 
+    // Entries are ordered by identity where they were decoded, and copied to
+    // the output as the records they were read as.
     BucketEntryIdCmp cmp;
     while (oi || ni)
     {
@@ -471,7 +602,7 @@ compareSizes(std::string const& objType, uint64_t inDatabase,
 void
 checkDBAgainstBuckets(medida::MetricsRegistry& metrics,
                       BucketManager& bucketManager, Database& db,
-                      BucketList& bl)
+                      BucketList& bl, asio::io_service* workers)
 {
     CLOG(INFO, "Bucket") << "CheckDB starting";
     auto execTimer =
@@ -500,19 +631,53 @@ checkDBAgainstBuckets(medida::MetricsRegistry& metrics,
         return;
     }
 
-    // Step 2: merge all buckets into a single super-bucket.
-    auto i = buckets.begin();
-    assert(i != buckets.end());
-    std::shared_ptr<Bucket> superBucket = *i;
-    while (++i != buckets.end())
+    // Step 2: merge all buckets into a single super-bucket. Buckets are
+    // ordered newest first, so merging adjacent pairs (the left one of each
+    // being the newer) gives the same result as folding them in one at a
+    // time; each round's merges run in parallel on the worker threads.
     {
         auto mergeTimer =
             metrics.NewTimer({"bucket", "checkdb", "merge"}).TimeScope();
-        assert(superBucket);
-        assert(*i);
-        superBucket = Bucket::merge(bucketManager, *i, superBucket);
-        assert(superBucket);
+        using task_t = std::packaged_task<std::shared_ptr<Bucket>()>;
+        while (buckets.size() > 1)
+        {
+            std::vector<std::future<std::shared_ptr<Bucket>>> merges;
+            for (size_t j = 0; j + 1 < buckets.size(); j += 2)
+            {
+                auto newer = buckets[j];
+                auto older = buckets[j + 1];
+                assert(newer);
+                assert(older);
+                auto task = std::make_shared<task_t>(
+                    [&bucketManager, newer, older]()
+                    {
+                        return Bucket::merge(bucketManager, older, newer);
+                    });
+                merges.emplace_back(task->get_future());
+                if (workers)
+                {
+                    workers->post(std::bind(&task_t::operator(), task));
+                }
+                else
+                {
+                    (*task)();
+                }
+            }
+
+            std::vector<std::shared_ptr<Bucket>> merged;
+            for (auto& m : merges)
+            {
+                merged.emplace_back(m.get());
+                assert(merged.back());
+            }
+            if (buckets.size() % 2 == 1)
+            {
+                merged.emplace_back(buckets.back());
+            }
+            buckets.swap(merged);
+        }
     }
+    std::shared_ptr<Bucket> superBucket = buckets.front();
 
     CLOG(INFO, "Bucket") << "CheckDB starting object comparison";
 
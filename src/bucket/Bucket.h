@@ -10,6 +10,7 @@
 #include "util/asio.h"
 #include "database/Database.h"
 #include "overlay/StellarXDR.h"
+#include <mutex>
 #include <string>
 #include "util/NonCopyable.h"
 
@@ -32,6 +33,7 @@ namespace stellar
  * merged in sorted order, and all elements are hashed while being added.
  */
 
+class BucketIndex;
 class BucketManager;
 class BucketList;
 class Database;
@@ -44,6 +46,11 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
     Hash const mHash;
     bool mRetain{false};
 
+    // The point-lookup index is loaded or built on first use. It is only a
+    // cache of what's in the file, so the bucket remains immutable.
+    mutable std::mutex mIndexMutex;
+    mutable std::shared_ptr<BucketIndex const> mIndex;
+
   public:
     // Helper class that reads through the entries in a bucket, used internally
     // during merging.
@@ -81,6 +88,16 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
     // BucketEntry exists in the bucket. For testing.
     bool containsBucketIdentity(BucketEntry const& id) const;
 
+    // Looks up the entry for `key`, using the bucket's index. Returns false
+    // if the bucket has no entry for `key`; otherwise sets `out` to the live
+    // or dead entry the bucket holds for it.
+    bool getEntry(LedgerKey const& key, BucketEntry& out) const;
+
+    // Returns the bucket's point-lookup index, loading it from next to the
+    // bucket file or, failing that, building it by scanning the bucket (and
+    // saving it for next time). Returns nullptr for the empty bucket.
+    std::shared_ptr<BucketIndex const> getIndex() const;
+
     // Return the count of live and dead BucketEntries in the bucket. For
     // testing.
     std::pair<size_t, size_t> countLiveAndDeadEntries() const;
@@ -93,11 +110,11 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
 
     // Create a fresh bucket from a given vector of live LedgerEntries and
     // dead LedgerEntryKeys. The bucket will be sorted, hashed, and adopted
-    // in the provided BucketManager.
+    // in the provided BucketManager. The entries are moved into the bucket,
+    // so pass rvalues where the caller doesn't need them any more.
     static std::shared_ptr<Bucket>
-    fresh(BucketManager& bucketManager,
-          std::vector<LedgerEntry> const& liveEntries,
-          std::vector<LedgerKey> const& deadEntries);
+    fresh(BucketManager& bucketManager, std::vector<LedgerEntry> liveEntries,
+          std::vector<LedgerKey> deadEntries);
 
     // Merge two buckets together, producing a fresh one. Entries in `oldBucket`
     // are overridden in the fresh bucket by keywise-equal entries in
@@ -112,8 +129,11 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
           bool keepDeadEntries = true);
 };
 
+// Merges the buckets of `bl` on the `workers` threads -- or on the calling
+// thread, if there are none -- and checks every entry of the result against
+// the database.
 void checkDBAgainstBuckets(medida::MetricsRegistry& metrics,
                            BucketManager& bucketManager, Database& db,
-                           BucketList& bl);
+                           BucketList& bl, asio::io_service* workers);
 
 }
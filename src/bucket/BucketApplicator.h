@@ -22,7 +22,7 @@ class BucketApplicator
 {
     Database& mDb;
     std::shared_ptr<const Bucket> mBucket;
-    XDRInputFileStream mIn;
+    XDRMappedInputFileStream mIn;
     size_t mSize{0};
 
   public:
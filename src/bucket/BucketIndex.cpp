@@ -0,0 +1,150 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/BucketIndex.h"
+#include "bucket/LedgerCmp.h"
+#include "util/Fs.h"
+#include "util/Logging.h"
+#include "util/XDRStream.h"
+#include "util/make_unique.h"
+#include "xdrpp/marshal.h"
+#include <algorithm>
+
+namespace stellar
+{
+
+size_t const BucketIndex::kPageSize;
+uint32_t const BucketIndex::kFormatVersion;
+
+std::string
+BucketIndex::indexFilename(std::string const& bucketFilename)
+{
+    return bucketFilename + ".index";
+}
+
+uint64_t
+BucketIndex::hashKey(LedgerKey const& key)
+{
+    // over the key's XDR, so that, like the persisted bloom filter, it
+    // doesn't change from run to run
+    auto bytes = xdr::xdr_to_opaque(key);
+    return BloomFilter::hash(bytes.data(), bytes.size());
+}
+
+void
+BucketIndex::Builder::add(LedgerKey const& key, uint64_t offset)
+{
+    if (mKeyHashes.size() % kPageSize == 0)
+    {
+        mPageOffsets.push_back(offset);
+        mPageKeys.push_back(key);
+    }
+    mKeyHashes.push_back(hashKey(key));
+}
+
+std::unique_ptr<BucketIndex>
+BucketIndex::Builder::finish()
+{
+    auto index = make_unique<BucketIndex>();
+    index->mPageOffsets = std::move(mPageOffsets);
+    index->mPageKeys = std::move(mPageKeys);
+
+    index->mBloom = BloomFilter(mKeyHashes.size());
+    for (auto keyHash : mKeyHashes)
+    {
+        index->mBloom.add(keyHash);
+    }
+    mKeyHashes.clear();
+    return index;
+}
+
+bool
+BucketIndex::findPage(LedgerKey const& key, uint64_t& offset) const
+{
+    if (!mBloom.mayContain(hashKey(key)))
+    {
+        return false;
+    }
+
+    // The page holding key is the last one whose first key is <= key.
+    auto it = std::upper_bound(mPageKeys.begin(), mPageKeys.end(), key,
+                               LedgerEntryIdCmp());
+    if (it == mPageKeys.begin())
+    {
+        return false;
+    }
+    offset = mPageOffsets[(it - mPageKeys.begin()) - 1];
+    return true;
+}
+
+void
+BucketIndex::save(std::string const& filename) const
+{
+    XDROutputFileStream out;
+    out.open(filename);
+    out.writeOne(kFormatVersion);
+    out.writeOne(static_cast<uint32_t>(mPageOffsets.size()));
+    for (size_t i = 0; i < mPageOffsets.size(); ++i)
+    {
+        out.writeOne(mPageOffsets[i]);
+        out.writeOne(mPageKeys[i]);
+    }
+    auto const& bits = mBloom.getBits();
+    xdr::opaque_vec<> bloom;
+    bloom.assign(bits.begin(), bits.end());
+    out.writeOne(bloom);
+    out.close();
+}
+
+std::unique_ptr<BucketIndex>
+BucketIndex::load(std::string const& filename)
+{
+    if (!fs::exists(filename))
+    {
+        return nullptr;
+    }
+
+    try
+    {
+        XDRInputFileStream in;
+        in.open(filename);
+
+        uint32_t version = 0;
+        uint32_t nPages = 0;
+        if (!in.readOne(version) || version != kFormatVersion ||
+            !in.readOne(nPages))
+        {
+            CLOG(WARNING, "Bucket") << "Ignoring unreadable bucket index "
+                                    << filename;
+            return nullptr;
+        }
+
+        auto index = make_unique<BucketIndex>();
+        index->mPageOffsets.resize(nPages);
+        index->mPageKeys.resize(nPages);
+        for (uint32_t i = 0; i < nPages; ++i)
+        {
+            if (!in.readOne(index->mPageOffsets[i]) ||
+                !in.readOne(index->mPageKeys[i]))
+            {
+                throw xdr::xdr_runtime_error("truncated bucket index");
+            }
+        }
+        xdr::opaque_vec<> bloom;
+        if (!in.readOne(bloom))
+        {
+            throw xdr::xdr_runtime_error("truncated bucket index");
+        }
+        index->mBloom =
+            BloomFilter(std::vector<uint8_t>(bloom.begin(), bloom.end()));
+        return index;
+    }
+    catch (std::exception& e)
+    {
+        CLOG(WARNING, "Bucket") << "Ignoring unreadable bucket index "
+                                << filename << ": " << e.what();
+        return nullptr;
+    }
+}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/StellarXDR.h"
+#include "util/BloomFilter.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace stellar
+{
+
+/**
+ * BucketIndex is a point-lookup index over the sorted entries of a single
+ * bucket file. It holds the key and file offset of the first entry of every
+ * kPageSize-entry page of the bucket, and a bloom filter over all of the
+ * bucket's keys, so that most lookups for keys the bucket doesn't hold never
+ * touch the bucket file at all.
+ *
+ * Like the bucket it describes, an index is immutable once built. It is
+ * persisted next to its bucket, as `indexFilename(bucketFilename)`.
+ */
+class BucketIndex
+{
+  public:
+    static size_t const kPageSize = 128;
+
+    // Builds an index from the keys of a bucket, fed in order along with the
+    // offset of each entry's record in the bucket file.
+    class Builder
+    {
+        std::vector<uint64_t> mPageOffsets;
+        std::vector<LedgerKey> mPageKeys;
+        std::vector<uint64_t> mKeyHashes;
+
+      public:
+        void add(LedgerKey const& key, uint64_t offset);
+        std::unique_ptr<BucketIndex> finish();
+    };
+
+    // If the bucket may contain `key`, sets `offset` to the offset of the
+    // page that would hold it and returns true. Returns false if the bucket
+    // definitely doesn't contain `key`.
+    bool findPage(LedgerKey const& key, uint64_t& offset) const;
+
+    size_t
+    getPageCount() const
+    {
+        return mPageOffsets.size();
+    }
+
+    // Writes the index to `filename`, replacing any existing file.
+    void save(std::string const& filename) const;
+
+    // Reads an index written by `save`. Returns nullptr if there is no such
+    // file or it can't be read.
+    static std::unique_ptr<BucketIndex> load(std::string const& filename);
+
+    static std::string indexFilename(std::string const& bucketFilename);
+
+  private:
+    static uint32_t const kFormatVersion = 1;
+
+    std::vector<uint64_t> mPageOffsets;
+    std::vector<LedgerKey> mPageKeys;
+    BloomFilter mBloom;
+
+    static uint64_t hashKey(LedgerKey const& key);
+};
+}
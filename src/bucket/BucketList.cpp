@@ -203,8 +203,8 @@ BucketList::getLevel(size_t i)
 
 void
 BucketList::addBatch(Application& app, uint32_t currLedger,
-                     std::vector<LedgerEntry> const& liveEntries,
-                     std::vector<LedgerKey> const& deadEntries)
+                     std::vector<LedgerEntry> liveEntries,
+                     std::vector<LedgerKey> deadEntries)
 {
     assert(currLedger > 0);
 
@@ -291,12 +291,36 @@ BucketList::addBatch(Application& app, uint32_t currLedger,
     }
 
     assert(shadows.size() == 0);
-    mLevels[0].prepare(app, currLedger, Bucket::fresh(app.getBucketManager(),
-                                                      liveEntries, deadEntries),
+    mLevels[0].prepare(app, currLedger,
+                       Bucket::fresh(app.getBucketManager(),
+                                     std::move(liveEntries),
+                                     std::move(deadEntries)),
                        shadows);
     mLevels[0].commit();
 }
 
+std::shared_ptr<LedgerEntry>
+BucketList::getLedgerEntry(LedgerKey const& key) const
+{
+    BucketEntry entry;
+    for (auto const& level : mLevels)
+    {
+        // Within a level curr is newer than snap.
+        for (auto const& b : {level.getCurr(), level.getSnap()})
+        {
+            if (b->getEntry(key, entry))
+            {
+                if (entry.type() == BucketEntryType::DEADENTRY)
+                {
+                    return nullptr;
+                }
+                return std::make_shared<LedgerEntry>(entry.liveEntry());
+            }
+        }
+    }
+    return nullptr;
+}
+
 void
 BucketList::restartMerges(Application& app, uint32_t currLedger)
 {
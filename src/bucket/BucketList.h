@@ -310,7 +310,12 @@ class BucketList
     // for any levels that should have spilled due to passing through
     // `currLedger`.
     void addBatch(Application& app, uint32_t currLedger,
-                  std::vector<LedgerEntry> const& liveEntries,
-                  std::vector<LedgerKey> const& deadEntries);
+                  std::vector<LedgerEntry> liveEntries,
+                  std::vector<LedgerKey> deadEntries);
+
+    // Looks up the current state of the entry for `key`, searching levels
+    // from newest to oldest using each bucket's point-lookup index. Returns
+    // nullptr if the bucket list holds no live entry for `key`.
+    std::shared_ptr<LedgerEntry> getLedgerEntry(LedgerKey const& key) const;
 };
 }
@@ -56,6 +56,10 @@ class BucketManager : NonMovableOrCopyable
 
     virtual medida::Timer& getMergeTimer() = 0;
 
+    // Whether buckets should have their point-lookup index built while they
+    // are written, rather than on the first lookup that needs it.
+    virtual bool isIndexingBuckets() const = 0;
+
     // Get a reference to a persistent bucket (in the BucketManager's bucket
     // directory), from the BucketManager's shared bucket-set.
     //
@@ -82,8 +86,8 @@ class BucketManager : NonMovableOrCopyable
 
     // Feed a new batch of entries to the bucket list.
     virtual void addBatch(Application& app, uint32_t currLedger,
-                          std::vector<LedgerEntry> const& liveEntries,
-                          std::vector<LedgerKey> const& deadEntries) = 0;
+                          std::vector<LedgerEntry> liveEntries,
+                          std::vector<LedgerKey> deadEntries) = 0;
 
     // Update the given LedgerHeader's bucketListHash to reflect the current
     // state of the bucket list.
@@ -6,6 +6,7 @@
 #include "overlay/StellarXDR.h"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "bucket/BucketIndex.h"
 #include "bucket/BucketList.h"
 #include "history/HistoryManager.h"
 #include "util/Fs.h"
@@ -144,6 +145,12 @@ BucketManagerImpl::getMergeTimer()
     return mBucketSnapMerge;
 }
 
+bool
+BucketManagerImpl::isIndexingBuckets() const
+{
+    return mApp.getConfig().INDEX_BUCKETS;
+}
+
 std::shared_ptr<Bucket>
 BucketManagerImpl::adoptFileAsBucket(std::string const& filename,
                                      uint256 const& hash, size_t nObjects,
@@ -157,6 +164,7 @@ BucketManagerImpl::adoptFileAsBucket(std::string const& filename,
         CLOG(DEBUG, "Bucket") << "Deleting bucket file " << filename
                               << " that is redundant with existing bucket";
         std::remove(filename.c_str());
+        std::remove(BucketIndex::indexFilename(filename).c_str());
     }
     else
     {
@@ -172,6 +180,18 @@ BucketManagerImpl::adoptFileAsBucket(std::string const& filename,
             throw std::runtime_error(err);
         }
 
+        // Bring along the bucket's index, if it was built while writing it.
+        auto indexFilename = BucketIndex::indexFilename(filename);
+        if (fs::exists(indexFilename) &&
+            rename(indexFilename.c_str(),
+                   BucketIndex::indexFilename(canonicalName).c_str()) != 0)
+        {
+            CLOG(WARNING, "Bucket") << "Failed to rename bucket index "
+                                    << indexFilename << ": "
+                                    << strerror(errno);
+            std::remove(indexFilename.c_str());
+        }
+
         b = std::make_shared<Bucket>(canonicalName, hash);
         {
             mSharedBuckets.insert(std::make_pair(hash, b));
@@ -278,11 +298,12 @@ BucketManagerImpl::forgetUnreferencedBuckets()
 
 void
 BucketManagerImpl::addBatch(Application& app, uint32_t currLedger,
-                            std::vector<LedgerEntry> const& liveEntries,
-                            std::vector<LedgerKey> const& deadEntries)
+                            std::vector<LedgerEntry> liveEntries,
+                            std::vector<LedgerKey> deadEntries)
 {
     auto timer = mBucketAddBatch.TimeScope();
-    mBucketList.addBatch(app, currLedger, liveEntries, deadEntries);
+    mBucketList.addBatch(app, currLedger, std::move(liveEntries),
+                         std::move(deadEntries));
 }
 
 // updates the given LedgerHeader to reflect the current state of the bucket
@@ -57,6 +57,7 @@ class BucketManagerImpl : public BucketManager
     std::string const& getBucketDir() override;
     BucketList& getBucketList() override;
     medida::Timer& getMergeTimer() override;
+    bool isIndexingBuckets() const override;
     std::shared_ptr<Bucket> adoptFileAsBucket(std::string const& filename,
                                               uint256 const& hash,
                                               size_t nObjects,
@@ -65,8 +66,8 @@ class BucketManagerImpl : public BucketManager
 
     void forgetUnreferencedBuckets() override;
     void addBatch(Application& app, uint32_t currLedger,
-                  std::vector<LedgerEntry> const& liveEntries,
-                  std::vector<LedgerKey> const& deadEntries) override;
+                  std::vector<LedgerEntry> liveEntries,
+                  std::vector<LedgerKey> deadEntries) override;
     void snapshotLedger(LedgerHeader& currentHeader) override;
 
     std::vector<std::string>
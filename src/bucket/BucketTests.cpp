@@ -20,6 +20,7 @@
 #include "ledger/AccountHelper.h"
 #include "util/Fs.h"
 #include "util/TmpDir.h"
+#include "util/XDRStream.h"
 #include "xdrpp/autocheck.h"
 #include "medida/metrics_registry.h"
 #include "test/test_marshaler.h"
@@ -214,6 +215,76 @@ TEST_CASE("bucket list", "[bucket]")
     }
 }
 
+TEST_CASE("bucket list point lookups", "[bucket][bucketindex]")
+{
+    using xdr::operator==;
+    VirtualClock clock;
+    Config cfg(getTestConfig());
+
+    SECTION("index built while writing buckets")
+    {
+        cfg.INDEX_BUCKETS = true;
+    }
+    SECTION("index built on first lookup")
+    {
+        cfg.INDEX_BUCKETS = false;
+    }
+
+    Application::pointer app = Application::create(clock, cfg);
+    BucketList bl;
+    std::map<LedgerKey, std::shared_ptr<LedgerEntry>, LedgerEntryIdCmp>
+        expected;
+
+    for (uint32_t i = 1; !app->getClock().getIOService().stopped() && i < 70;
+         ++i)
+    {
+        app->getClock().crank(false);
+        auto live = LedgerTestUtils::generateValidLedgerEntries(8);
+        std::vector<LedgerKey> dead;
+        for (auto const& e : live)
+        {
+            expected[LedgerEntryKey(e)] = std::make_shared<LedgerEntry>(e);
+        }
+        // kill off an entry from a few ledgers back
+        if (i > 4)
+        {
+            for (auto& kv : expected)
+            {
+                if (kv.second)
+                {
+                    dead.push_back(kv.first);
+                    kv.second.reset();
+                    break;
+                }
+            }
+        }
+        bl.addBatch(*app, i, live, dead);
+    }
+
+    for (auto const& kv : expected)
+    {
+        auto found = bl.getLedgerEntry(kv.first);
+        if (kv.second)
+        {
+            REQUIRE(found);
+            REQUIRE(*found == *kv.second);
+        }
+        else
+        {
+            REQUIRE(!found);
+        }
+    }
+
+    for (auto const& e : LedgerTestUtils::generateValidLedgerEntries(20))
+    {
+        auto key = LedgerEntryKey(e);
+        if (expected.find(key) == expected.end())
+        {
+            REQUIRE(!bl.getLedgerEntry(key));
+        }
+    }
+}
+
 TEST_CASE("bucket list shadowing", "[bucket]")
 {
     VirtualClock clock;
@@ -834,6 +905,16 @@ TEST_CASE("checkdb succeeding", "[bucket][checkdb]")
                            "comparison").count() >= 10);
     }
 
+    SECTION("checkdb without worker threads")
+    {
+        // merges run on the calling thread instead
+        auto& bm = app->getBucketManager();
+        checkDBAgainstBuckets(m, bm, app->getDatabase(), bm.getBucketList(),
+                              nullptr);
+        REQUIRE(m.NewMeter({"bucket", "checkdb", "object-compare"},
+                           "comparison").count() >= 10);
+    }
+
     SECTION("failing checkdb")
     {
         app->checkDB();
@@ -887,6 +968,114 @@ TEST_CASE("bucket apply", "[bucket]")
     REQUIRE(count == 4);
 }
 
+TEST_CASE("mapped XDR stream reads buckets as the buffered one does",
+          "[bucket][xdrstream]")
+{
+    using xdr::operator==;
+    VirtualClock clock;
+    Config cfg(getTestConfig());
+    Application::pointer app = Application::create(clock, cfg);
+    app->start();
+
+    std::vector<LedgerKey> noDead;
+    auto b = Bucket::fresh(app->getBucketManager(),
+                           LedgerTestUtils::generateValidLedgerEntries(50),
+                           noDead);
+
+    XDRInputFileStream in;
+    XDRMappedInputFileStream mapped;
+    in.open(b->getFilename());
+    mapped.open(b->getFilename());
+
+    BucketEntry e1, e2;
+    std::vector<char> r1;
+    XDRRecordView r2;
+    std::vector<size_t> offsets;
+    size_t n = 0;
+    while (true)
+    {
+        REQUIRE(in.pos() == mapped.pos());
+        offsets.push_back(mapped.pos());
+        bool more = in.readOne(e1, r1);
+        REQUIRE(mapped.readOne(e2, r2) == more);
+        if (!more)
+        {
+            break;
+        }
+        REQUIRE(e1 == e2);
+        REQUIRE(std::vector<char>(r2.data, r2.data + r2.size) == r1);
+        ++n;
+    }
+    REQUIRE(n == b->countLiveAndDeadEntries().first);
+    REQUIRE(!in);
+    REQUIRE(!mapped);
+
+    // seeking back to a record reads it again
+    mapped.seek(offsets[10]);
+    REQUIRE(mapped.readOne(e2));
+    in.close();
+    in.open(b->getFilename());
+    in.seek(offsets[10]);
+    REQUIRE(in.readOne(e1));
+    REQUIRE(e1 == e2);
+    mapped.close();
+
+    // a record cut short is malformed
+    std::string truncated = b->getFilename() + ".truncated";
+    {
+        std::ofstream out(truncated, std::ofstream::binary);
+        std::ifstream src(b->getFilename(), std::ifstream::binary);
+        std::vector<char> bytes(offsets[1] + 6);
+        src.read(bytes.data(), bytes.size());
+        out.write(bytes.data(), bytes.size());
+    }
+    mapped.open(truncated);
+    REQUIRE(mapped.readOne(e2));
+    REQUIRE_THROWS_AS(mapped.readOne(e2), xdr::xdr_runtime_error);
+    mapped.close();
+    std::remove(truncated.c_str());
+
+    // records without the continuation bit are viewed as writeOne would have
+    // written them, and each view stays valid while reading on
+    std::string unmarked = b->getFilename() + ".unmarked";
+    {
+        std::ofstream out(unmarked, std::ofstream::binary);
+        std::ifstream src(b->getFilename(), std::ifstream::binary);
+        std::vector<char> bytes(offsets.back());
+        src.read(bytes.data(), bytes.size());
+        for (size_t i = 0; i + 1 < offsets.size(); ++i)
+        {
+            bytes[offsets[i]] &= '\x7f';
+        }
+        out.write(bytes.data(), bytes.size());
+    }
+    in.close();
+    in.open(b->getFilename());
+    mapped.open(unmarked);
+    std::vector<std::vector<char>> expected;
+    std::vector<XDRRecordView> views;
+    while (in.readOne(e1, r1))
+    {
+        REQUIRE(mapped.readOne(e2, r2));
+        REQUIRE(e1 == e2);
+        expected.push_back(r1);
+        views.push_back(r2);
+    }
+    REQUIRE(!mapped.readOne(e2));
+    for (size_t i = 0; i < views.size(); ++i)
+    {
+        REQUIRE(std::vector<char>(views[i].data,
+                                  views[i].data + views[i].size) ==
+                expected[i]);
+    }
+    mapped.seek(offsets[10]);
+    REQUIRE(mapped.readOne(e2, r2));
+    REQUIRE(r2.data == views[10].data);
+    mapped.close();
+    in.close();
+    std::remove(unmarked.c_str());
+}
+
 #ifdef USE_POSTGRES
 TEST_CASE("bucket apply bench", "[bucketbench][hide]")
 {
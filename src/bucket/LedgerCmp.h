@@ -51,11 +51,11 @@ struct LedgerEntryIdCmp
         {
             auto const& af = a.feeState();
             auto const& bf = b.feeState();
-            auto hashAStr = binToHex(af.hash);
-            auto hashBStr = binToHex(bf.hash);
-			if (hashAStr < hashBStr)
+            // Byte-wise comparison orders hashes exactly as comparing their
+            // hex encodings would, without allocating.
+			if (af.hash < bf.hash)
 				return true;
-			if (hashBStr < hashAStr)
+			if (bf.hash < af.hash)
 				return false;
 			if (af.lowerBound < bf.lowerBound)
 				return true;
@@ -6,10 +6,13 @@
 #include "crypto/Hex.h"
 #include "crypto/SHA.h"
 #include "crypto/Random.h"
+#include "crypto/SecretKey.h"
 #include "crypto/StrKey.h"
 #include "util/basen.h"
+#include <atomic>
 #include <autocheck/autocheck.hpp>
 #include <regex>
+#include <thread>
 #include "test/test_marshaler.h"
 
 using namespace stellar;
@@ -150,6 +153,77 @@ TEST_CASE("sign tests", "[crypto]")
     CHECK(!PubKeyUtils::verifySig(pk, sig, msg));
 }
 
+TEST_CASE("verify sig cache from several threads", "[crypto]")
+{
+    size_t const nThreads = 4;
+    size_t const nSigs = 64;
+    struct Signed
+    {
+        PublicKey pub;
+        std::vector<uint8_t> msg;
+        Signature sig;
+        Signature badSig;
+    };
+    std::vector<std::vector<Signed>> sigs(nThreads);
+    for (auto& threadSigs : sigs)
+    {
+        for (size_t i = 0; i < nSigs; ++i)
+        {
+            auto key = SecretKey::random();
+            Signed s;
+            s.pub = key.getPublicKey();
+            s.msg = randomBytes(64);
+            s.sig = key.sign(s.msg);
+            s.badSig = s.sig;
+            s.badSig[4] ^= 1;
+            threadSigs.emplace_back(s);
+        }
+    }
+
+    PubKeyUtils::clearVerifySigCache();
+    uint64_t hits, misses, ignores;
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses, ignores);
+
+    // each thread verifies its own signatures, good and bad, twice over
+    std::atomic<size_t> wrong{0};
+    std::vector<std::thread> threads;
+    for (auto const& threadSigs : sigs)
+    {
+        threads.emplace_back([&threadSigs, &wrong]() {
+            for (int round = 0; round < 2; ++round)
+            {
+                for (auto const& s : threadSigs)
+                {
+                    if (!PubKeyUtils::verifySig(s.pub, s.sig, s.msg) ||
+                        PubKeyUtils::verifySig(s.pub, s.badSig, s.msg))
+                    {
+                        ++wrong;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    REQUIRE(wrong == 0);
+
+    // and every result was cached under its own key
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses, ignores);
+    for (auto const& threadSigs : sigs)
+    {
+        for (auto const& s : threadSigs)
+        {
+            REQUIRE(PubKeyUtils::verifySig(s.pub, s.sig, s.msg));
+            REQUIRE(!PubKeyUtils::verifySig(s.pub, s.badSig, s.msg));
+        }
+    }
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses, ignores);
+    REQUIRE(misses == 0);
+    REQUIRE(hits == 2 * nThreads * nSigs);
+}
+
 struct SignVerifyTestcase
 {
     SecretKey key;
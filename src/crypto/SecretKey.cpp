@@ -27,7 +27,6 @@ namespace stellar
 
 static std::mutex gVerifySigCacheMutex;
 static cache::lru_cache<Hash, bool> gVerifySigCache(0xffff);
-static std::unique_ptr<SHA256> gHasher = SHA256::create();
 static uint64_t gVerifyCacheHit = 0;
 static uint64_t gVerifyCacheMiss = 0;
 static uint64_t gVerifyCacheIgnore = 0;
@@ -43,11 +42,12 @@ static Hash
 verifySigCacheKey(PublicKey const& key, Signature const& signature,
                   ByteSlice const& bin)
 {
-    gHasher->reset();
-    gHasher->add(key.ed25519());
-    gHasher->add(signature);
-    gHasher->add(bin);
-    return gHasher->finish();
+    // verifySig is called from worker threads too, so no shared hasher
+    auto hasher = SHA256::create();
+    hasher->add(key.ed25519());
+    hasher->add(signature);
+    hasher->add(bin);
+    return hasher->finish();
 }
 
 SecretKey::SecretKey() : mKeyType(CryptoKeyType::KEY_TYPE_ED25519)
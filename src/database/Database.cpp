@@ -24,10 +24,16 @@
 #include "ledger/ReferenceFrame.h"
 #include "ledger/StatisticsFrame.h"
 #include "ledger/AssetPairFrame.h"
+#include "ledger/AssetPairGraph.h"
 #include "ledger/TrustFrame.h"
 #include "ledger/OfferFrame.h"
+#include "ledger/OrderBookCache.h"
+#include "ledger/SaleSchedule.h"
 #include "ledger/InvoiceFrame.h"
 #include "ledger/ReviewableRequestFrame.h"
+#include "ledger/ReviewableRequestHelper.h"
+#include "ledger/ReviewableRequestIndex.h"
+#include "ledger/ReferenceIndex.h"
 #include "ledger/ExternalSystemAccountID.h"
 #include "overlay/OverlayManager.h"
 #include "overlay/BanManager.h"
@@ -42,6 +48,9 @@
 #include "medida/timer.h"
 #include "medida/counter.h"
 
+#include <cassert>
+#include <cctype>
+#include <cstdlib>
 #include <stdexcept>
 #include <vector>
 #include <sstream>
@@ -50,6 +59,7 @@
 extern "C" void register_factory_sqlite3();
 
 #ifdef USE_POSTGRES
+#include "soci-postgresql.h"
 extern "C" void register_factory_postgresql();
 #endif
 
@@ -68,9 +78,12 @@ enum databaseSchemaVersion : unsigned long {
 	DROP_SCP = 2,
 	INITIAL = 3,
 	DROP_BAN = 4,
+	BINARY_TX_HISTORY = 5,
+	REVIEWABLE_REQUEST_INDEXES = 6,
 };
 
-static unsigned long const SCHEMA_VERSION = databaseSchemaVersion::DROP_BAN;
+static unsigned long const SCHEMA_VERSION =
+    databaseSchemaVersion::REVIEWABLE_REQUEST_INDEXES;
 
 static void
 setSerializable(soci::session& sess)
@@ -96,9 +109,18 @@ Database::Database(Application& app)
     : mApp(app)
     , mQueryMeter(
           app.getMetrics().NewMeter({"database", "query", "exec"}, "query"))
+    , mEntryCacheHitMeter(app.getMetrics().NewMeter(
+          {"database", "entry-cache", "hit"}, "lookup"))
+    , mEntryCacheMissMeter(app.getMetrics().NewMeter(
+          {"database", "entry-cache", "miss"}, "lookup"))
     , mStatementsSize(
           app.getMetrics().NewCounter({"database", "memory", "statements"}))
     , mEntryCache(4096)
+    , mOrderBookCache(make_unique<OrderBookCache>(256))
+    , mAssetPairGraph(make_unique<AssetPairGraph>())
+    , mSaleSchedule(make_unique<SaleSchedule>())
+    , mReviewableRequestIndex(make_unique<ReviewableRequestIndex>())
+    , mReferenceIndex(make_unique<ReferenceIndex>())
     , mExcludedQueryTime(0)
     , mExcludedTotalTime(0)
     , mLastIdleQueryTime(0)
@@ -120,6 +142,10 @@ Database::Database(Application& app)
     }
 }
 
+Database::~Database()
+{
+}
+
 void
 Database::applySchemaUpgrade(unsigned long vers)
 {
@@ -135,6 +161,12 @@ Database::applySchemaUpgrade(unsigned long vers)
 	case databaseSchemaVersion::DROP_BAN:
         BanManager::dropAll(*this);
         break;
+	case databaseSchemaVersion::BINARY_TX_HISTORY:
+        TransactionFrame::upgradeToBinaryHistory(*this);
+        break;
+	case databaseSchemaVersion::REVIEWABLE_REQUEST_INDEXES:
+        ReviewableRequestHelper::Instance()->addRequestTypeAndIndexes(*this);
+        break;
     default:
         throw std::runtime_error("Unknown DB schema version");
         break;
@@ -337,6 +369,465 @@ Database::getEntryCache()
     return mEntryCache;
 }
 
+OrderBookCache&
+Database::getOrderBookCache()
+{
+    return *mOrderBookCache;
+}
+
+AssetPairGraph&
+Database::getAssetPairGraph()
+{
+    return *mAssetPairGraph;
+}
+
+SaleSchedule&
+Database::getSaleSchedule()
+{
+    return *mSaleSchedule;
+}
+
+ReviewableRequestIndex&
+Database::getReviewableRequestIndex()
+{
+    return *mReviewableRequestIndex;
+}
+
+ReferenceIndex&
+Database::getReferenceIndex()
+{
+    return *mReferenceIndex;
+}
+
+class BinaryStatement::Impl
+{
+  protected:
+    enum class Type
+    {
+        TEXT,
+        UINT,
+        INT,
+        BINARY
+    };
+    struct Value
+    {
+        Type mType;
+        void* mValue;
+    };
+    std::vector<Value> mParams;
+    std::vector<Value> mColumns;
+
+  public:
+    virtual ~Impl()
+    {
+    }
+
+    void
+    use(Type type, void const* value)
+    {
+        mParams.push_back(Value{type, const_cast<void*>(value)});
+    }
+
+    void
+    into(Type type, void* value)
+    {
+        mColumns.push_back(Value{type, value});
+    }
+
+    virtual void execute() = 0;
+    virtual bool gotData() const = 0;
+    virtual void fetch() = 0;
+    virtual long long getAffectedRows() const = 0;
+
+    friend class BinaryStatement;
+};
+
+namespace
+{
+class SqliteBinaryStatement : public BinaryStatement::Impl
+{
+    soci::session& mSess;
+    // the blobs standing in for binary params and columns, by position
+    std::vector<std::unique_ptr<soci::blob>> mBlobs;
+    std::unique_ptr<StatementContext> mPrep;
+    bool mBound{false};
+
+    void
+    bind()
+    {
+        auto& st = mPrep->statement();
+        mBlobs.resize(mParams.size() + mColumns.size());
+        for (size_t i = 0; i < mParams.size(); ++i)
+        {
+            auto const& p = mParams[i];
+            switch (p.mType)
+            {
+            case Type::TEXT:
+                st.exchange(soci::use(*static_cast<std::string*>(p.mValue)));
+                break;
+            case Type::UINT:
+                st.exchange(soci::use(*static_cast<uint32_t*>(p.mValue)));
+                break;
+            case Type::INT:
+                st.exchange(soci::use(*static_cast<int*>(p.mValue)));
+                break;
+            case Type::BINARY:
+                mBlobs[i] = make_unique<soci::blob>(mSess);
+                st.exchange(soci::use(*mBlobs[i]));
+                break;
+            }
+        }
+        for (size_t i = 0; i < mColumns.size(); ++i)
+        {
+            auto const& c = mColumns[i];
+            if (c.mType == Type::BINARY)
+            {
+                auto& blob = mBlobs[mParams.size() + i];
+                blob = make_unique<soci::blob>(mSess);
+                st.exchange(soci::into(*blob));
+            }
+            else
+            {
+                assert(c.mType == Type::UINT);
+                st.exchange(soci::into(*static_cast<uint32_t*>(c.mValue)));
+            }
+        }
+        st.define_and_bind();
+        mBound = true;
+    }
+
+    void
+    getColumns()
+    {
+        for (size_t i = 0; i < mColumns.size(); ++i)
+        {
+            if (mColumns[i].mType != Type::BINARY)
+            {
+                continue;
+            }
+            auto& blob = *mBlobs[mParams.size() + i];
+            auto& bytes = *static_cast<std::vector<uint8_t>*>(mColumns[i].mValue);
+            bytes.resize(blob.get_len());
+            if (!bytes.empty())
+            {
+                blob.read(0, reinterpret_cast<char*>(bytes.data()),
+                          bytes.size());
+            }
+        }
+    }
+
+  public:
+    SqliteBinaryStatement(Database& db, soci::session& sess,
+                          std::string const& sql)
+        : mSess(sess)
+    {
+        if (&sess == &db.getSession())
+        {
+            mPrep = make_unique<StatementContext>(db.getPreparedStatement(sql));
+        }
+        else
+        {
+            auto st = std::make_shared<soci::statement>(sess);
+            st->alloc();
+            st->prepare(sql);
+            mPrep = make_unique<StatementContext>(st);
+        }
+    }
+
+    void
+    execute() override
+    {
+        if (!mBound)
+        {
+            bind();
+        }
+        for (size_t i = 0; i < mParams.size(); ++i)
+        {
+            if (mParams[i].mType != Type::BINARY)
+            {
+                continue;
+            }
+            auto const& bytes =
+                *static_cast<std::vector<uint8_t>*>(mParams[i].mValue);
+            mBlobs[i]->trim(0);
+            if (!bytes.empty())
+            {
+                mBlobs[i]->append(reinterpret_cast<char const*>(bytes.data()),
+                                  bytes.size());
+            }
+        }
+        mPrep->statement().execute(true);
+        if (gotData())
+        {
+            getColumns();
+        }
+    }
+
+    bool
+    gotData() const override
+    {
+        return mPrep->statement().got_data();
+    }
+
+    void
+    fetch() override
+    {
+        if (mPrep->statement().fetch())
+        {
+            getColumns();
+        }
+    }
+
+    long long
+    getAffectedRows() const override
+    {
+        return mPrep->statement().get_affected_rows();
+    }
+};
+
+#ifdef USE_POSTGRES
+class PostgresBinaryStatement : public BinaryStatement::Impl
+{
+    struct ResultDeleter
+    {
+        void
+        operator()(PGresult* res) const
+        {
+            PQclear(res);
+        }
+    };
+
+    PGconn* mConn;
+    std::string mSql;
+    std::unique_ptr<PGresult, ResultDeleter> mResult;
+    int mRow{0};
+
+    // libpq numbers its placeholders: ":name" -> "$1", "$2", ...
+    static std::string
+    numberPlaceholders(std::string const& sql)
+    {
+        auto isNameChar = [](char c) {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+        };
+        std::string res;
+        int n = 0;
+        for (size_t i = 0; i < sql.size(); ++i)
+        {
+            if (sql[i] == ':' && i + 1 < sql.size() && isNameChar(sql[i + 1]) &&
+                (i == 0 || sql[i - 1] != ':'))
+            {
+                res += "$" + std::to_string(++n);
+                while (i + 1 < sql.size() && isNameChar(sql[i + 1]))
+                {
+                    ++i;
+                }
+            }
+            else
+            {
+                res += sql[i];
+            }
+        }
+        return res;
+    }
+
+    void
+    getColumns()
+    {
+        for (size_t i = 0; i < mColumns.size(); ++i)
+        {
+            int col = static_cast<int>(i);
+            if (PQgetisnull(mResult.get(), mRow, col))
+            {
+                throw soci::soci_error("Null value fetched");
+            }
+            auto data = reinterpret_cast<uint8_t const*>(
+                PQgetvalue(mResult.get(), mRow, col));
+            auto len = PQgetlength(mResult.get(), mRow, col);
+            if (mColumns[i].mType == Type::BINARY)
+            {
+                static_cast<std::vector<uint8_t>*>(mColumns[i].mValue)
+                    ->assign(data, data + len);
+                continue;
+            }
+            // binary INT: 4 bytes, network order
+            assert(mColumns[i].mType == Type::UINT);
+            if (len != 4)
+            {
+                throw soci::soci_error("Unexpected integer column size");
+            }
+            *static_cast<uint32_t*>(mColumns[i].mValue) =
+                (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) |
+                (uint32_t(data[2]) << 8) | uint32_t(data[3]);
+        }
+    }
+
+  public:
+    PostgresBinaryStatement(soci::session& sess, std::string const& sql)
+        : mConn(static_cast<soci::postgresql_session_backend*>(
+                    sess.get_backend())
+                    ->conn_)
+        , mSql(numberPlaceholders(sql))
+    {
+    }
+
+    void
+    execute() override
+    {
+        std::vector<std::string> text(mParams.size());
+        std::vector<char const*> values(mParams.size());
+        std::vector<int> lengths(mParams.size(), 0);
+        std::vector<int> formats(mParams.size(), 0);
+        for (size_t i = 0; i < mParams.size(); ++i)
+        {
+            auto const& p = mParams[i];
+            switch (p.mType)
+            {
+            case Type::TEXT:
+                values[i] = static_cast<std::string*>(p.mValue)->c_str();
+                break;
+            case Type::UINT:
+                text[i] = std::to_string(*static_cast<uint32_t*>(p.mValue));
+                values[i] = text[i].c_str();
+                break;
+            case Type::INT:
+                text[i] = std::to_string(*static_cast<int*>(p.mValue));
+                values[i] = text[i].c_str();
+                break;
+            case Type::BINARY:
+            {
+                auto const& bytes =
+                    *static_cast<std::vector<uint8_t>*>(p.mValue);
+                // libpq takes a null pointer for NULL, so never pass one
+                values[i] = bytes.empty()
+                                ? ""
+                                : reinterpret_cast<char const*>(bytes.data());
+                lengths[i] = static_cast<int>(bytes.size());
+                formats[i] = 1;
+                break;
+            }
+            }
+        }
+
+        mResult.reset(PQexecParams(mConn, mSql.c_str(),
+                                   static_cast<int>(mParams.size()), nullptr,
+                                   values.data(), lengths.data(),
+                                   formats.data(), 1));
+        auto status = PQresultStatus(mResult.get());
+        if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK)
+        {
+            throw soci::soci_error(
+                mResult ? PQresultErrorMessage(mResult.get())
+                        : PQerrorMessage(mConn));
+        }
+        mRow = 0;
+        if (gotData())
+        {
+            getColumns();
+        }
+    }
+
+    bool
+    gotData() const override
+    {
+        return mRow < PQntuples(mResult.get());
+    }
+
+    void
+    fetch() override
+    {
+        ++mRow;
+        if (gotData())
+        {
+            getColumns();
+        }
+    }
+
+    long long
+    getAffectedRows() const override
+    {
+        return std::strtoll(PQcmdTuples(mResult.get()), nullptr, 10);
+    }
+};
+#endif
+}
+
+BinaryStatement::BinaryStatement(Database& db, soci::session& sess,
+                                 std::string const& sql)
+{
+#ifdef USE_POSTGRES
+    if (!db.isSqlite())
+    {
+        mImpl = make_unique<PostgresBinaryStatement>(sess, sql);
+        return;
+    }
+#endif
+    mImpl = make_unique<SqliteBinaryStatement>(db, sess, sql);
+}
+
+BinaryStatement::~BinaryStatement()
+{
+}
+
+void
+BinaryStatement::use(std::string const& value)
+{
+    mImpl->use(Impl::Type::TEXT, &value);
+}
+
+void
+BinaryStatement::use(uint32_t const& value)
+{
+    mImpl->use(Impl::Type::UINT, &value);
+}
+
+void
+BinaryStatement::use(int const& value)
+{
+    mImpl->use(Impl::Type::INT, &value);
+}
+
+void
+BinaryStatement::useBinary(std::vector<uint8_t> const& value)
+{
+    mImpl->use(Impl::Type::BINARY, &value);
+}
+
+void
+BinaryStatement::into(uint32_t& value)
+{
+    mImpl->into(Impl::Type::UINT, &value);
+}
+
+void
+BinaryStatement::intoBinary(std::vector<uint8_t>& value)
+{
+    mImpl->into(Impl::Type::BINARY, &value);
+}
+
+void
+BinaryStatement::execute()
+{
+    mImpl->execute();
+}
+
+bool
+BinaryStatement::gotData() const
+{
+    return mImpl->gotData();
+}
+
+void
+BinaryStatement::fetch()
+{
+    mImpl->fetch();
+}
+
+long long
+BinaryStatement::getAffectedRows() const
+{
+    return mImpl->getAffectedRows();
+}
+
 class SQLLogContext : NonCopyable
 {
     std::string mName;
@@ -406,6 +897,18 @@ Database::getQueryMeter()
     return mQueryMeter;
 }
 
+medida::Meter&
+Database::getEntryCacheHitMeter()
+{
+    return mEntryCacheHitMeter;
+}
+
+medida::Meter&
+Database::getEntryCacheMissMeter()
+{
+    return mEntryCacheMissMeter;
+}
+
 std::chrono::nanoseconds
 Database::totalQueryTime() const
 {
@@ -4,8 +4,10 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include <memory>
 #include <string>
 #include <set>
+#include <vector>
 #include <soci.h>
 #include "overlay/StellarXDR.h"
 #include "medida/timer_context.h"
@@ -24,6 +26,11 @@ class Counter;
 namespace stellar
 {
 class Application;
+class AssetPairGraph;
+class OrderBookCache;
+class ReferenceIndex;
+class ReviewableRequestIndex;
+class SaleSchedule;
 class SQLLogContext;
 
 /**
@@ -87,6 +94,8 @@ class Database : NonMovableOrCopyable
 {
     Application& mApp;
     medida::Meter& mQueryMeter;
+    medida::Meter& mEntryCacheHitMeter;
+    medida::Meter& mEntryCacheMissMeter;
     soci::session mSession;
     std::unique_ptr<soci::connection_pool> mPool;
 
@@ -95,6 +104,11 @@ class Database : NonMovableOrCopyable
 
     cache::lru_cache<std::string, std::shared_ptr<LedgerEntry const>>
         mEntryCache;
+    std::unique_ptr<OrderBookCache> mOrderBookCache;
+    std::unique_ptr<AssetPairGraph> mAssetPairGraph;
+    std::unique_ptr<SaleSchedule> mSaleSchedule;
+    std::unique_ptr<ReviewableRequestIndex> mReviewableRequestIndex;
+    std::unique_ptr<ReferenceIndex> mReferenceIndex;
 
     // Helpers for maintaining the total query time and calculating
     // idle percentage.
@@ -112,11 +126,17 @@ class Database : NonMovableOrCopyable
     // Instantiate object and connect to app.getConfig().DATABASE;
     // if there is a connection error, this will throw.
     Database(Application& app);
+    ~Database();
 
     // Return a crude meter of total queries to the db, for use in
     // overlay/LoadManager.
     medida::Meter& getQueryMeter();
 
+    // Meters of the lookups in the entry cache that found an entry (or its
+    // absence) cached, and of those that didn't.
+    medida::Meter& getEntryCacheHitMeter();
+    medida::Meter& getEntryCacheMissMeter();
+
     // Number of nanoseconds spent processing queries since app startup,
     // without any reference to excluded time or running counters.
     // Strictly a sum of measured time.
@@ -196,6 +216,67 @@ class Database : NonMovableOrCopyable
     typedef cache::lru_cache<std::string, std::shared_ptr<LedgerEntry const>>
         EntryCache;
     EntryCache& getEntryCache();
+
+    // Access the resident order books. As with the entry cache, it's kept
+    // here only for ease of access; OfferHelper keeps it up to date.
+    OrderBookCache& getOrderBookCache();
+
+    // Access the resident asset pairs and stats asset, kept up to date by
+    // AssetPairHelper and AssetHelper.
+    AssetPairGraph& getAssetPairGraph();
+
+    // Access the resident open sales, kept up to date by SaleHelper.
+    SaleSchedule& getSaleSchedule();
+
+    // Access the resident references of the reviewable requests, kept up to
+    // date by ReviewableRequestHelper.
+    ReviewableRequestIndex& getReviewableRequestIndex();
+
+    // Access the resident index of the payment references, kept up to date
+    // by ReferenceHelper.
+    ReferenceIndex& getReferenceIndex();
+};
+
+/**
+ * A statement exchanging binary columns (BLOB on SQLite, BYTEA on Postgresql)
+ * as raw bytes, in place of base64 text. On SQLite it's a SOCI statement
+ * binding blobs. SOCI only speaks Postgresql's text protocol, over which BYTEA
+ * travels hex-encoded at twice its size, so on Postgresql the statement runs
+ * through libpq instead, with binary parameters and results.
+ *
+ * Bind values, as with soci::use() and soci::into(), in the order of the
+ * query's ":name" placeholders and columns; they must outlive the statement,
+ * and parameters are read anew on every execution.
+ */
+class BinaryStatement : NonMovableOrCopyable
+{
+  public:
+    class Impl;
+
+  private:
+    std::unique_ptr<Impl> mImpl;
+
+  public:
+    BinaryStatement(Database& db, soci::session& sess, std::string const& sql);
+    ~BinaryStatement();
+
+    void use(std::string const& value);
+    void use(uint32_t const& value);
+    void use(int const& value);
+    void useBinary(std::vector<uint8_t> const& value);
+
+    void into(uint32_t& value);
+    void intoBinary(std::vector<uint8_t>& value);
+
+    // Runs the statement, in one round-trip; a query's first row, if any, is
+    // then in the values bound with into(). Like any other statement it's
+    // counted in the query meter by timing it with one of the Database
+    // get*Timer()s.
+    void execute();
+    bool gotData() const;
+    // Moves on to the next row of a query.
+    void fetch();
+    long long getAffectedRows() const;
 };
 
 class DBTimeExcluder : NonCopyable
@@ -8,6 +8,11 @@
 #include "main/Config.h"
 #include "main/test.h"
 #include "crypto/Hex.h"
+#include "crypto/SHA.h"
+#include "transactions/TransactionFrame.h"
+#include "util/basen.h"
+#include "xdrpp/marshal.h"
+#include "medida/meter.h"
 #include <random>
 #include "test/test_marshaler.h"
 
@@ -336,3 +341,102 @@ TEST_CASE("schema test", "[db]")
     auto av = db.getAppSchemaVersion();
     REQUIRE(dbv == av);
 }
+
+static void
+checkBinaryHistoryUpgrade(Application::pointer app)
+{
+    auto& db = app->getDatabase();
+    auto& sess = db.getSession();
+
+    // history as an older schema stored it
+    TransactionFrame::dropAll(db);
+    uint32_t ledgerSeq = 5;
+    TransactionResultPair pair;
+    pair.transactionHash = sha256("tx");
+    auto result = xdr::xdr_to_opaque(pair);
+    std::string result64 = bn::encode_b64(result);
+    std::string body64 = bn::encode_b64(xdr::xdr_to_opaque(
+        TransactionEnvelope()));
+    LedgerEntryChanges changes;
+    std::string changes64 = bn::encode_b64(xdr::xdr_to_opaque(changes));
+    std::string txID = binToHex(pair.transactionHash);
+    sess << "INSERT INTO txhistory "
+            "(txid, ledgerseq, txindex, txbody, txresult, txmeta) VALUES "
+            "(:id, :seq, 1, :txb, :txres, :meta)",
+        soci::use(txID), soci::use(ledgerSeq), soci::use(body64),
+        soci::use(result64), soci::use(body64);
+    sess << "INSERT INTO txfeehistory "
+            "(txid, ledgerseq, txindex, txchanges) VALUES "
+            "(:id, :seq, 1, :txchanges)",
+        soci::use(txID), soci::use(ledgerSeq), soci::use(changes64);
+
+    db.clearPreparedStatementCache();
+    auto queries = db.getQueryMeter().count();
+    TransactionFrame::upgradeToBinaryHistory(db);
+    // each row copied is a round-trip of its own
+    REQUIRE(db.getQueryMeter().count() >= queries + 2);
+
+    // the raw bytes are stored, not any text encoding of them
+    int resultLength = 0;
+    sess << "SELECT length(txresult) FROM txhistory",
+        soci::into(resultLength);
+    REQUIRE(resultLength == static_cast<int>(result.size()));
+
+    queries = db.getQueryMeter().count();
+    auto results =
+        TransactionFrame::getTransactionHistoryResults(db, ledgerSeq);
+    REQUIRE(results.results.size() == 1);
+    REQUIRE(results.results[0].transactionHash == pair.transactionHash);
+    auto fees = TransactionFrame::getTransactionFeeMeta(db, ledgerSeq);
+    REQUIRE(db.getQueryMeter().count() == queries + 2);
+    REQUIRE(fees.size() == 1);
+    REQUIRE(fees[0].empty());
+}
+
+TEST_CASE("tx history upgrade to binary columns", "[db]")
+{
+    Config const& cfg = getTestConfig(0, Config::TESTDB_IN_MEMORY_SQLITE);
+
+    VirtualClock clock;
+    Application::pointer app = Application::create(clock, cfg);
+    app->start();
+
+    checkBinaryHistoryUpgrade(app);
+}
+
+#ifdef USE_POSTGRES
+TEST_CASE("postgres tx history upgrade to binary columns", "[db]")
+{
+    Config const& cfg = getTestConfig(0, Config::TESTDB_POSTGRESQL);
+
+    VirtualClock clock;
+    try
+    {
+        Application::pointer app = Application::create(clock, cfg);
+        app->start();
+
+        checkBinaryHistoryUpgrade(app);
+
+        std::string type;
+        app->getDatabase().getSession()
+            << "SELECT data_type FROM information_schema.columns "
+               "WHERE table_name = 'txhistory' AND column_name = 'txbody'",
+            soci::into(type);
+        REQUIRE(type == "bytea");
+    }
+    catch (soci::soci_error& err)
+    {
+        std::string what(err.what());
+
+        if (what.find("Cannot establish connection") != std::string::npos)
+        {
+            LOG(WARNING) << "Cannot connect to postgres server " << what;
+        }
+        else
+        {
+            LOG(ERROR) << "DB error: " << what;
+            REQUIRE(0);
+        }
+    }
+}
+#endif
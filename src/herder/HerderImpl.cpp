@@ -7,6 +7,7 @@
 #include "crypto/SHA.h"
 #include "herder/TxSetFrame.h"
 #include "herder/LedgerCloseData.h"
+#include "history/HistoryManager.h"
 #include "ledger/LedgerManager.h"
 #include "main/Application.h"
 #include "main/Config.h"
@@ -27,6 +28,7 @@
 #include "util/XDRStream.h"
 
 #include <ctime>
+#include <map>
 
 using namespace std;
 using namespace soci;
@@ -1720,6 +1722,10 @@ HerderImpl::saveSCPHistory(uint64 index)
                 st.execute(true);
             }
         }
+        // the same entry copySCPHistoryToStream would rebuild from the rows
+        // below, for the checkpoint being streamed as ledgers close
+        std::map<std::string, SCPEnvelope const*> envsByNode;
+
         for (auto const& e : envs)
         {
             auto const& qHash =
@@ -1728,6 +1734,7 @@ HerderImpl::saveSCPHistory(uint64 index)
 
             std::string nodeIDStrKey =
                 PubKeyUtils::toStrKey(e.statement.nodeID);
+            envsByNode[nodeIDStrKey] = &e;
 
             auto envelopeBytes(xdr::xdr_to_opaque(e));
 
@@ -1799,6 +1806,22 @@ HerderImpl::saveSCPHistory(uint64 index)
         }
 
         txscope.commit();
+
+        SCPHistoryEntry hEntryV;
+        hEntryV.v(LedgerVersion::EMPTY_VERSION);
+        auto& hEntry = hEntryV.v0();
+        hEntry.ledgerMessages.ledgerSeq = seq;
+        for (auto const& e : envsByNode)
+        {
+            hEntry.ledgerMessages.messages.emplace_back(*e.second);
+        }
+        std::map<Hash, SCPQuorumSetPtr> sortedQSets(usedQSets.begin(),
+                                                    usedQSets.end());
+        for (auto const& p : sortedQSets)
+        {
+            hEntry.quorumSets.emplace_back(*p.second);
+        }
+        mApp.getHistoryManager().appendSCPHistoryToCheckpoint(hEntryV);
     }
 }
 
@@ -0,0 +1,231 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "history/CheckpointBuilder.h"
+#include "herder/TxSetFrame.h"
+#include "history/FileTransferInfo.h"
+#include "history/HistoryManager.h"
+#include "history/StateSnapshot.h"
+#include "main/Application.h"
+#include "util/Logging.h"
+#include "util/make_unique.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace stellar
+{
+
+CheckpointBuilder::CheckpointBuilder(Application& app)
+    : mApp(app), mCheckpoint(0), mNextLedger(0), mValid(false), mSCPEntries(0)
+{
+}
+
+CheckpointBuilder::~CheckpointBuilder()
+{
+    mLedgerOut.close();
+    mTxOut.close();
+    mTxResultOut.close();
+    mSCPOut.close();
+}
+
+std::string
+CheckpointBuilder::filename(std::string const& type, uint32_t checkpoint) const
+{
+    return FileTransferInfo(*mDir, type, checkpoint).localPath_nogz();
+}
+
+void
+CheckpointBuilder::removeFiles(uint32_t checkpoint)
+{
+    for (auto type : {HISTORY_FILE_TYPE_LEDGER, HISTORY_FILE_TYPE_TRANSACTIONS,
+                      HISTORY_FILE_TYPE_RESULTS, HISTORY_FILE_TYPE_SCP})
+    {
+        std::remove(filename(type, checkpoint).c_str());
+    }
+}
+
+void
+CheckpointBuilder::startCheckpoint(uint32_t checkpoint, bool valid)
+{
+    if (mCheckpoint != 0)
+    {
+        // the previous checkpoint never got its last ledger
+        mValid = false;
+        finishCheckpoint();
+    }
+    if (!mDir)
+    {
+        mDir = make_unique<TmpDir>(mApp.getTmpDirManager().tmpDir("checkpoint"));
+    }
+
+    mCheckpoint = checkpoint;
+    mValid = valid;
+    mSCPEntries = 0;
+    if (mValid)
+    {
+        mLedgerOut.open(filename(HISTORY_FILE_TYPE_LEDGER, checkpoint));
+        mTxOut.open(filename(HISTORY_FILE_TYPE_TRANSACTIONS, checkpoint));
+        mTxResultOut.open(filename(HISTORY_FILE_TYPE_RESULTS, checkpoint));
+        mSCPOut.open(filename(HISTORY_FILE_TYPE_SCP, checkpoint));
+    }
+    else
+    {
+        CLOG(DEBUG, "History") << "Joined checkpoint " << checkpoint
+                               << " part way through, not streaming it";
+    }
+}
+
+void
+CheckpointBuilder::finishCheckpoint()
+{
+    mLedgerOut.close();
+    mTxOut.close();
+    mTxResultOut.close();
+    mSCPOut.close();
+
+    if (mValid)
+    {
+        bool hasSCP = mSCPEntries != 0;
+        if (!hasSCP)
+        {
+            // don't upload empty files
+            std::remove(filename(HISTORY_FILE_TYPE_SCP, mCheckpoint).c_str());
+        }
+        mFinished[mCheckpoint] = hasSCP;
+        CLOG(DEBUG, "History") << "Streamed checkpoint " << mCheckpoint;
+    }
+    else
+    {
+        removeFiles(mCheckpoint);
+    }
+    mCheckpoint = 0;
+    mValid = false;
+}
+
+void
+CheckpointBuilder::appendSCPHistory(SCPHistoryEntry const& entry)
+{
+    uint32_t seq = entry.v0().ledgerMessages.ledgerSeq;
+    mPendingSCP[seq] = entry;
+
+    // ledgers aren't closing (we're catching up, say); don't hoard messages
+    auto freq = mApp.getHistoryManager().getCheckpointFrequency();
+    while (mPendingSCP.size() > freq)
+    {
+        mPendingSCP.erase(mPendingSCP.begin());
+    }
+}
+
+void
+CheckpointBuilder::appendLedger(LedgerHeaderHistoryEntry const& header,
+                                TxSetFrame& txSet,
+                                TransactionResultSet const& results)
+{
+    auto& hm = mApp.getHistoryManager();
+    uint32_t seq = header.header.ledgerSeq;
+    uint32_t checkpoint = hm.nextCheckpointLedger(seq + 1) - 1;
+    uint32_t freq = hm.getCheckpointFrequency();
+    // ledger 0 doesn't exist, so the first checkpoint starts at 1
+    uint32_t first = std::max<uint32_t>(1, checkpoint + 1 - freq);
+
+    if (checkpoint != mCheckpoint)
+    {
+        startCheckpoint(checkpoint, seq == first);
+    }
+    else if (seq != mNextLedger && mValid)
+    {
+        CLOG(DEBUG, "History") << "Ledger " << seq << " doesn't follow "
+                               << (mNextLedger - 1) << ", not streaming "
+                               << "checkpoint " << checkpoint;
+        mValid = false;
+    }
+    mNextLedger = seq + 1;
+
+    auto scp = mPendingSCP.find(seq);
+    if (mValid)
+    {
+        mLedgerOut.writeOne(header);
+
+        // as with the database, ledgers without transactions are left out
+        if (!txSet.mTransactions.empty())
+        {
+            TransactionHistoryEntry hist;
+            hist.ledgerSeq = seq;
+            txSet.sortForHash();
+            txSet.toXDR(hist.txSet);
+            mTxOut.writeOne(hist);
+
+            TransactionHistoryResultEntry res;
+            res.ledgerSeq = seq;
+            res.txResultSet = results;
+            mTxResultOut.writeOne(res);
+        }
+
+        if (scp != mPendingSCP.end())
+        {
+            mSCPOut.writeOne(scp->second);
+            ++mSCPEntries;
+        }
+
+        if (!mLedgerOut || !mTxOut || !mTxResultOut || !mSCPOut)
+        {
+            CLOG(WARNING, "History") << "Failed writing checkpoint "
+                                     << checkpoint << " as ledgers close";
+            mValid = false;
+        }
+    }
+    mPendingSCP.erase(mPendingSCP.begin(), mPendingSCP.upper_bound(seq));
+
+    if (seq == checkpoint)
+    {
+        finishCheckpoint();
+    }
+}
+
+bool
+CheckpointBuilder::takeCheckpoint(StateSnapshot& snapshot)
+{
+    uint32_t checkpoint = snapshot.mLocalState.currentLedger;
+    auto it = mFinished.find(checkpoint);
+    bool taken = false;
+    if (it != mFinished.end())
+    {
+        std::vector<std::pair<std::string, std::string>> moves = {
+            {filename(HISTORY_FILE_TYPE_LEDGER, checkpoint),
+             snapshot.mLedgerSnapFile->localPath_nogz()},
+            {filename(HISTORY_FILE_TYPE_TRANSACTIONS, checkpoint),
+             snapshot.mTransactionSnapFile->localPath_nogz()},
+            {filename(HISTORY_FILE_TYPE_RESULTS, checkpoint),
+             snapshot.mTransactionResultSnapFile->localPath_nogz()}};
+        if (it->second)
+        {
+            moves.emplace_back(filename(HISTORY_FILE_TYPE_SCP, checkpoint),
+                               snapshot.mSCPHistorySnapFile->localPath_nogz());
+        }
+
+        taken = true;
+        for (auto const& m : moves)
+        {
+            if (std::rename(m.first.c_str(), m.second.c_str()) != 0)
+            {
+                CLOG(WARNING, "History") << "Failed to move " << m.first
+                                         << " to " << m.second;
+                taken = false;
+                break;
+            }
+        }
+    }
+
+    // checkpoints are published in order; older ones won't be asked for
+    for (auto i = mFinished.begin();
+         i != mFinished.end() && i->first <= checkpoint;)
+    {
+        removeFiles(i->first);
+        i = mFinished.erase(i);
+    }
+    return taken;
+}
+}
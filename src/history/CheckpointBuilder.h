@@ -0,0 +1,78 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/StellarXDR.h"
+#include "util/TmpDir.h"
+#include "util/XDRStream.h"
+
+#include <map>
+#include <memory>
+#include <string>
+
+namespace stellar
+{
+
+class Application;
+class TxSetFrame;
+struct StateSnapshot;
+
+/**
+ * CheckpointBuilder streams each ledger's history -- its header, transaction
+ * set, results and the SCP messages that externalized it -- into the files of
+ * the checkpoint in progress as the ledger closes, in the form that
+ * StateSnapshot::writeHistoryBlocks would otherwise produce by reading the
+ * checkpoint's history back out of the database. Publishing a checkpoint then
+ * only has to move its files into the snapshot.
+ *
+ * Only checkpoints seen from their first ledger to their last without a gap
+ * are kept; any other (the one in progress at a restart, or one skipped
+ * through by catchup) is left for the snapshot to write from the database.
+ */
+class CheckpointBuilder
+{
+    Application& mApp;
+    std::unique_ptr<TmpDir> mDir;
+
+    // The checkpoint in progress, named by its last ledger, and whether all
+    // of its ledgers so far have been appended.
+    uint32_t mCheckpoint;
+    uint32_t mNextLedger;
+    bool mValid;
+    size_t mSCPEntries;
+    XDROutputFileStream mLedgerOut;
+    XDROutputFileStream mTxOut;
+    XDROutputFileStream mTxResultOut;
+    XDROutputFileStream mSCPOut;
+
+    // SCP messages for ledgers that have not closed yet.
+    std::map<uint32_t, SCPHistoryEntry> mPendingSCP;
+
+    // Finished checkpoints waiting to be published, with whether each has
+    // any SCP messages.
+    std::map<uint32_t, bool> mFinished;
+
+    std::string filename(std::string const& type, uint32_t checkpoint) const;
+    void startCheckpoint(uint32_t checkpoint, bool valid);
+    void finishCheckpoint();
+    void removeFiles(uint32_t checkpoint);
+
+  public:
+    CheckpointBuilder(Application& app);
+    ~CheckpointBuilder();
+
+    // Hold the SCP messages that externalized `entry`'s ledger until that
+    // ledger closes.
+    void appendSCPHistory(SCPHistoryEntry const& entry);
+
+    // Append a just-closed ledger to the checkpoint in progress.
+    void appendLedger(LedgerHeaderHistoryEntry const& header, TxSetFrame& txSet,
+                      TransactionResultSet const& results);
+
+    // If the checkpoint ending at the snapshot's ledger was built in full,
+    // move its files into the snapshot and return true.
+    bool takeCheckpoint(StateSnapshot& snapshot);
+};
+}
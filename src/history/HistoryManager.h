@@ -180,6 +180,7 @@ class Config;
 class Database;
 class HistoryArchive;
 struct StateSnapshot;
+class TxSetFrame;
 
 class HistoryManager
 {
@@ -292,6 +293,19 @@ class HistoryManager
     // (typically after commit) with a call to publishQueuedHistory.
     virtual void queueCurrentHistory() = 0;
 
+    // Stream the history of the ledger that just closed into the checkpoint
+    // being built, so that publishing it needn't read it back out of the
+    // database. Called from ledger close, before maybeQueueHistoryCheckpoint.
+    virtual void
+    appendLedgerToCheckpoint(LedgerHeaderHistoryEntry const& header,
+                             TxSetFrame& txSet,
+                             TransactionResultSet const& results) = 0;
+
+    // Hold on to the SCP messages that externalized a ledger, to stream them
+    // into its checkpoint once it closes.
+    virtual void
+    appendSCPHistoryToCheckpoint(SCPHistoryEntry const& entry) = 0;
+
     // Returns whether or not the HistoryManager has any writable history
     // archives (those configured with both a `get` and `put` command).
     virtual bool hasAnyWritableHistoryArchive() = 0;
@@ -13,6 +13,7 @@
 #include "bucket/BucketManager.h"
 #include "ledger/LedgerManager.h"
 #include "overlay/StellarXDR.h"
+#include "history/CheckpointBuilder.h"
 #include "history/HistoryArchive.h"
 #include "history/HistoryManagerImpl.h"
 #include "history/HistoryWork.h"
@@ -207,6 +208,7 @@ HistoryManagerImpl::HistoryManagerImpl(Application& app)
     , mWorkDir(nullptr)
     , mPublishWork(nullptr)
     , mCatchupWork(nullptr)
+    , mCheckpointBuilder(make_unique<CheckpointBuilder>(app))
 
     , mPublishSkip(
           app.getMetrics().NewMeter({"history", "publish", "skip"}, "event"))
@@ -515,6 +517,26 @@ HistoryManagerImpl::queueCurrentHistory()
     takeSnapshotAndPublish(has);
 }
 
+void
+HistoryManagerImpl::appendLedgerToCheckpoint(
+    LedgerHeaderHistoryEntry const& header, TxSetFrame& txSet,
+    TransactionResultSet const& results)
+{
+    if (hasAnyWritableHistoryArchive())
+    {
+        mCheckpointBuilder->appendLedger(header, txSet, results);
+    }
+}
+
+void
+HistoryManagerImpl::appendSCPHistoryToCheckpoint(SCPHistoryEntry const& entry)
+{
+    if (hasAnyWritableHistoryArchive())
+    {
+        mCheckpointBuilder->appendSCPHistory(entry);
+    }
+}
+
 void
 HistoryManagerImpl::takeSnapshotAndPublish(HistoryArchiveState const& has)
 {
@@ -526,6 +548,7 @@ HistoryManagerImpl::takeSnapshotAndPublish(HistoryArchiveState const& has)
     auto ledgerSeq = has.currentLedger;
     CLOG(DEBUG, "History") << "Activating publish for ledger " << ledgerSeq;
     auto snap = std::make_shared<StateSnapshot>(mApp, has);
+    snap->mHistoryStreamed = mCheckpointBuilder->takeCheckpoint(*snap);
 
     mPublishWork = mApp.getWorkManager().addWork<PublishWork>(snap);
     mApp.getWorkManager().advanceChildren();
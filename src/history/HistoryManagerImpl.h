@@ -17,6 +17,7 @@ namespace stellar
 {
 
 class Application;
+class CheckpointBuilder;
 class Work;
 
 class HistoryManagerImpl : public HistoryManager
@@ -25,6 +26,7 @@ class HistoryManagerImpl : public HistoryManager
     std::unique_ptr<TmpDir> mWorkDir;
     std::shared_ptr<Work> mPublishWork;
     std::shared_ptr<Work> mCatchupWork;
+    std::unique_ptr<CheckpointBuilder> mCheckpointBuilder;
 
     medida::Meter& mPublishSkip;
     medida::Meter& mPublishQueue;
@@ -57,6 +59,12 @@ class HistoryManagerImpl : public HistoryManager
 
     void queueCurrentHistory() override;
 
+    void appendLedgerToCheckpoint(LedgerHeaderHistoryEntry const& header,
+                                  TxSetFrame& txSet,
+                                  TransactionResultSet const& results) override;
+
+    void appendSCPHistoryToCheckpoint(SCPHistoryEntry const& entry) override;
+
     void takeSnapshotAndPublish(HistoryArchiveState const& has);
 
     bool hasAnyWritableHistoryArchive() override;
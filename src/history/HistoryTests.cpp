@@ -5,11 +5,15 @@
 #include "main/Application.h"
 #include "history/HistoryManager.h"
 #include "history/HistoryWork.h"
+#include "history/FileTransferInfo.h"
+#include "history/StateSnapshot.h"
 #include "main/test.h"
 #include "main/ExternalQueue.h"
 #include "main/PersistentState.h"
 #include "bucket/BucketManager.h"
 #include "util/Fs.h"
+#include "util/Gzip.h"
+#include "crypto/SHA.h"
 #include "transactions/test/TxTests.h"
 #include "process/ProcessManager.h"
 #include <xdrpp/autocheck.h>
@@ -201,6 +205,104 @@ TEST_CASE_METHOD(HistoryTests, "HistoryManager::compress", "[history][compress]"
     REQUIRE(!fs::exists(compressed));
 }
 
+TEST_CASE_METHOD(HistoryTests, "HistoryManager::compress in-process",
+                 "[history][compress]")
+{
+    // several chunks' worth of not-very-compressible data
+    std::string s(600000, 0);
+    for (size_t i = 0; i < s.size(); ++i)
+    {
+        s[i] = static_cast<char>(i * 7919 % 251);
+    }
+    HistoryManager& hm = app.getHistoryManager();
+    std::string fname = hm.localFilename("compressme");
+    {
+        std::ofstream out(fname, std::ofstream::binary);
+        out.write(s.data(), s.size());
+    }
+    std::string compressed = fname + ".gz";
+    gz::compressFile(fname, compressed);
+    std::remove(fname.c_str());
+
+    auto hasher = SHA256::create();
+    gz::decompressFile(compressed, fname, hasher.get());
+    REQUIRE(hasher->finish() == sha256(s));
+    {
+        std::ifstream in(fname, std::ifstream::binary);
+        std::string back((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+        REQUIRE(back == s);
+    }
+    std::remove(fname.c_str());
+
+    // a truncated file is an error, and leaves no output behind
+    std::string gzData;
+    {
+        std::ifstream in(compressed, std::ifstream::binary);
+        gzData.assign((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream out(compressed, std::ofstream::binary);
+        out.write(gzData.data(), gzData.size() / 2);
+    }
+    REQUIRE_THROWS_AS(gz::decompressFile(compressed, fname),
+                      std::runtime_error);
+    REQUIRE(!fs::exists(fname));
+}
+
+TEST_CASE("download window follows throughput", "[history][download]")
+{
+    VirtualClock::time_point t;
+    DownloadWindow window(4);
+    window.reset(t);
+    REQUIRE(window.size() == 4);
+
+    // finish one window's worth of files over a second, at `rate` bytes/ms
+    auto sample = [&](std::function<double(size_t)> rate)
+    {
+        size_t n = window.size();
+        t += std::chrono::seconds(1);
+        for (size_t i = 0; i < n; ++i)
+        {
+            window.finished(static_cast<uint64_t>(rate(n) * 1000 / n), t);
+        }
+    };
+
+    SECTION("throughput grows with concurrency")
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            sample([](size_t n)
+                   {
+                       return 100.0 * n;
+                   });
+        }
+        REQUIRE(window.size() == 4);
+    }
+
+    SECTION("throughput falls with concurrency")
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            sample([](size_t n)
+                   {
+                       return 1000.0 / n;
+                   });
+        }
+        REQUIRE(window.size() == 1);
+    }
+
+    SECTION("unmeasurably quick downloads leave the window alone")
+    {
+        for (size_t i = 0; i < 16; ++i)
+        {
+            window.finished(1000, t);
+        }
+        REQUIRE(window.size() == 4);
+    }
+}
+
 TEST_CASE_METHOD(HistoryTests, "HistoryArchiveState::get_put", "[history]")
 {
     HistoryArchiveState has;
@@ -565,6 +667,41 @@ TEST_CASE_METHOD(HistoryTests, "History publish", "[history][publish]")
     generateAndPublishInitialHistory(1);
 }
 
+TEST_CASE_METHOD(HistoryTests, "Streamed checkpoint matches database history",
+                 "[history][publish]")
+{
+    generateAndPublishInitialHistory(1);
+
+    // what the snapshot would have written from the database, had the
+    // checkpoint not been streamed as it closed
+    auto& hm = app.getHistoryManager();
+    auto snap = std::make_shared<StateSnapshot>(
+        app, hm.getLastClosedHistoryArchiveState());
+    REQUIRE(snap->writeHistoryBlocks());
+
+    auto readAll = [](std::string const& filename)
+    {
+        std::ifstream in(filename, std::ifstream::binary);
+        return std::string((std::istreambuf_iterator<char>(in)),
+                           std::istreambuf_iterator<char>());
+    };
+    for (auto const& f :
+         {snap->mLedgerSnapFile, snap->mTransactionSnapFile,
+          snap->mTransactionResultSnapFile, snap->mSCPHistorySnapFile})
+    {
+        std::string published =
+            mConfigurator->getArchiveDirName() + "/" + f->remoteName();
+        if (!fs::exists(f->localPath_nogz()))
+        {
+            REQUIRE(!fs::exists(published));
+            continue;
+        }
+        std::string unzipped = f->localPath_nogz() + ".published";
+        gz::decompressFile(published, unzipped);
+        REQUIRE(readAll(unzipped) == readAll(f->localPath_nogz()));
+    }
+}
+
 static std::string
 resumeModeName(HistoryManager::CatchupMode mode)
 {
@@ -823,6 +960,43 @@ TEST_CASE_METHOD(HistoryTests, "Repair missing buckets fails",
     }
 }
 
+TEST_CASE_METHOD(HistoryTests, "Catchup minimal applies nothing if a bucket "
+                                "download fails",
+                 "[history][catchup][historybucketrepair]")
+{
+    generateAndPublishInitialHistory(3);
+
+    // Delete one of the published buckets, the smallest, which is downloaded
+    // after the deeper levels' buckets have been.
+    auto dir = mConfigurator->getArchiveDirName();
+    REQUIRE(!dir.empty());
+    HistoryArchiveState has;
+    has.load(dir + "/" + HistoryArchiveState::wellKnownRemoteName());
+    auto buckets = has.differingBuckets(HistoryArchiveState());
+    REQUIRE(buckets.size() > 1);
+    auto missing = fs::remoteName(HISTORY_FILE_TYPE_BUCKET, buckets.back(),
+                                  "xdr.gz");
+    REQUIRE(std::remove((dir + "/" + missing).c_str()) == 0);
+
+    mCfgs.emplace_back(getTestConfig(static_cast<int>(mCfgs.size()) + 1));
+    Application::pointer app2 = Application::create(
+        clock, mConfigurator->configure(mCfgs.back(), false));
+    app2->start();
+
+    auto lcl = app2->getLedgerManager().getLastClosedLedgerHeader();
+    auto bucketListHash = app2->getBucketManager().getBucketList().getHash();
+
+    auto initLedger = app.getLedgerManager().getLastClosedLedgerNum();
+    CHECK(!catchupApplication(initLedger, HistoryManager::CATCHUP_MINIMAL,
+                              app2));
+
+    // None of the levels that had been verified got applied.
+    REQUIRE(app2->getBucketManager().getBucketList().getHash() ==
+            bucketListHash);
+    REQUIRE(app2->getLedgerManager().getLastClosedLedgerHeader().hash ==
+            lcl.hash);
+}
+
 class S3Configurator : public Configurator
 {
   public:
@@ -6,6 +6,7 @@
 #include "bucket/BucketManager.h"
 #include "crypto/Hex.h"
 #include "crypto/SHA.h"
+#include "crypto/SecretKey.h"
 #include "herder/LedgerCloseData.h"
 #include "herder/TxSetFrame.h"
 #include "history/FileTransferInfo.h"
@@ -16,6 +17,8 @@
 #include "ledger/LedgerManager.h"
 #include "main/Config.h"
 #include "process/ProcessManager.h"
+#include "util/Fs.h"
+#include "util/Gzip.h"
 #include "util/Logging.h"
 #include "util/make_unique.h"
 #include "xdr/Stellar-ledger.h"
@@ -23,6 +26,7 @@
 
 #include "lib/util/format.h"
 
+#include <algorithm>
 #include <fstream>
 
 namespace stellar
@@ -180,7 +184,7 @@ checkNoGzipSuffix(std::string const& filename)
 
 GzipFileWork::GzipFileWork(Application& app, WorkParent& parent,
                            std::string const& filenameNoGz, bool keepExisting)
-    : RunCommandWork(app, parent, std::string("gzip-file ") + filenameNoGz)
+    : Work(app, parent, std::string("gzip-file ") + filenameNoGz)
     , mFilenameNoGz(filenameNoGz)
     , mKeepExisting(keepExisting)
 {
@@ -195,20 +199,45 @@ GzipFileWork::onReset()
 }
 
 void
-GzipFileWork::getCommand(std::string& cmdLine, std::string& outFile)
+GzipFileWork::onStart()
 {
-    cmdLine = "gzip ";
-    if (mKeepExisting)
-    {
-        cmdLine += "-c ";
-        outFile = mFilenameNoGz + ".gz";
-    }
-    cmdLine += mFilenameNoGz;
+    std::string filenameNoGz = mFilenameNoGz;
+    bool keepExisting = mKeepExisting;
+    Application& app = this->mApp;
+    auto handler = callComplete();
+    app.getWorkerIOService().post(
+        [&app, filenameNoGz, keepExisting, handler]()
+        {
+            asio::error_code ec;
+            try
+            {
+                gz::compressFile(filenameNoGz, filenameNoGz + ".gz");
+                if (!keepExisting)
+                {
+                    std::remove(filenameNoGz.c_str());
+                }
+            }
+            catch (std::exception& e)
+            {
+                CLOG(WARNING, "History") << "gzip failed: " << e.what();
+                ec = std::make_error_code(std::errc::io_error);
+            }
+            app.getClock().getIOService().post([ec, handler]()
+                                               {
+                                                   handler(ec);
+                                               });
+        });
+}
+
+void
+GzipFileWork::onRun()
+{
+    // Do nothing: we spawned the compressor in onStart().
 }
 
 GunzipFileWork::GunzipFileWork(Application& app, WorkParent& parent,
                                std::string const& filenameGz, bool keepExisting)
-    : RunCommandWork(app, parent, std::string("gunzip-file ") + filenameGz)
+    : Work(app, parent, std::string("gunzip-file ") + filenameGz)
     , mFilenameGz(filenameGz)
     , mKeepExisting(keepExisting)
 {
@@ -216,22 +245,48 @@ GunzipFileWork::GunzipFileWork(Application& app, WorkParent& parent,
 }
 
 void
-GunzipFileWork::getCommand(std::string& cmdLine, std::string& outFile)
+GunzipFileWork::onReset()
 {
-    cmdLine = "gzip -d ";
-    if (mKeepExisting)
-    {
-        cmdLine += "-c ";
-        outFile = mFilenameGz.substr(0, mFilenameGz.size() - 3);
-    }
-    cmdLine += mFilenameGz;
+    std::string filenameNoGz = mFilenameGz.substr(0, mFilenameGz.size() - 3);
+    std::remove(filenameNoGz.c_str());
 }
 
 void
-GunzipFileWork::onReset()
+GunzipFileWork::onStart()
 {
-    std::string filenameNoGz = mFilenameGz.substr(0, mFilenameGz.size() - 3);
-    std::remove(filenameNoGz.c_str());
+    std::string filenameGz = mFilenameGz;
+    bool keepExisting = mKeepExisting;
+    Application& app = this->mApp;
+    auto handler = callComplete();
+    app.getWorkerIOService().post(
+        [&app, filenameGz, keepExisting, handler]()
+        {
+            asio::error_code ec;
+            try
+            {
+                gz::decompressFile(
+                    filenameGz, filenameGz.substr(0, filenameGz.size() - 3));
+                if (!keepExisting)
+                {
+                    std::remove(filenameGz.c_str());
+                }
+            }
+            catch (std::exception& e)
+            {
+                CLOG(WARNING, "History") << "gunzip failed: " << e.what();
+                ec = std::make_error_code(std::errc::io_error);
+            }
+            app.getClock().getIOService().post([ec, handler]()
+                                               {
+                                                   handler(ec);
+                                               });
+        });
+}
+
+void
+GunzipFileWork::onRun()
+{
+    // Do nothing: we spawned the decompressor in onStart().
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -262,16 +317,37 @@ VerifyBucketWork::onStart()
         {
             auto hasher = SHA256::create();
             asio::error_code ec;
-            char buf[4096];
+            std::string filenameGz = filename + ".gz";
+            if (fs::exists(filenameGz))
             {
+                // freshly downloaded: hash the bucket as it is decompressed,
+                // rather than reading it back afterwards
+                try
+                {
+                    gz::decompressFile(filenameGz, filename, hasher.get());
+                    std::remove(filenameGz.c_str());
+                }
+                catch (std::exception& e)
+                {
+                    CLOG(WARNING, "History") << "gunzip failed: " << e.what();
+                    ec = std::make_error_code(std::errc::io_error);
+                }
+            }
+            else
+            {
+                // buckets run to gigabytes; read them in large chunks
+                std::vector<char> buf(1024 * 1024);
                 // ensure that the stream gets its own scope to avoid race with
                 // main thread
                 std::ifstream in(filename, std::ifstream::binary);
                 while (in)
                 {
-                    in.read(buf, sizeof(buf));
-                    hasher->add(ByteSlice(buf, in.gcount()));
+                    in.read(buf.data(), buf.size());
+                    hasher->add(ByteSlice(buf.data(), in.gcount()));
                 }
+            }
+            if (!ec)
+            {
                 uint256 vHash = hasher->finish();
                 if (vHash == hash)
                 {
@@ -287,6 +363,7 @@ VerifyBucketWork::onStart()
                         << "expected hash: " << binToHex(hash);
                     CLOG(WARNING, "History")
                         << "computed hash: " << binToHex(vHash);
+                    std::remove(filename.c_str());
                     ec = std::make_error_code(std::errc::io_error);
                 }
             }
@@ -646,6 +723,88 @@ PutHistoryArchiveStateWork::onSuccess()
     return WORK_SUCCESS;
 }
 
+///////////////////////////////////////////////////////////////////////////
+// Download window
+///////////////////////////////////////////////////////////////////////////
+
+static uint64_t
+fileSize(std::string const& filename)
+{
+    std::ifstream in(filename, std::ifstream::binary | std::ifstream::ate);
+    return in ? static_cast<uint64_t>(in.tellg()) : 0;
+}
+
+DownloadWindow::DownloadWindow(size_t max)
+    : mMax(std::max<size_t>(1, max))
+    , mSize(mMax)
+    , mStep(-1)
+    , mLastRate(0)
+    , mSampleBytes(0)
+    , mSampleFiles(0)
+{
+}
+
+void
+DownloadWindow::reset(VirtualClock::time_point now)
+{
+    mSize = mMax;
+    mStep = -1;
+    mLastRate = 0;
+    mSampleStart = now;
+    mSampleBytes = 0;
+    mSampleFiles = 0;
+}
+
+void
+DownloadWindow::finished(uint64_t bytes, VirtualClock::time_point now)
+{
+    mSampleBytes += bytes;
+    if (++mSampleFiles < mSize)
+    {
+        return;
+    }
+    auto elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(now -
+                                                              mSampleStart)
+            .count();
+    if (elapsed <= 0)
+    {
+        // too quick to measure; keep sampling
+        return;
+    }
+
+    double rate = static_cast<double>(mSampleBytes) / elapsed;
+    bool move = true;
+    if (mLastRate > 0)
+    {
+        if (rate < mLastRate * 0.9)
+        {
+            // the last step made things worse; go back the other way
+            mStep = -mStep;
+        }
+        else if (rate < mLastRate * 1.1)
+        {
+            move = false;
+        }
+    }
+    if (move)
+    {
+        size_t size = mStep < 0 ? std::max<size_t>(1, mSize - 1)
+                                : std::min(mMax, mSize + 1);
+        if (size != mSize)
+        {
+            CLOG(DEBUG, "History") << "Download window " << mSize << " -> "
+                                   << size << " at " << rate << " bytes/ms";
+            mSize = size;
+        }
+    }
+
+    mLastRate = rate;
+    mSampleStart = now;
+    mSampleBytes = 0;
+    mSampleFiles = 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // Batch download-and-decompress
 ///////////////////////////////////////////////////////////////////////////
@@ -661,6 +820,7 @@ BatchDownloadWork::BatchDownloadWork(Application& app, WorkParent& parent,
     , mNext(first)
     , mFileType(type)
     , mDownloadDir(downloadDir)
+    , mWindow(app.getConfig().MAX_CONCURRENT_SUBPROCESSES)
 {
 }
 
@@ -701,6 +861,15 @@ BatchDownloadWork::addNextDownloadWorker()
     mNext += mApp.getHistoryManager().getCheckpointFrequency();
 }
 
+void
+BatchDownloadWork::fillWindow()
+{
+    while (mChildren.size() < mWindow.size() && mNext <= mLast)
+    {
+        addNextDownloadWorker();
+    }
+}
+
 void
 BatchDownloadWork::onReset()
 {
@@ -708,11 +877,8 @@ BatchDownloadWork::onReset()
     mRunning.clear();
     mFinished.clear();
     clearChildren();
-    size_t nChildren = mApp.getConfig().MAX_CONCURRENT_SUBPROCESSES;
-    while (mChildren.size() < nChildren && mNext <= mLast)
-    {
-        addNextDownloadWorker();
-    }
+    mWindow.reset(mApp.getClock().now());
+    fillWindow();
 }
 
 void
@@ -735,10 +901,140 @@ BatchDownloadWork::notify(std::string const& childChanged)
         CLOG(DEBUG, "History") << "Finished download of " << mFileType
                                << " for checkpoint " << i->second;
 
+        FileTransferInfo ft(mDownloadDir, mFileType, i->second);
+        mWindow.finished(fileSize(ft.localPath_nogz()), mApp.getClock().now());
         mFinished.push_back(i->second);
         mRunning.erase(i);
+    }
+    fillWindow();
+    mApp.getHistoryManager().logAndUpdateStatus(true);
+    advance();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Prioritized bucket download-and-verify
+///////////////////////////////////////////////////////////////////////////
+
+DownloadBucketsWork::DownloadBucketsWork(
+    Application& app, WorkParent& parent,
+    std::map<std::string, std::shared_ptr<Bucket>>& buckets,
+    std::vector<std::string> const& hashes,
+    HistoryArchiveState const& applyState, TmpDir const& downloadDir)
+    : Work(app, parent, "download-and-verify-buckets")
+    , mBuckets(buckets)
+    , mHashes(hashes)
+    , mDownloadDir(downloadDir)
+    , mNext(0)
+    , mWindow(app.getConfig().MAX_CONCURRENT_SUBPROCESSES)
+{
+    // Rank each bucket by when ApplyBucketsWork first needs it; anything
+    // applyState doesn't mention (say, a bucket the publish queue refers to)
+    // goes last.
+    std::map<std::string, size_t> rank;
+    size_t n = 0;
+    for (size_t i = BucketList::kNumLevels; i != 0; --i)
+    {
+        auto const& level = applyState.currentBuckets[i - 1];
+        rank.insert(std::make_pair(level.snap, n++));
+        rank.insert(std::make_pair(level.curr, n++));
+    }
+    for (size_t i = BucketList::kNumLevels; i != 0; --i)
+    {
+        auto const& level = applyState.currentBuckets[i - 1];
+        if (level.next.hasOutputHash())
+        {
+            rank.insert(std::make_pair(level.next.getOutputHash(), n++));
+        }
+    }
+    auto rankOf = [&rank, n](std::string const& hash)
+    {
+        auto i = rank.find(hash);
+        return i == rank.end() ? n : i->second;
+    };
+    std::stable_sort(mHashes.begin(), mHashes.end(),
+                     [&rankOf](std::string const& a, std::string const& b)
+                     {
+                         return rankOf(a) < rankOf(b);
+                     });
+}
+
+std::string
+DownloadBucketsWork::getStatus() const
+{
+    if (mState == WORK_RUNNING || mState == WORK_PENDING)
+    {
+        size_t done = mNext - mRunning.size();
+        return fmt::format("Downloading and verifying buckets: {:d}/{:d} "
+                           "({:d}%)",
+                           done, mHashes.size(),
+                           mHashes.empty() ? 100
+                                           : (100 * done / mHashes.size()));
+    }
+    return Work::getStatus();
+}
+
+void
+DownloadBucketsWork::addNextDownloadWorker()
+{
+    auto const& hash = mHashes.at(mNext++);
+    if (mBuckets.find(hash) != mBuckets.end())
+    {
+        // verified before a retry
+        return;
+    }
+
+    FileTransferInfo ft(mDownloadDir, HISTORY_FILE_TYPE_BUCKET, hash);
+    // Each bucket gets its own work-chain of download->verify, where verify
+    // gunzips and hashes in one pass
+    auto verify = addWork<VerifyBucketWork>(mBuckets, ft.localPath_nogz(),
+                                            hexToBin256(hash));
+    verify->addWork<GetRemoteFileWork>(ft.remoteName(), ft.localPath_gz());
+    mRunning.insert(std::make_pair(verify->getUniqueName(), hash));
+}
+
+void
+DownloadBucketsWork::fillWindow()
+{
+    while (mChildren.size() < mWindow.size() && mNext < mHashes.size())
+    {
         addNextDownloadWorker();
     }
+}
+
+void
+DownloadBucketsWork::onReset()
+{
+    mNext = 0;
+    mRunning.clear();
+    clearChildren();
+    mWindow.reset(mApp.getClock().now());
+    fillWindow();
+}
+
+void
+DownloadBucketsWork::notify(std::string const& childChanged)
+{
+    std::vector<std::string> done;
+    for (auto const& c : mChildren)
+    {
+        if (c.second->getState() == WORK_SUCCESS)
+        {
+            done.push_back(c.first);
+        }
+    }
+    for (auto const& d : done)
+    {
+        mChildren.erase(d);
+        auto i = mRunning.find(d);
+        assert(i != mRunning.end());
+
+        auto b = mBuckets.find(i->second);
+        assert(b != mBuckets.end());
+        mWindow.finished(fileSize(b->second->getFilename()),
+                         mApp.getClock().now());
+        mRunning.erase(i);
+    }
+    fillWindow();
     mApp.getHistoryManager().logAndUpdateStatus(true);
     advance();
 }
@@ -907,6 +1203,8 @@ ApplyLedgerChainWork::ApplyLedgerChainWork(
     , mFirstSeq(first)
     , mCurrSeq(first)
     , mLastSeq(last)
+    , mNextHeader(0)
+    , mPrepareTimer(app.getClock())
     , mLastApplied(lastApplied)
 {
 }
@@ -934,28 +1232,132 @@ ApplyLedgerChainWork::onReset()
                           << LedgerManager::ledgerAbbrev(
                                  lm.getLastClosedLedgerHeader());
     mCurrSeq = mFirstSeq;
-    mHdrIn.close();
-    mTxIn.close();
+    mCheckpoint.reset();
+    mNextHeader = 0;
+    mPrepareTimer.cancel();
+    // any prefetches still running finish on their own; nothing waits
+    mPrefetches.clear();
 }
 
-void
-ApplyLedgerChainWork::openCurrentInputFiles()
+// Runs on a worker thread.
+ApplyLedgerChainWork::PreparedCheckpointPtr
+ApplyLedgerChainWork::prepareCheckpoint(Hash const& networkID,
+                                        std::string const& hdrFile,
+                                        std::string const& txFile)
 {
-    mHdrIn.close();
-    mTxIn.close();
-    if (mCurrSeq > mLastSeq)
+    auto cp = std::make_shared<PreparedCheckpoint>();
+
+    XDRMappedInputFileStream hdrIn;
+    hdrIn.open(hdrFile);
+    LedgerHeaderHistoryEntry hHeader;
+    while (hdrIn.readOne(hHeader))
     {
-        return;
+        cp->mHeaders.emplace_back(hHeader);
     }
-    FileTransferInfo hi(mDownloadDir, HISTORY_FILE_TYPE_LEDGER, mCurrSeq);
-    FileTransferInfo ti(mDownloadDir, HISTORY_FILE_TYPE_TRANSACTIONS, mCurrSeq);
-    CLOG(DEBUG, "History") << "Replaying ledger headers from "
-                           << hi.localPath_nogz();
-    CLOG(DEBUG, "History") << "Replaying transactions from "
+
+    XDRMappedInputFileStream txIn;
+    txIn.open(txFile);
+    TransactionHistoryEntry txEntry;
+    while (txIn.readOne(txEntry))
+    {
+        auto txSet = std::make_shared<TxSetFrame>(networkID, txEntry.txSet);
+        // caches every tx's full hash, and the set's hash
+        txSet->getContentsHash();
+        for (auto const& tx : txSet->mTransactions)
+        {
+            auto const& contentsHash = tx->getContentsHash();
+            auto const& env = tx->getEnvelope();
+            // most transactions are signed by their source account; verify
+            // those signatures now, so that applying finds them cached
+            std::vector<AccountID> sources{env.tx.sourceAccount};
+            for (auto const& op : env.tx.operations)
+            {
+                if (op.sourceAccount)
+                {
+                    sources.emplace_back(*op.sourceAccount);
+                }
+            }
+            for (auto const& sig : env.signatures)
+            {
+                for (auto const& source : sources)
+                {
+                    if (PubKeyUtils::hasHint(source, sig.hint))
+                    {
+                        PubKeyUtils::verifySig(source, sig.signature,
+                                               contentsHash);
+                    }
+                }
+            }
+        }
+        cp->mTxSets[txEntry.ledgerSeq] = txSet;
+    }
+    return cp;
+}
+
+std::future<ApplyLedgerChainWork::PreparedCheckpointPtr>
+ApplyLedgerChainWork::prefetchCheckpoint(uint32_t seq)
+{
+    FileTransferInfo hi(mDownloadDir, HISTORY_FILE_TYPE_LEDGER, seq);
+    FileTransferInfo ti(mDownloadDir, HISTORY_FILE_TYPE_TRANSACTIONS, seq);
+    CLOG(DEBUG, "History") << "Preparing ledger headers from "
+                           << hi.localPath_nogz() << " and transactions from "
                            << ti.localPath_nogz();
-    mHdrIn.open(hi.localPath_nogz());
-    mTxIn.open(ti.localPath_nogz());
-    mTxHistoryEntry = TransactionHistoryEntry();
+
+    Hash networkID = mApp.getNetworkID();
+    std::string hdrFile = hi.localPath_nogz();
+    std::string txFile = ti.localPath_nogz();
+    auto task = std::make_shared<std::packaged_task<PreparedCheckpointPtr()>>(
+        [networkID, hdrFile, txFile]()
+        {
+            return prepareCheckpoint(networkID, hdrFile, txFile);
+        });
+    auto fut = task->get_future();
+    if (mApp.getWorkerThreadCount() == 0)
+    {
+        (*task)();
+    }
+    else
+    {
+        mApp.getWorkerIOService().post([task]()
+                                       {
+                                           (*task)();
+                                       });
+    }
+    return fut;
+}
+
+bool
+ApplyLedgerChainWork::loadCurrentCheckpoint()
+{
+    mCheckpoint.reset();
+    mNextHeader = 0;
+    if (mCurrSeq > mLastSeq)
+    {
+        return true;
+    }
+
+    // keep the current checkpoint and the next few in preparation
+    uint32_t step = mApp.getHistoryManager().getCheckpointFrequency();
+    uint32_t seq = mCurrSeq;
+    for (size_t i = 0; i <= kPrefetchDepth && seq <= mLastSeq;
+         ++i, seq += step)
+    {
+        if (mPrefetches.find(seq) == mPrefetches.end())
+        {
+            mPrefetches[seq] = prefetchCheckpoint(seq);
+        }
+    }
+
+    // normally long since ready; only not when applying outpaces decoding
+    auto it = mPrefetches.find(mCurrSeq);
+    if (it->second.wait_for(std::chrono::nanoseconds(0)) !=
+        std::future_status::ready)
+    {
+        return false;
+    }
+    mCheckpoint = it->second.get();
+    mPrefetches.erase(it);
+    return true;
 }
 
 TxSetFramePtr
@@ -964,25 +1366,12 @@ ApplyLedgerChainWork::getCurrentTxSet()
     auto& lm = mApp.getLedgerManager();
     auto seq = lm.getCurrentLedgerHeader().ledgerSeq;
 
-    do
+    auto it = mCheckpoint->mTxSets.find(seq);
+    if (it != mCheckpoint->mTxSets.end())
     {
-        if (mTxHistoryEntry.ledgerSeq < seq)
-        {
-            CLOG(DEBUG, "History") << "Skipping txset for ledger "
-                                   << mTxHistoryEntry.ledgerSeq;
-        }
-        else if (mTxHistoryEntry.ledgerSeq > seq)
-        {
-            break;
-        }
-        else
-        {
-            assert(mTxHistoryEntry.ledgerSeq == seq);
-            CLOG(DEBUG, "History") << "Loaded txset for ledger " << seq;
-            return std::make_shared<TxSetFrame>(mApp.getNetworkID(),
-                                                mTxHistoryEntry.txSet);
-        }
-    } while (mTxIn && mTxIn.readOne(mTxHistoryEntry));
+        CLOG(DEBUG, "History") << "Loaded txset for ledger " << seq;
+        return it->second;
+    }
 
     CLOG(DEBUG, "History") << "Using empty txset for ledger " << seq;
     return std::make_shared<TxSetFrame>(lm.getLastClosedLedgerHeader().hash);
@@ -991,13 +1380,13 @@ ApplyLedgerChainWork::getCurrentTxSet()
 bool
 ApplyLedgerChainWork::applyHistoryOfSingleLedger()
 {
-    LedgerHeaderHistoryEntry hHeader;
-    LedgerHeader& header = hHeader.header;
-
-    if (!mHdrIn || !mHdrIn.readOne(hHeader))
+    if (!mCheckpoint || mNextHeader >= mCheckpoint->mHeaders.size())
     {
         return false;
     }
+    LedgerHeaderHistoryEntry const& hHeader =
+        mCheckpoint->mHeaders[mNextHeader++];
+    LedgerHeader const& header = hHeader.header;
 
     auto& lm = mApp.getLedgerManager();
 
@@ -1081,7 +1470,9 @@ ApplyLedgerChainWork::applyHistoryOfSingleLedger()
 void
 ApplyLedgerChainWork::onStart()
 {
-    openCurrentInputFiles();
+    // the first checkpoint is loaded by onRun, where failures are handled
+    mCheckpoint.reset();
+    mNextHeader = 0;
 }
 
 void
@@ -1089,10 +1480,28 @@ ApplyLedgerChainWork::onRun()
 {
     try
     {
+        if (!mCheckpoint && !loadCurrentCheckpoint())
+        {
+            std::weak_ptr<ApplyLedgerChainWork> weak(
+                std::static_pointer_cast<ApplyLedgerChainWork>(
+                    shared_from_this()));
+            mPrepareTimer.expires_from_now(std::chrono::milliseconds(10));
+            mPrepareTimer.async_wait(
+                [weak]()
+                {
+                    auto self = weak.lock();
+                    if (self)
+                    {
+                        self->scheduleSuccess();
+                    }
+                },
+                VirtualTimer::onFailureNoop);
+            return;
+        }
         if (!applyHistoryOfSingleLedger())
         {
             mCurrSeq += mApp.getHistoryManager().getCheckpointFrequency();
-            openCurrentInputFiles();
+            mCheckpoint.reset();
         }
         scheduleSuccess();
     }
@@ -1274,25 +1683,15 @@ CatchupMinimalWork::onSuccess()
         return WORK_PENDING;
     }
 
-    // Phase 4: download and verify the buckets themselves.
+    // Phase 4: download and verify the buckets themselves, in the order
+    // ApplyBucketsWork will need them.
     if (!mDownloadBucketsWork)
     {
         CLOG(INFO, "History")
             << "Catchup MINIMAL downloading and verifying buckets";
-        std::vector<std::string> buckets =
-            mRemoteState.differingBuckets(mLocalState);
-        mDownloadBucketsWork = addWork<Work>("download and verify buckets");
-        for (auto const& hash : buckets)
-        {
-            FileTransferInfo ft(*mDownloadDir, HISTORY_FILE_TYPE_BUCKET, hash);
-            // Each bucket gets its own work-chain of download->gunzip->verify
-
-            auto verify = mDownloadBucketsWork->addWork<VerifyBucketWork>(
-                mBuckets, ft.localPath_nogz(), hexToBin256(hash));
-            auto gunzip = verify->addWork<GunzipFileWork>(ft.localPath_gz());
-            gunzip->addWork<GetRemoteFileWork>(ft.remoteName(),
-                                               ft.localPath_gz());
-        }
+        mDownloadBucketsWork = addWork<DownloadBucketsWork>(
+            mBuckets, mRemoteState.differingBuckets(mLocalState), mRemoteState,
+            *mDownloadDir);
         return WORK_PENDING;
     }
 
@@ -1300,7 +1699,9 @@ CatchupMinimalWork::onSuccess()
     assert(mVerifyLedgersWork->getState() == WORK_SUCCESS);
     assert(mDownloadBucketsWork->getState() == WORK_SUCCESS);
 
-    // Phase 3: apply the buckets.
+    // Phase 5: apply the buckets. Only once every one of them is verified:
+    // applying clobbers DB state that can't be rolled back, so a download
+    // failing partway must not leave some levels of the new state applied.
     if (!mApplyWork)
     {
         CLOG(INFO, "History") << "Catchup MINIMAL applying buckets for state "
@@ -1715,15 +2116,10 @@ RepairMissingBucketsWork::onReset()
     bucketsToFetch.insert(missingBuckets.begin(), missingBuckets.end());
     bucketsToFetch.insert(publishBuckets.begin(), publishBuckets.end());
 
-    for (auto const& hash : bucketsToFetch)
-    {
-        FileTransferInfo ft(*mDownloadDir, HISTORY_FILE_TYPE_BUCKET, hash);
-        // Each bucket gets its own work-chain of download->gunzip->verify
-        auto verify = addWork<VerifyBucketWork>(mBuckets, ft.localPath_nogz(),
-                                                hexToBin256(hash));
-        auto gunzip = verify->addWork<GunzipFileWork>(ft.localPath_gz());
-        gunzip->addWork<GetRemoteFileWork>(ft.remoteName(), ft.localPath_gz());
-    }
+    addWork<DownloadBucketsWork>(
+        mBuckets,
+        std::vector<std::string>(bucketsToFetch.begin(), bucketsToFetch.end()),
+        mLocalState, *mDownloadDir);
 }
 
 Work::State
@@ -12,6 +12,7 @@
 #include "bucket/BucketApplicator.h"
 #include "util/TmpDir.h"
 
+#include <future>
 #include <memory>
 #include <map>
 #include <string>
@@ -84,30 +85,37 @@ class MakeRemoteDirWork : public RunCommandWork
                       std::shared_ptr<HistoryArchive const> archive);
 };
 
-class GzipFileWork : public RunCommandWork
+// Compresses a file in-process on a worker thread, producing the same
+// `<file>.gz` (and, unless keepExisting, removing `<file>`) as `gzip` would.
+class GzipFileWork : public Work
 {
     std::string mFilenameNoGz;
     bool mKeepExisting;
-    void getCommand(std::string& cmdLine, std::string& outFile) override;
 
   public:
     GzipFileWork(Application& app, WorkParent& parent,
                  std::string const& filenameNoGz, bool keepExisting = false);
     void onReset() override;
+    void onStart() override;
+    void onRun() override;
 };
 
-class GunzipFileWork : public RunCommandWork
+// The reverse of GzipFileWork, as `gzip -d` would do it.
+class GunzipFileWork : public Work
 {
     std::string mFilenameGz;
     bool mKeepExisting;
-    void getCommand(std::string& cmdLine, std::string& outFile) override;
 
   public:
     GunzipFileWork(Application& app, WorkParent& parent,
                    std::string const& filenameGz, bool keepExisting = false);
     void onReset() override;
+    void onStart() override;
+    void onRun() override;
 };
 
+// Checks that a bucket file has the expected hash, then adopts it. If only the
+// gzipped bucket is present, it is decompressed and hashed in the same pass.
 class VerifyBucketWork : public Work
 {
     std::map<std::string, std::shared_ptr<Bucket>>& mBuckets;
@@ -250,13 +258,40 @@ class CatchupMinimalWork : public CatchupWork
     void onFailureRaise() override;
 };
 
+// Decides how many downloads a batch keeps in flight. Throughput is sampled
+// once per window's worth of finished files; the window keeps moving one
+// step in the same direction while throughput improves, turns around when it
+// falls off, and stays put when it makes no difference. It starts at, and
+// never exceeds, the subprocess-concurrency limit.
+class DownloadWindow
+{
+    size_t const mMax;
+    size_t mSize;
+    int mStep;
+    double mLastRate;
+    VirtualClock::time_point mSampleStart;
+    uint64_t mSampleBytes;
+    size_t mSampleFiles;
+
+  public:
+    DownloadWindow(size_t max);
+    size_t
+    size() const
+    {
+        return mSize;
+    }
+    void reset(VirtualClock::time_point now);
+    void finished(uint64_t bytes, VirtualClock::time_point now);
+};
+
 class BatchDownloadWork : public Work
 {
     // Specialized class for downloading _lots_ of files (thousands to
     // millions). Sets up N (small number) of parallel download-decompress
     // worker chains to nibble away at a set of files-to-download, stored
-    // as an integer deque. N is the subprocess-concurrency limit by default
-    // (though it's still enforced globally at the ProcessManager level,
+    // as an integer deque, earliest checkpoint first. N is sized by a
+    // DownloadWindow, at most the subprocess-concurrency limit
+    // (though that's still enforced globally at the ProcessManager level,
     // so you don't have to worry about making a few extra BatchDownloadWork
     // classes -- they won't override the global limit, just schedule a small
     // backlog in the ProcessManager).
@@ -267,8 +302,10 @@ class BatchDownloadWork : public Work
     uint32_t mNext;
     std::string mFileType;
     TmpDir const& mDownloadDir;
+    DownloadWindow mWindow;
 
     void addNextDownloadWorker();
+    void fillWindow();
 
   public:
     BatchDownloadWork(Application& app, WorkParent& parent, uint32_t first,
@@ -279,6 +316,34 @@ class BatchDownloadWork : public Work
     void notify(std::string const& childChanged) override;
 };
 
+// Downloads and verifies a set of buckets, adopting each into `buckets` as it
+// is verified. Buckets are fetched in the order ApplyBucketsWork applies
+// `applyState` -- deepest (and largest) level first, snap before curr, with
+// buckets only needed to restart merges last -- so that applying can follow
+// the downloads closely.
+class DownloadBucketsWork : public Work
+{
+    std::map<std::string, std::shared_ptr<Bucket>>& mBuckets;
+    std::vector<std::string> mHashes;
+    TmpDir const& mDownloadDir;
+    size_t mNext;
+    std::map<std::string, std::string> mRunning;
+    DownloadWindow mWindow;
+
+    void addNextDownloadWorker();
+    void fillWindow();
+
+  public:
+    DownloadBucketsWork(Application& app, WorkParent& parent,
+                        std::map<std::string, std::shared_ptr<Bucket>>& buckets,
+                        std::vector<std::string> const& hashes,
+                        HistoryArchiveState const& applyState,
+                        TmpDir const& downloadDir);
+    std::string getStatus() const override;
+    void onReset() override;
+    void notify(std::string const& childChanged) override;
+};
+
 class CatchupCompleteWork : public CatchupWork
 {
 
@@ -357,19 +422,41 @@ class VerifyLedgerChainWork : public Work
     Work::State onSuccess() override;
 };
 
+// Replays downloaded checkpoints, one ledger per crank. Decoding each
+// checkpoint's files, hashing its transactions and checking their source
+// accounts' signatures (warming the signature cache) happen on the worker
+// pool, a few checkpoints ahead of the ledger being applied. Should applying
+// catch up with the preparation, it waits on a timer rather than blocking the
+// main thread.
 class ApplyLedgerChainWork : public Work
 {
+    // A checkpoint's headers and transaction sets, ready to apply.
+    struct PreparedCheckpoint
+    {
+        std::vector<LedgerHeaderHistoryEntry> mHeaders;
+        std::map<uint32_t, TxSetFramePtr> mTxSets;
+    };
+    typedef std::shared_ptr<PreparedCheckpoint> PreparedCheckpointPtr;
+
+    static size_t const kPrefetchDepth = 2;
+
     TmpDir const& mDownloadDir;
     uint32_t mFirstSeq;
     uint32_t mCurrSeq;
     uint32_t mLastSeq;
-    XDRInputFileStream mHdrIn;
-    XDRInputFileStream mTxIn;
-    TransactionHistoryEntry mTxHistoryEntry;
+    PreparedCheckpointPtr mCheckpoint;
+    size_t mNextHeader;
+    std::map<uint32_t, std::future<PreparedCheckpointPtr>> mPrefetches;
+    // runs again while the current checkpoint is still being prepared
+    VirtualTimer mPrepareTimer;
     LedgerHeaderHistoryEntry& mLastApplied;
 
+    static PreparedCheckpointPtr prepareCheckpoint(Hash const& networkID,
+                                                   std::string const& hdrFile,
+                                                   std::string const& txFile);
+    std::future<PreparedCheckpointPtr> prefetchCheckpoint(uint32_t seq);
     TxSetFramePtr getCurrentTxSet();
-    void openCurrentInputFiles();
+    bool loadCurrentCheckpoint();
     bool applyHistoryOfSingleLedger();
 
   public:
@@ -43,7 +43,7 @@ StateSnapshot::StateSnapshot(Application& app, HistoryArchiveState const& state)
 
     , mSCPHistorySnapFile(std::make_shared<FileTransferInfo>(
           mSnapDir, HISTORY_FILE_TYPE_SCP, mLocalState.currentLedger))
-
+    , mHistoryStreamed(false)
 {
     makeLive();
 }
@@ -63,6 +63,14 @@ StateSnapshot::makeLive()
 bool
 StateSnapshot::writeHistoryBlocks() const
 {
+    if (mHistoryStreamed)
+    {
+        CLOG(DEBUG, "History") << "History for ledger "
+                               << mLocalState.currentLedger
+                               << " was streamed as it closed";
+        return true;
+    }
+
     std::unique_ptr<soci::session> snapSess(
         mApp.getDatabase().canUsePool()
             ? make_unique<soci::session>(mApp.getDatabase().getPool())
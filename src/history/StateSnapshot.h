@@ -26,6 +26,9 @@ struct StateSnapshot : public std::enable_shared_from_this<StateSnapshot>
     std::shared_ptr<FileTransferInfo> mTransactionSnapFile;
     std::shared_ptr<FileTransferInfo> mTransactionResultSnapFile;
     std::shared_ptr<FileTransferInfo> mSCPHistorySnapFile;
+    // Set when the history blocks were streamed in as ledgers closed, and
+    // need not be written from the database.
+    bool mHistoryStreamed;
 
     StateSnapshot(Application& app, HistoryArchiveState const& state);
     void makeLive();
@@ -4,6 +4,8 @@
 
 #include "AssetHelper.h"
 #include "LedgerDelta.h"
+#include "ledger/AssetPairGraph.h"
+#include "database/Database.h"
 #include "xdrpp/printer.h"
 
 using namespace soci;
@@ -35,6 +37,7 @@ void AssetHelper::dropAll(Database& db)
         "version                 INT           NOT NULL, "
         "PRIMARY KEY (code)"
         ");";
+    db.getAssetPairGraph().invalidateStatsAsset();
 }
 
 void AssetHelper::storeUpdateHelper(LedgerDelta& delta, Database& db,
@@ -108,6 +111,7 @@ void AssetHelper::storeUpdateHelper(LedgerDelta& delta, Database& db,
     {
         delta.modEntry(*assetFrame);
     }
+    db.getAssetPairGraph().assetStored(assetFrame->mEntry);
 }
 
 void AssetHelper::storeAdd(LedgerDelta& delta, Database& db,
@@ -134,6 +138,7 @@ void AssetHelper::storeDelete(LedgerDelta& delta, Database& db,
     st.define_and_bind();
     st.execute(true);
     delta.deleteEntry(key);
+    db.getAssetPairGraph().assetDeleted(key);
 }
 
 bool AssetHelper::exists(Database& db, LedgerKey const& key)
@@ -260,6 +265,11 @@ AssetFrame::pointer AssetHelper::loadAsset(AssetCode code,
 }
 
 AssetFrame::pointer AssetHelper::loadStatsAsset(Database& db)
+{
+    return db.getAssetPairGraph().getStatsAsset(db);
+}
+
+AssetFrame::pointer AssetHelper::queryStatsAsset(Database& db)
 {
     uint32 statsAssetPolicy = static_cast<uint32>(AssetPolicy::STATS_QUOTE_ASSET
     );
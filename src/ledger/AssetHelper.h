@@ -54,7 +54,10 @@ public:
     AssetFrame::pointer loadAsset(AssetCode code, AccountID const& owner,
                                   Database& db, LedgerDelta* delta = nullptr);
 
+    // served by Database::getAssetPairGraph
     AssetFrame::pointer loadStatsAsset(Database& db);
+    // always queries the database
+    AssetFrame::pointer queryStatsAsset(Database& db);
 
     void loadAssets(std::vector<AssetFrame::pointer>& retAssets, Database& db);
 
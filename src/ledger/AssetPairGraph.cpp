@@ -0,0 +1,142 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/AssetPairGraph.h"
+#include "ledger/AssetHelper.h"
+#include "ledger/AssetPairHelper.h"
+#include "util/Logging.h"
+#include "util/make_unique.h"
+#include "util/types.h"
+
+namespace stellar
+{
+
+void
+AssetPairGraph::loadPairs(Database& db)
+{
+    std::vector<AssetPairFrame::pointer> pairs;
+    AssetPairHelper::Instance()->loadAllAssetPairs(db, pairs);
+    mPairs.clear();
+    for (auto const& pair : pairs)
+    {
+        auto const& entry = pair->mEntry;
+        mPairs[entry.data.assetPair().base][entry.data.assetPair().quote] =
+            entry;
+    }
+    mPairsLoaded = true;
+    CLOG(DEBUG, "Ledger") << "Loaded " << pairs.size() << " asset pairs";
+}
+
+AssetPairFrame::pointer
+AssetPairGraph::findPair(AssetCode const& base, AssetCode const& quote,
+                         Database& db)
+{
+    if (!mPairsLoaded)
+    {
+        loadPairs(db);
+    }
+
+    auto quotes = mPairs.find(base);
+    if (quotes == mPairs.end())
+    {
+        return nullptr;
+    }
+    auto pair = quotes->second.find(quote);
+    if (pair == quotes->second.end())
+    {
+        return nullptr;
+    }
+    return std::make_shared<AssetPairFrame>(pair->second);
+}
+
+AssetFrame::pointer
+AssetPairGraph::getStatsAsset(Database& db)
+{
+    if (!mStatsAssetLoaded)
+    {
+        auto statsAsset = AssetHelper::Instance()->queryStatsAsset(db);
+        mStatsAsset = statsAsset ? make_unique<LedgerEntry>(statsAsset->mEntry)
+                                 : nullptr;
+        mStatsAssetLoaded = true;
+    }
+    return mStatsAsset ? std::make_shared<AssetFrame>(*mStatsAsset) : nullptr;
+}
+
+void
+AssetPairGraph::pairStored(LedgerEntry const& entry)
+{
+    // not loaded yet, nothing to keep up to date
+    if (!mPairsLoaded)
+    {
+        return;
+    }
+    auto const& pair = entry.data.assetPair();
+    mPairs[pair.base][pair.quote] = entry;
+}
+
+void
+AssetPairGraph::pairDeleted(LedgerKey const& key)
+{
+    auto quotes = mPairs.find(key.assetPair().base);
+    if (quotes == mPairs.end())
+    {
+        return;
+    }
+    quotes->second.erase(key.assetPair().quote);
+    if (quotes->second.empty())
+    {
+        mPairs.erase(quotes);
+    }
+}
+
+void
+AssetPairGraph::assetStored(LedgerEntry const& entry)
+{
+    if (!mStatsAssetLoaded)
+    {
+        return;
+    }
+
+    auto const& asset = entry.data.asset();
+    if (isSetFlag(asset.policies, AssetPolicy::STATS_QUOTE_ASSET))
+    {
+        mStatsAsset = make_unique<LedgerEntry>(entry);
+    }
+    else if (mStatsAsset && mStatsAsset->data.asset().code == asset.code)
+    {
+        // it isn't the stats asset any more
+        mStatsAsset.reset();
+    }
+}
+
+void
+AssetPairGraph::assetDeleted(LedgerKey const& key)
+{
+    if (mStatsAsset && mStatsAsset->data.asset().code == key.asset().code)
+    {
+        mStatsAsset.reset();
+    }
+}
+
+void
+AssetPairGraph::invalidatePairs()
+{
+    mPairs.clear();
+    mPairsLoaded = false;
+}
+
+void
+AssetPairGraph::invalidateStatsAsset()
+{
+    mStatsAsset.reset();
+    mStatsAssetLoaded = false;
+}
+
+void
+AssetPairGraph::clear()
+{
+    invalidatePairs();
+    invalidateStatsAsset();
+}
+}
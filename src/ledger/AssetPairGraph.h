@@ -0,0 +1,64 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/AssetFrame.h"
+#include "ledger/AssetPairFrame.h"
+#include "util/NonCopyable.h"
+#include <map>
+#include <memory>
+#include <string>
+
+namespace stellar
+{
+class Database;
+
+/**
+ * Resident copies of the asset pairs -- the edges along which amounts are
+ * converted from one asset to another -- and of the asset statistics are
+ * kept in, so that converting amounts on every payment, sale participation
+ * and sale check doesn't query the database.
+ *
+ * All pairs are loaded the first time one is asked for (there are few of
+ * them), and the stats asset the first time it is; from then on
+ * AssetPairHelper and AssetHelper write every stored or deleted entry through
+ * to them. Changes that a LedgerDelta rolls back aren't undone here; rather,
+ * what they touched is dropped and loaded again on next use.
+ */
+class AssetPairGraph : NonMovableOrCopyable
+{
+    // quote asset -> pair, by base asset
+    typedef std::map<std::string, std::map<std::string, LedgerEntry>> Pairs;
+
+    bool mPairsLoaded{false};
+    Pairs mPairs;
+
+    bool mStatsAssetLoaded{false};
+    // none if there is no stats asset
+    std::unique_ptr<LedgerEntry> mStatsAsset;
+
+    void loadPairs(Database& db);
+
+  public:
+    // The pair of `base` and `quote`, or nullptr. The frame returned is a
+    // copy.
+    AssetPairFrame::pointer findPair(AssetCode const& base,
+                                     AssetCode const& quote, Database& db);
+
+    // The asset with the STATS_QUOTE_ASSET policy, or nullptr. The frame
+    // returned is a copy.
+    AssetFrame::pointer getStatsAsset(Database& db);
+
+    // Write-through of entries stored to, or deleted from, the database.
+    void pairStored(LedgerEntry const& entry);
+    void pairDeleted(LedgerKey const& key);
+    void assetStored(LedgerEntry const& entry);
+    void assetDeleted(LedgerKey const& key);
+
+    void invalidatePairs();
+    void invalidateStatsAsset();
+    void clear();
+};
+}
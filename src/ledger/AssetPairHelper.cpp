@@ -7,7 +7,9 @@
 #include "crypto/Hex.h"
 #include "database/Database.h"
 #include "LedgerDelta.h"
+#include "ledger/AssetPairGraph.h"
 #include "ledger/LedgerManager.h"
+#include "ledger/SaleSchedule.h"
 #include "util/basen.h"
 #include "util/types.h"
 #include "lib/util/format.h"
@@ -42,6 +44,7 @@ namespace stellar
 			"version				   INT				 NOT NULL DEFAULT 0, "
 			"PRIMARY KEY (base, quote)"
 			");";
+		db.getAssetPairGraph().invalidatePairs();
 	}
 
 	void
@@ -111,7 +114,8 @@ namespace stellar
 		{
 			delta.modEntry(*assetPairFrame);
 		}
-
+		db.getAssetPairGraph().pairStored(assetPairFrame->mEntry);
+		db.getSaleSchedule().pricesChanged();
 	}
 
 	void
@@ -140,6 +144,7 @@ namespace stellar
 		st.define_and_bind();
 		st.execute(true);
 		delta.deleteEntry(key);
+		db.getAssetPairGraph().pairDeleted(key);
 	}
 
 	bool
@@ -227,45 +232,13 @@ namespace stellar
 	AssetPairHelper::loadAssetPair(AssetCode base, AssetCode quote, Database& db,
 			LedgerDelta* delta)
 	{
-		LedgerKey key;
-		key.type(LedgerEntryType::ASSET_PAIR);
-		key.assetPair().base = base;
-		key.assetPair().quote = quote;
-
-		if (cachedEntryExists(key, db))
-		{
-			auto p = getCachedEntry(key, db);
-			return p ? std::make_shared<AssetPairFrame>(*p) : nullptr;
-		}
-
-		string baseCode = base;
-		string quoteCode = quote;
-		std::string sql = assetPairColumnSelector;
-		sql += " WHERE base = :base AND quote = :quote";
-		auto prep = db.getPreparedStatement(sql);
-		auto& st = prep.statement();
-		st.exchange(use(baseCode));
-		st.exchange(use(quoteCode));
-
-		auto timer = db.getSelectTimer("assetPair");
-		AssetPairFrame::pointer retAssetPair;
-		loadAssetPairs(prep, [&retAssetPair](LedgerEntry const& assetPair)
-		{
-			retAssetPair = make_shared<AssetPairFrame>(assetPair);
-		});
-
-		if (!retAssetPair)
-		{
-			putCachedEntry(key, nullptr, db);
-			return nullptr;
-		}
-
-		if (delta)
+		// served by the resident pairs, which the store methods above keep
+		// up to date
+		auto retAssetPair = db.getAssetPairGraph().findPair(base, quote, db);
+		if (retAssetPair && delta)
 		{
 			delta->recordEntry(*retAssetPair);
 		}
-		auto pEntry = std::make_shared<LedgerEntry const>(retAssetPair->mEntry);
-		putCachedEntry(key, pEntry, db);
 		return retAssetPair;
 	}
 
@@ -298,6 +271,17 @@ AssetPairFrame::pointer AssetPairHelper::tryLoadAssetPairForAssets(
 		});
 	}
 
+	void AssetPairHelper::loadAllAssetPairs(Database& db, std::vector<AssetPairFrame::pointer>& retAssetPairs)
+	{
+		auto prep = db.getPreparedStatement(assetPairColumnSelector);
+
+		auto timer = db.getSelectTimer("assetPair");
+		loadAssetPairs(prep, [&retAssetPairs](LedgerEntry const& of)
+		{
+			retAssetPairs.emplace_back(make_shared<AssetPairFrame>(of));
+		});
+	}
+
 	void
 	AssetPairHelper::loadAssetPairs(StatementContext& prep,
 			std::function<void(LedgerEntry const&)> assetPairProcessor)
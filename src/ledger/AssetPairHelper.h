@@ -57,6 +57,9 @@ namespace stellar
 
 		void loadAssetPairsByQuote(AssetCode quoteAsset, Database& db, std::vector<AssetPairFrame::pointer>& retAssetPairs);
 
+		// loads every pair from the database, for Database::getAssetPairGraph
+		void loadAllAssetPairs(Database& db, std::vector<AssetPairFrame::pointer>& retAssetPairs);
+
 	private:
 		AssetPairHelper() { ; }
 		~AssetPairHelper() { ; }
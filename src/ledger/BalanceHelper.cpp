@@ -357,4 +357,86 @@ namespace stellar
 		return exists != 0;
 	}
 
+
+	std::unordered_map<BalanceID, BalanceFrame::pointer>
+	BalanceHelper::loadOrderBookBalances(AssetCode const& base, AssetCode const& quote,
+			uint64_t orderBookID, Database& db)
+	{
+		std::unordered_map<BalanceID, BalanceFrame::pointer> retBalances;
+		std::string baseCode = base;
+		std::string quoteCode = quote;
+
+		std::string sql = balanceColumnSelector;
+		sql += " WHERE balance_id IN (SELECT base_balance_id FROM offer"
+			" WHERE order_book_id = :ob1 AND base_asset_code = :b1 AND quote_asset_code = :q1)"
+			" OR balance_id IN (SELECT quote_balance_id FROM offer"
+			" WHERE order_book_id = :ob2 AND base_asset_code = :b2 AND quote_asset_code = :q2)";
+		auto prep = db.getPreparedStatement(sql);
+		auto& st = prep.statement();
+		st.exchange(use(orderBookID, "ob1"));
+		st.exchange(use(baseCode, "b1"));
+		st.exchange(use(quoteCode, "q1"));
+		st.exchange(use(orderBookID, "ob2"));
+		st.exchange(use(baseCode, "b2"));
+		st.exchange(use(quoteCode, "q2"));
+
+		auto timer = db.getSelectTimer("balance");
+		loadBalances(prep, [&retBalances](LedgerEntry const& of)
+		{
+			retBalances[of.data.balance().balanceID] = make_shared<BalanceFrame>(of);
+		});
+		return retBalances;
+	}
+
+	void
+	BalanceHelper::updateBalances(std::vector<LedgerEntry> const& entries, Database& db)
+	{
+		if (entries.empty())
+		{
+			return;
+		}
+
+		std::vector<std::string> balanceIDs, assets, accountIDs;
+		std::vector<int64_t> amounts, locked;
+		std::vector<uint32_t> lastModified;
+		std::vector<int32_t> versions;
+		for (auto const& entry : entries)
+		{
+			auto const& balance = entry.data.balance();
+			if (!BalanceFrame::isValid(balance))
+			{
+				throw std::runtime_error("Invalid balance");
+			}
+			balanceIDs.push_back(BalanceKeyUtils::toStrKey(balance.balanceID));
+			assets.push_back(balance.asset);
+			accountIDs.push_back(PubKeyUtils::toStrKey(balance.accountID));
+			amounts.push_back(balance.amount);
+			locked.push_back(balance.locked);
+			lastModified.push_back(entry.lastModifiedLedgerSeq);
+			versions.push_back(static_cast<int32_t>(balance.ext.v()));
+		}
+
+		auto prep = db.getPreparedStatement("UPDATE balance "
+			"SET    asset = :as, amount=:am, locked=:ld, account_id=:aid, "
+			"lastmodified=:lm, version=:v "
+			"WHERE  balance_id = :id");
+		auto& st = prep.statement();
+		st.exchange(use(balanceIDs, "id"));
+		st.exchange(use(assets, "as"));
+		st.exchange(use(amounts, "am"));
+		st.exchange(use(locked, "ld"));
+		st.exchange(use(accountIDs, "aid"));
+		st.exchange(use(lastModified, "lm"));
+		st.exchange(use(versions, "v"));
+		st.define_and_bind();
+
+		auto timer = db.getUpdateTimer("balance");
+		st.execute(true);
+
+		if (st.get_affected_rows() != static_cast<long long>(entries.size()))
+		{
+			throw std::runtime_error("could not update SQL");
+		}
+	}
+
 }
\ No newline at end of file
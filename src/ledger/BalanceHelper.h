@@ -69,6 +69,15 @@ namespace stellar
 
 		bool exists(Database& db, BalanceID balanceID);
 
+		// load, in one query, the balances of all offers in an order book
+		std::unordered_map<BalanceID, BalanceFrame::pointer>
+			loadOrderBookBalances(AssetCode const& base, AssetCode const& quote,
+				uint64_t orderBookID, Database& db);
+
+		// Writes the given balances in one statement. Unlike storeChange it
+		// leaves recording them in a LedgerDelta to the caller.
+		void updateBalances(std::vector<LedgerEntry> const& entries, Database& db);
+
 	private:
 		BalanceHelper() { ; }
 		~BalanceHelper() { ; }
@@ -39,6 +39,7 @@
 #include "xdrpp/marshal.h"
 #include "crypto/Hex.h"
 #include "database/Database.h"
+#include "medida/meter.h"
 #include "SaleHelper.h"
 
 namespace stellar
@@ -60,7 +61,9 @@ namespace stellar
 	bool EntryHelper::cachedEntryExists(LedgerKey const &key, Database &db)
 	{
 		auto s = binToHex(xdr::xdr_to_opaque(key));
-		return db.getEntryCache().exists(s);
+		bool exists = db.getEntryCache().exists(s);
+		(exists ? db.getEntryCacheHitMeter() : db.getEntryCacheMissMeter()).Mark();
+		return exists;
 	}
 
 	std::shared_ptr<LedgerEntry const>
@@ -3,7 +3,12 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "ledger/LedgerDelta.h"
+#include "ledger/AssetPairGraph.h"
 #include "ledger/EntryHelper.h"
+#include "ledger/OrderBookCache.h"
+#include "ledger/ReferenceIndex.h"
+#include "ledger/ReviewableRequestIndex.h"
+#include "ledger/SaleSchedule.h"
 #include "xdr/Stellar-ledger.h"
 #include "main/Application.h"
 #include "main/Config.h"
@@ -251,19 +256,53 @@ LedgerDelta::rollback()
 	{
 		auto helper = EntryHelperProvider::getHelper(d.type());
 		helper->flushCachedEntry(d, mDb);
+		flushResident(d);
 	}
 	for (auto& n : mNew)
 	{
 		auto helper = EntryHelperProvider::getHelper(n.first.type());
 		helper->flushCachedEntry(n.first, mDb);
+		flushResident(n.first);
 	}
 	for (auto& m : mMod)
 	{
 		auto helper = EntryHelperProvider::getHelper(m.first.type());
 		helper->flushCachedEntry(m.first, mDb);
+		flushResident(m.first);
 	}
 }
 
+void
+LedgerDelta::flushResident(LedgerKey const& key)
+{
+    // the resident order books, asset pairs, sales, request references and
+    // payment references are written through, not rolled back
+    switch (key.type())
+    {
+    case LedgerEntryType::OFFER_ENTRY:
+        mDb.getOrderBookCache().invalidate(key.offer().offerID);
+        break;
+    case LedgerEntryType::ASSET_PAIR:
+        mDb.getAssetPairGraph().invalidatePairs();
+        mDb.getSaleSchedule().pricesChanged();
+        break;
+    case LedgerEntryType::ASSET:
+        mDb.getAssetPairGraph().invalidateStatsAsset();
+        break;
+    case LedgerEntryType::SALE:
+        mDb.getSaleSchedule().clear();
+        break;
+    case LedgerEntryType::REVIEWABLE_REQUEST:
+        mDb.getReviewableRequestIndex().clear();
+        break;
+    case LedgerEntryType::REFERENCE_ENTRY:
+        mDb.getReferenceIndex().forget(key);
+        break;
+    default:
+        break;
+    }
+}
+
 void
 LedgerDelta::addCurrentMeta(LedgerEntryChanges& changes,
                             LedgerKey const& key) const
@@ -45,6 +45,7 @@ private:
     bool mUpdateLastModified;
 
     void checkState();
+    void flushResident(LedgerKey const& key);
     void addEntry(EntryFrame::pointer entry);
     void deleteEntry(EntryFrame::pointer entry);
     void modEntry(EntryFrame::pointer entry);
@@ -192,6 +192,12 @@ LedgerManagerImpl::startNewLedger()
 	CLOG(INFO, "Ledger") << "Commission account id: " << PubKeyUtils::toStrKey(mApp.getCommissionID());
 	CLOG(INFO, "Ledger") << "Operational account id: " << PubKeyUtils::toStrKey(mApp.getOperationalID());
     closeLedgerHelper(delta);
+
+    // genesis opens the first checkpoint
+    auto const& lcl = getLastClosedLedgerHeader();
+    TxSetFrame emptySet(lcl.header.previousLedgerHash);
+    mApp.getHistoryManager().appendLedgerToCheckpoint(lcl, emptySet,
+                                                      TransactionResultSet());
 }
 
 void
@@ -777,6 +783,10 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     ledgerDelta.commit();
     closeLedgerHelper(ledgerDelta);
 
+    auto& hm = mApp.getHistoryManager();
+    hm.appendLedgerToCheckpoint(getLastClosedLedgerHeader(), *ledgerData.mTxSet,
+                                txResultSet);
+
     // The next 4 steps happen in a relatively non-obvious, subtle order.
     // This is unfortunate and it would be nice if we could make it not
     // be so subtle, but for the time being this is where we are.
@@ -795,7 +805,6 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     // 4. GC unreferenced buckets. Only do this once publishes are in progress.
 
     // step 1
-    auto& hm = mApp.getHistoryManager();
     hm.maybeQueueHistoryCheckpoint();
 
     // step 2
@@ -4,6 +4,7 @@
 
 #include "OfferHelper.h"
 #include "LedgerDelta.h"
+#include "OrderBookCache.h"
 #include "xdrpp/printer.h"
 
 using namespace soci;
@@ -41,6 +42,7 @@ namespace stellar {
                 ");";;
         db.getSession() << "CREATE INDEX base_quote_price ON offer"
                 " (order_book_id, base_asset_code, quote_asset_code, is_buy, price);";;
+        db.getOrderBookCache().clear();
     }
 
     void OfferHelper::storeAdd(LedgerDelta &delta, Database &db, LedgerEntry const &entry) {
@@ -59,6 +61,7 @@ namespace stellar {
         st.define_and_bind();
         st.execute(true);
         delta.deleteEntry(key);
+        db.getOrderBookCache().offerDeleted(key.offer().offerID);
     }
 
     bool OfferHelper::exists(Database &db, LedgerKey const &key) {
@@ -181,6 +184,26 @@ namespace stellar {
         {
             delta.modEntry(*offerFrame);
         }
+        db.getOrderBookCache().offerStored(offerFrame->mEntry);
+    }
+
+    void OfferHelper::deleteOffers(std::vector<uint64_t> const& offerIDs, Database& db) {
+        if (offerIDs.empty())
+        {
+            return;
+        }
+
+        auto timer = db.getDeleteTimer("offer");
+        auto prep = db.getPreparedStatement("DELETE FROM offer WHERE offer_id=:s");
+        auto& st = prep.statement();
+        std::vector<uint64_t> ids(offerIDs);
+        st.exchange(use(ids));
+        st.define_and_bind();
+        st.execute(true);
+        for (auto offerID : offerIDs)
+        {
+            db.getOrderBookCache().offerDeleted(offerID);
+        }
     }
 
     void OfferHelper::loadOffers(StatementContext &prep, function<void(const LedgerEntry &)> offerProcessor) {
@@ -286,6 +309,10 @@ vector<OfferFrame::pointer> OfferHelper::loadOffersWithFilters(
             priceUpperBound = *priceUpperBoundPtr;
         }
 
+        // in a stable order, so that whoever goes through them does so the
+        // same way on every node
+        sql += " ORDER BY offer_id";
+
         auto prep = db.getPreparedStatement(sql);
         auto& st = prep.statement();
 
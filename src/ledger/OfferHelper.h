@@ -51,6 +51,10 @@ namespace stellar
 
         std::unordered_map<AccountID, std::vector<OfferFrame::pointer>> loadAllOffers(Database& db);
 
+        // Deletes the given offers in one statement. Unlike storeDelete it
+        // leaves recording the deletions in a LedgerDelta to the caller.
+        void deleteOffers(std::vector<uint64_t> const& offerIDs, Database& db);
+
         void loadBestOffers(size_t numOffers, size_t offset,
                             AssetCode const& base, AssetCode const& quote, uint64_t orderBookID,
                             bool isBuy,
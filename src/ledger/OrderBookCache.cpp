@@ -0,0 +1,247 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/OrderBookCache.h"
+#include "ledger/OfferHelper.h"
+#include "util/Logging.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace stellar
+{
+
+namespace
+{
+// Appends offers from price levels [level, end), in order, skipping those at
+// or before `after`, until `numOffers` have been appended.
+template <typename LevelIt>
+void
+collectOffers(LevelIt level, LevelIt end,
+              OrderBookCache::Position const* after, size_t numOffers,
+              std::vector<OfferFrame::pointer>& offers)
+{
+    size_t n = 0;
+    for (; level != end && n < numOffers; ++level)
+    {
+        auto const& queue = level->second.mOffers;
+        auto it = (after && level->first == after->price)
+                      ? queue.upper_bound(after->offerID)
+                      : queue.begin();
+        for (; it != queue.end() && n < numOffers; ++it, ++n)
+        {
+            offers.emplace_back(std::make_shared<OfferFrame>(it->second));
+        }
+    }
+}
+}
+
+OrderBookCache::OrderBookCache(size_t maxBooks)
+    : mMaxBooks(std::max<size_t>(1, maxBooks))
+{
+}
+
+OrderBookCache::BookKey
+OrderBookCache::bookKey(OfferEntry const& offer)
+{
+    return BookKey(offer.base, offer.quote, offer.orderBookID);
+}
+
+OrderBookCache::Book&
+OrderBookCache::load(BookKey const& key, Database& db)
+{
+    auto it = mBooks.find(key);
+    if (it != mBooks.end())
+    {
+        mRecent.splice(mRecent.begin(), mRecent, it->second.mRecent);
+        return it->second;
+    }
+
+    while (mBooks.size() >= mMaxBooks)
+    {
+        drop(mBooks.find(mRecent.back()));
+    }
+
+    uint64_t orderBookID = std::get<2>(key);
+    auto offers = OfferHelper::Instance()->loadOffersWithFilters(
+        std::get<0>(key), std::get<1>(key), &orderBookID, nullptr, db);
+    Book& book = mBooks[key];
+    mRecent.push_front(key);
+    book.mRecent = mRecent.begin();
+    for (auto const& offer : offers)
+    {
+        insert(book, key, offer->mEntry);
+    }
+    CLOG(DEBUG, "Ledger") << "Loaded order book " << std::get<0>(key) << "/"
+                          << std::get<1>(key) << "#" << orderBookID << " with "
+                          << offers.size() << " offers";
+    return book;
+}
+
+void
+OrderBookCache::insert(Book& book, BookKey const& key, LedgerEntry const& entry)
+{
+    auto const& offer = entry.data.offer();
+    Side& side = offer.isBuy ? book.mBuys : book.mSells;
+    Level& level = side[offer.price];
+    level.mOffers[offer.offerID] = entry;
+    level.mBaseAmount += offer.baseAmount;
+    level.mQuoteAmount += offer.quoteAmount;
+    mSlots[offer.offerID] = Slot{key, offer.isBuy, offer.price};
+}
+
+void
+OrderBookCache::erase(uint64_t offerID)
+{
+    auto slot = mSlots.find(offerID);
+    if (slot == mSlots.end())
+    {
+        return;
+    }
+    auto book = mBooks.find(slot->second.mBook);
+    assert(book != mBooks.end());
+    Side& side =
+        slot->second.mIsBuy ? book->second.mBuys : book->second.mSells;
+    auto level = side.find(slot->second.mPrice);
+    assert(level != side.end());
+    auto& offers = level->second.mOffers;
+    auto it = offers.find(offerID);
+    assert(it != offers.end());
+    auto const& offer = it->second.data.offer();
+    level->second.mBaseAmount -= offer.baseAmount;
+    level->second.mQuoteAmount -= offer.quoteAmount;
+    offers.erase(it);
+    if (offers.empty())
+    {
+        side.erase(level);
+    }
+    mSlots.erase(slot);
+}
+
+void
+OrderBookCache::loadBestOffers(size_t numOffers, AssetCode const& base,
+                               AssetCode const& quote, uint64_t orderBookID,
+                               bool isBuy, Position const* after,
+                               std::vector<OfferFrame::pointer>& offers,
+                               Database& db)
+{
+    Book& book = load(BookKey(base, quote, orderBookID), db);
+    if (isBuy)
+    {
+        // best bid first
+        Side const& side = book.mBuys;
+        auto first = Side::const_reverse_iterator(
+            after ? side.upper_bound(after->price) : side.end());
+        collectOffers(first, side.rend(), after, numOffers, offers);
+    }
+    else
+    {
+        // best ask first
+        Side const& side = book.mSells;
+        auto first = after ? side.lower_bound(after->price) : side.begin();
+        collectOffers(first, side.end(), after, numOffers, offers);
+    }
+}
+
+void
+OrderBookCache::loadDepth(size_t numLevels, AssetCode const& base,
+                          AssetCode const& quote, uint64_t orderBookID,
+                          bool isBuy, std::vector<DepthLevel>& levels,
+                          Database& db)
+{
+    Book& book = load(BookKey(base, quote, orderBookID), db);
+    auto append = [&](Side::value_type const& level) {
+        levels.push_back({level.first, level.second.mBaseAmount,
+                          level.second.mQuoteAmount,
+                          level.second.mOffers.size()});
+    };
+    if (isBuy)
+    {
+        for (auto it = book.mBuys.rbegin();
+             it != book.mBuys.rend() && numLevels != 0; ++it, --numLevels)
+        {
+            append(*it);
+        }
+    }
+    else
+    {
+        for (auto it = book.mSells.begin();
+             it != book.mSells.end() && numLevels != 0; ++it, --numLevels)
+        {
+            append(*it);
+        }
+    }
+}
+
+bool
+OrderBookCache::hasOffersBelow(int64_t price, AssetCode const& base,
+                               AssetCode const& quote, uint64_t orderBookID,
+                               Database& db)
+{
+    Book const& book = load(BookKey(base, quote, orderBookID), db);
+    return (!book.mBuys.empty() && book.mBuys.begin()->first < price) ||
+           (!book.mSells.empty() && book.mSells.begin()->first < price);
+}
+
+void
+OrderBookCache::offerStored(LedgerEntry const& entry)
+{
+    auto const& offer = entry.data.offer();
+    // the offer may have moved, if only to another price level
+    erase(offer.offerID);
+    auto key = bookKey(offer);
+    auto book = mBooks.find(key);
+    if (book != mBooks.end())
+    {
+        insert(book->second, key, entry);
+    }
+}
+
+void
+OrderBookCache::offerDeleted(uint64_t offerID)
+{
+    erase(offerID);
+}
+
+void
+OrderBookCache::invalidate(uint64_t offerID)
+{
+    auto slot = mSlots.find(offerID);
+    if (slot == mSlots.end())
+    {
+        clear();
+        return;
+    }
+
+    auto book = mBooks.find(slot->second.mBook);
+    assert(book != mBooks.end());
+    drop(book);
+}
+
+void
+OrderBookCache::drop(std::map<BookKey, Book>::iterator book)
+{
+    assert(book != mBooks.end());
+    for (auto const* side : {&book->second.mBuys, &book->second.mSells})
+    {
+        for (auto const& level : *side)
+        {
+            for (auto const& offer : level.second.mOffers)
+            {
+                mSlots.erase(offer.first);
+            }
+        }
+    }
+    mRecent.erase(book->second.mRecent);
+    mBooks.erase(book);
+}
+
+void
+OrderBookCache::clear()
+{
+    mBooks.clear();
+    mSlots.clear();
+    mRecent.clear();
+}
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/OfferFrame.h"
+#include "util/NonCopyable.h"
+#include <list>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace stellar
+{
+class Database;
+
+/**
+ * Resident copies of order books -- all offers of one (base, quote, order
+ * book) triple -- so that matching can walk a book in price-time order
+ * without querying the offer table for every few offers it looks at. Each
+ * price level also keeps the sum of its offers, so the top of a book and
+ * its depth are read without going through the offers at all.
+ *
+ * A book is loaded from the offer table the first time it's asked for, and
+ * from then on OfferHelper writes every stored or deleted offer through to
+ * it. Changes that a LedgerDelta rolls back aren't undone here; rather, the
+ * books they touched are dropped and loaded again on next use, just as the
+ * entry cache is flushed of them.
+ *
+ * At most a fixed number of books stay loaded: loading one more drops the
+ * book least recently asked for, to be loaded again if it's needed.
+ */
+class OrderBookCache : NonMovableOrCopyable
+{
+  public:
+    // Where an offer sits on its side of a book. Offers are matched best
+    // price first, then lowest offer ID (i.e. oldest) first.
+    struct Position
+    {
+        int64_t price;
+        uint64_t offerID;
+    };
+
+    // The offers at one price on one side of a book, in sum.
+    struct DepthLevel
+    {
+        int64_t price;
+        uint64_t baseAmount;
+        uint64_t quoteAmount;
+        size_t numOffers;
+    };
+
+  private:
+    typedef std::tuple<std::string, std::string, uint64_t> BookKey;
+
+    // A price level: its offers in offer ID order, and their amounts summed
+    // as they come and go.
+    struct Level
+    {
+        std::map<uint64_t, LedgerEntry> mOffers;
+        uint64_t mBaseAmount{0};
+        uint64_t mQuoteAmount{0};
+    };
+
+    // The price levels of one side of a book.
+    typedef std::map<int64_t, Level> Side;
+
+    struct Book
+    {
+        Side mBuys;
+        Side mSells;
+        // where the book is in mRecent
+        std::list<BookKey>::iterator mRecent;
+    };
+
+    // Where to find each offer of the loaded books.
+    struct Slot
+    {
+        BookKey mBook;
+        bool mIsBuy;
+        int64_t mPrice;
+    };
+
+    size_t const mMaxBooks;
+    std::map<BookKey, Book> mBooks;
+    std::unordered_map<uint64_t, Slot> mSlots;
+    // The loaded books' keys, most recently asked for first.
+    std::list<BookKey> mRecent;
+
+    static BookKey bookKey(OfferEntry const& offer);
+    Book& load(BookKey const& key, Database& db);
+    void insert(Book& book, BookKey const& key, LedgerEntry const& entry);
+    void erase(uint64_t offerID);
+    void drop(std::map<BookKey, Book>::iterator book);
+
+  public:
+    explicit OrderBookCache(size_t maxBooks);
+
+    // Appends to `offers` up to `numOffers` of the best offers on the buy
+    // (or sell) side of the book, in matching order, starting after
+    // `after` if it's given. The offers returned are copies.
+    void loadBestOffers(size_t numOffers, AssetCode const& base,
+                        AssetCode const& quote, uint64_t orderBookID,
+                        bool isBuy, Position const* after,
+                        std::vector<OfferFrame::pointer>& offers,
+                        Database& db);
+
+    // Appends to `levels` up to `numLevels` price levels of the buy (or
+    // sell) side of the book, best price first.
+    void loadDepth(size_t numLevels, AssetCode const& base,
+                   AssetCode const& quote, uint64_t orderBookID, bool isBuy,
+                   std::vector<DepthLevel>& levels, Database& db);
+
+    // Whether any offer of the book, on either side, is priced below
+    // `price`.
+    bool hasOffersBelow(int64_t price, AssetCode const& base,
+                        AssetCode const& quote, uint64_t orderBookID,
+                        Database& db);
+
+    // Write-through of offers stored to, or deleted from, the offer table.
+    void offerStored(LedgerEntry const& entry);
+    void offerDeleted(uint64_t offerID);
+
+    // Drops the book holding `offerID`; or, if it isn't in any loaded book
+    // (it may have been deleted since), every book.
+    void invalidate(uint64_t offerID);
+    void clear();
+
+    size_t
+    numLoadedBooks() const
+    {
+        return mBooks.size();
+    }
+};
+}
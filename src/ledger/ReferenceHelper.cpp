@@ -4,6 +4,7 @@
 
 #include "ReferenceHelper.h"
 #include "LedgerDelta.h"
+#include "ledger/ReferenceIndex.h"
 #include "xdrpp/printer.h"
 
 using namespace soci;
@@ -21,6 +22,7 @@ namespace stellar {
                 "lastmodified INT         NOT NULL,"
                 "PRIMARY KEY (sender, reference)"
                 ");";
+        db.getReferenceIndex().clear();
     }
 
     void ReferenceHelper::storeAdd(LedgerDelta &delta, Database &db, LedgerEntry const &entry) {
@@ -55,6 +57,7 @@ namespace stellar {
         }
 
         delta.addEntry(*referenceFrame);
+        db.getReferenceIndex().referenceStored(referenceEntry);
     }
 
     void ReferenceHelper::storeChange(LedgerDelta &delta, Database &db, LedgerEntry const &entry) {
@@ -71,6 +74,7 @@ namespace stellar {
         st.define_and_bind();
         st.execute(true);
         delta.deleteEntry(key);
+        db.getReferenceIndex().referenceDeleted(key);
     }
 
     bool ReferenceHelper::exists(Database &db, LedgerKey const &key) {
@@ -126,7 +130,13 @@ namespace stellar {
         }
     }
 
-    bool ReferenceHelper::exists(Database &db, std::string reference, AccountID rawSender) {
+    bool ReferenceHelper::exists(Database &db, std::string reference, AccountID sender) {
+        // mostly answered by the resident index, which the store methods
+        // above keep up to date
+        return db.getReferenceIndex().exists(sender, reference, db);
+    }
+
+    bool ReferenceHelper::queryExists(Database &db, std::string const& reference, AccountID const& rawSender) {
         int exists = 0;
         auto timer = db.getSelectTimer("reference-exists");
         auto prep =
@@ -142,6 +152,24 @@ namespace stellar {
         return exists != 0;
     }
 
+    void ReferenceHelper::loadAllReferences(Database &db,
+            function<void(std::string const&, std::string const&)> referenceProcessor) {
+        auto prep = db.getPreparedStatement("SELECT sender, reference FROM reference");
+        auto& st = prep.statement();
+        std::string sender, reference;
+        st.exchange(into(sender));
+        st.exchange(into(reference));
+        st.define_and_bind();
+
+        auto timer = db.getSelectTimer("reference");
+        st.execute(true);
+        while (st.got_data())
+        {
+            referenceProcessor(sender, reference);
+            st.fetch();
+        }
+    }
+
     ReferenceFrame::pointer
     ReferenceHelper::loadReference(AccountID rawSender, std::string reference, Database &db, LedgerDelta *delta) {
         std::string sql = "SELECT sender, reference, lastmodified FROM reference";
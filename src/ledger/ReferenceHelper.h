@@ -35,6 +35,12 @@ namespace stellar {
 
         bool exists(Database &db, LedgerKey const &key) override;
         bool exists(Database &db, std::string reference, AccountID exchange);
+        // always queries the database
+        bool queryExists(Database &db, std::string const& reference, AccountID const& exchange);
+
+        // the sender (as a strkey) and reference of every stored reference
+        void loadAllReferences(Database &db,
+                               std::function<void(std::string const&, std::string const&)> referenceProcessor);
 
         uint64_t countObjects(soci::session &sess) override;
 
@@ -0,0 +1,123 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/ReferenceIndex.h"
+#include "crypto/SecretKey.h"
+#include "ledger/ReferenceHelper.h"
+#include "util/Logging.h"
+#include <algorithm>
+
+namespace stellar
+{
+
+size_t const ReferenceIndex::kMinCapacity;
+size_t const ReferenceIndex::kRecentReferences;
+
+std::string
+ReferenceIndex::referenceKey(std::string const& sender,
+                             std::string const& reference)
+{
+    // a strkey never contains ':'
+    return sender + ":" + reference;
+}
+
+void
+ReferenceIndex::load(Database& db)
+{
+    std::vector<std::string> keys;
+    ReferenceHelper::Instance()->loadAllReferences(
+        db, [&keys](std::string const& sender, std::string const& reference) {
+            keys.push_back(referenceKey(sender, reference));
+        });
+
+    // leave room for as many references again before building it anew
+    mCapacity = std::max(kMinCapacity, 2 * keys.size());
+    mBloom = BloomFilter(mCapacity);
+    mNumKeys = 0;
+    for (auto const& key : keys)
+    {
+        addToBloom(key);
+    }
+    mLoaded = true;
+    CLOG(DEBUG, "Ledger") << "Loaded " << keys.size() << " references";
+}
+
+void
+ReferenceIndex::addToBloom(std::string const& key)
+{
+    mBloom.add(BloomFilter::hash(key));
+    ++mNumKeys;
+}
+
+bool
+ReferenceIndex::exists(AccountID const& sender, std::string const& reference,
+                       Database& db)
+{
+    if (!mLoaded || mNumKeys > mCapacity)
+    {
+        load(db);
+    }
+
+    auto key = referenceKey(PubKeyUtils::toStrKey(sender), reference);
+    if (!mBloom.mayContain(BloomFilter::hash(key)))
+    {
+        return false;
+    }
+    if (mRecent.find(key) != mRecent.end())
+    {
+        return true;
+    }
+    return ReferenceHelper::Instance()->queryExists(db, reference, sender);
+}
+
+void
+ReferenceIndex::referenceStored(ReferenceEntry const& entry)
+{
+    // not loaded yet, nothing to keep up to date
+    if (!mLoaded)
+    {
+        return;
+    }
+
+    auto key =
+        referenceKey(PubKeyUtils::toStrKey(entry.sender), entry.reference);
+    addToBloom(key);
+    if (mRecent.insert(key).second)
+    {
+        mRecentOrder.push_back(key);
+    }
+    while (mRecentOrder.size() > kRecentReferences)
+    {
+        mRecent.erase(mRecentOrder.front());
+        mRecentOrder.pop_front();
+    }
+}
+
+void
+ReferenceIndex::referenceDeleted(LedgerKey const& key)
+{
+    forget(key);
+}
+
+void
+ReferenceIndex::forget(LedgerKey const& key)
+{
+    auto const& reference = key.reference();
+    // it's still in the bloom filter, so will be looked up
+    mRecent.erase(
+        referenceKey(PubKeyUtils::toStrKey(reference.sender),
+                     reference.reference));
+}
+
+void
+ReferenceIndex::clear()
+{
+    mBloom.clear();
+    mCapacity = 0;
+    mNumKeys = 0;
+    mRecent.clear();
+    mRecentOrder.clear();
+    mLoaded = false;
+}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/StellarXDR.h"
+#include "util/BloomFilter.h"
+#include "util/NonCopyable.h"
+#include <deque>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace stellar
+{
+class Database;
+
+/**
+ * Answers whether a sender has already used a reference -- which every
+ * referenced payment asks before storing its reference -- mostly without
+ * querying the reference table. A bloom filter over all the stored
+ * references rules out the ones never used, which is nearly all of them,
+ * and the references most recently stored are kept exactly, so that a
+ * duplicate submitted soon after the original is caught without a query
+ * too. Only the remaining bloom filter positives are looked up.
+ *
+ * The bloom filter is built from the reference table the first time it's
+ * needed, and built again once as many references have been stored since as
+ * it was sized for. ReferenceHelper writes every stored or deleted reference
+ * through. References can't be removed from a bloom filter, but a reference
+ * that isn't stored any more only costs a lookup; so when a LedgerDelta
+ * rolls a reference back, it's only forgotten by the exact set.
+ */
+class ReferenceIndex : NonMovableOrCopyable
+{
+    static size_t const kMinCapacity = 1024;
+    static size_t const kRecentReferences = 65536;
+
+    bool mLoaded{false};
+    BloomFilter mBloom;
+    // the number of references the bloom filter is sized for, and holds
+    size_t mCapacity{0};
+    size_t mNumKeys{0};
+
+    // the references most recently stored, and the order they were in
+    std::unordered_set<std::string> mRecent;
+    std::deque<std::string> mRecentOrder;
+
+    static std::string referenceKey(std::string const& sender,
+                                    std::string const& reference);
+
+    void load(Database& db);
+    void addToBloom(std::string const& key);
+
+  public:
+    // Whether `sender` has stored `reference`.
+    bool exists(AccountID const& sender, std::string const& reference,
+                Database& db);
+
+    // Write-through of references stored to, or deleted from, the database.
+    void referenceStored(ReferenceEntry const& entry);
+    void referenceDeleted(LedgerKey const& key);
+
+    // Forgets a reference that may not be stored any more.
+    void forget(LedgerKey const& key);
+    void clear();
+};
+}
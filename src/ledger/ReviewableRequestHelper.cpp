@@ -7,6 +7,9 @@
 #include "LedgerDelta.h"
 #include "util/basen.h"
 #include "ReferenceFrame.h"
+#include "ledger/ReviewableRequestIndex.h"
+#include <algorithm>
+#include <set>
 
 using namespace soci;
 using namespace std;
@@ -34,7 +37,41 @@ namespace stellar {
                 "PRIMARY KEY (id)"
                 ");";
         db.getSession() << "CREATE UNIQUE INDEX requestor_reference ON reviewable_request (requestor, reference) WHERE reference IS NOT NULL;";
+        db.getReviewableRequestIndex().clear();
+    }
+
+    void ReviewableRequestHelper::addRequestTypeAndIndexes(Database& db)
+    {
+        auto& sess = db.getSession();
+        soci::transaction tx(sess);
+        sess << "ALTER TABLE reviewable_request ADD COLUMN request_type INT NOT NULL DEFAULT 0";
+
+        // the type is only in the encoded body, so has to be filled in here
+        std::vector<uint64_t> requestIDs;
+        std::vector<int32_t> requestTypes;
+        {
+            auto prep = db.getPreparedStatement(selectorReviewableRequest);
+            loadRequests(prep, [&requestIDs, &requestTypes](LedgerEntry const& entry)
+            {
+                auto const& request = entry.data.reviewableRequest();
+                requestIDs.push_back(request.requestID);
+                requestTypes.push_back(static_cast<int32_t>(request.body.type()));
+            });
+        }
+        if (!requestIDs.empty())
+        {
+            auto prep = db.getPreparedStatement("UPDATE reviewable_request SET request_type = :request_type WHERE id = :id");
+            auto& st = prep.statement();
+            st.exchange(use(requestTypes, "request_type"));
+            st.exchange(use(requestIDs, "id"));
+            st.define_and_bind();
+            st.execute(true);
+        }
 
+        sess << "CREATE INDEX requestor_request_type ON reviewable_request (requestor, request_type)";
+        sess << "CREATE INDEX reviewer_request_type ON reviewable_request (reviewer, request_type)";
+        sess << "CREATE INDEX reviewable_request_hash ON reviewable_request (hash)";
+        tx.commit();
     }
 
     void ReviewableRequestHelper::storeAdd(LedgerDelta &delta, Database &db, LedgerEntry const &entry) {
@@ -54,6 +91,7 @@ namespace stellar {
         st.define_and_bind();
         st.execute(true);
         delta.deleteEntry(key);
+        db.getReviewableRequestIndex().requestDeleted(key.reviewableRequest().requestID);
     }
 
     bool ReviewableRequestHelper::exists(Database &db, LedgerKey const &key) {
@@ -110,15 +148,16 @@ namespace stellar {
         std::string strBody = bn::encode_b64(bodyBytes);
         std::string rejectReason = reviewableRequestFrame->getRejectReason();
         auto version = static_cast<int32_t>(reviewableRequestFrame->getRequestEntry().ext.v());
+        auto requestType = static_cast<int32_t>(reviewableRequestFrame->getRequestType());
 
         if (insert)
         {
-            sql = "INSERT INTO reviewable_request (id, hash, body, requestor, reviewer, reference, reject_reason, created_at, version, lastmodified)"
-                  " VALUES (:id, :hash, :body, :requestor, :reviewer, :reference, :reject_reason, :created, :v, :lm)";
+            sql = "INSERT INTO reviewable_request (id, hash, body, requestor, reviewer, reference, reject_reason, created_at, version, lastmodified, request_type)"
+                  " VALUES (:id, :hash, :body, :requestor, :reviewer, :reference, :reject_reason, :created, :v, :lm, :request_type)";
         }
         else
         {
-            sql = "UPDATE reviewable_request SET hash=:hash, body = :body, requestor = :requestor, reviewer = :reviewer, reference = :reference, reject_reason = :reject_reason, created_at = :created, version=:v, lastmodified=:lm"
+            sql = "UPDATE reviewable_request SET hash=:hash, body = :body, requestor = :requestor, reviewer = :reviewer, reference = :reference, reject_reason = :reject_reason, created_at = :created, version=:v, lastmodified=:lm, request_type = :request_type"
                     " WHERE id = :id";
         }
 
@@ -137,6 +176,7 @@ namespace stellar {
         st.exchange(use(reviewableRequestEntry.createdAt, "created"));
         st.exchange(use(version, "v"));
         st.exchange(use(reviewableRequestFrame->mEntry.lastModifiedLedgerSeq, "lm"));
+        st.exchange(use(requestType, "request_type"));
         st.define_and_bind();
 
         auto timer = insert ? db.getInsertTimer("reviewable_request") : db.getUpdateTimer("reviewable_request");
@@ -155,6 +195,7 @@ namespace stellar {
         {
             delta.modEntry(*reviewableRequestFrame);
         }
+        db.getReviewableRequestIndex().requestStored(reviewableRequestFrame->mEntry);
     }
 
     void ReviewableRequestHelper::loadRequests(StatementContext &prep,
@@ -199,21 +240,76 @@ namespace stellar {
         }
     }
 
-    bool ReviewableRequestHelper::exists(Database &db, AccountID const &rawRequestor, stellar::string64 reference, uint64_t requestID) {
-        auto timer = db.getSelectTimer("reviewable_request_exists_by_reference");
-        auto prep =
-                db.getPreparedStatement("SELECT EXISTS (SELECT NULL FROM reviewable_request WHERE requestor=:requestor AND reference = :reference AND id <> :request_id)");
+    bool ReviewableRequestHelper::exists(Database &db, AccountID const &requestor, stellar::string64 reference, uint64_t requestID) {
+        // served by the resident references, which the store methods above
+        // keep up to date
+        return db.getReviewableRequestIndex().referenceExists(requestor, reference, requestID, db);
+    }
+
+    void ReviewableRequestHelper::loadReferences(Database& db,
+            std::function<void(uint64_t, AccountID const&, std::string const&)> referenceProcessor)
+    {
+        auto prep = db.getPreparedStatement("SELECT id, requestor, reference FROM reviewable_request WHERE reference IS NOT NULL");
         auto& st = prep.statement();
-        auto requestor = PubKeyUtils::toStrKey(rawRequestor);
-        st.exchange(use(requestor, "requestor"));
-        st.exchange(use(reference, "reference"));
-        st.exchange(use(requestID, "request_id"));
-        int exists = 0;
-        st.exchange(into(exists));
+        uint64_t requestID;
+        AccountID requestor;
+        std::string reference;
+        st.exchange(into(requestID));
+        st.exchange(into(requestor));
+        st.exchange(into(reference));
         st.define_and_bind();
+
+        auto timer = db.getSelectTimer("reviewable_request_references");
         st.execute(true);
+        while (st.got_data())
+        {
+            referenceProcessor(requestID, requestor, reference);
+            st.fetch();
+        }
+    }
 
-        return exists != 0;
+    void ReviewableRequestHelper::prefetch(std::vector<uint64> const& requestIDs, Database& db)
+    {
+        // one statement serves every batch, the short ones padded with their
+        // last ID
+        std::string sql = selectorReviewableRequest;
+        sql += " WHERE id IN (:id0";
+        for (size_t i = 1; i < PREFETCH_BATCH_SIZE; i++)
+        {
+            sql += ", :id" + std::to_string(i);
+        }
+        sql += ")";
+
+        for (size_t first = 0; first < requestIDs.size(); first += PREFETCH_BATCH_SIZE)
+        {
+            auto last = std::min(first + PREFETCH_BATCH_SIZE, requestIDs.size());
+            std::vector<uint64> batch(requestIDs.begin() + first, requestIDs.begin() + last);
+            batch.resize(PREFETCH_BATCH_SIZE, batch.back());
+
+            auto prep = db.getPreparedStatement(sql);
+            auto& st = prep.statement();
+            for (size_t i = 0; i < PREFETCH_BATCH_SIZE; i++)
+            {
+                st.exchange(use(batch[i]));
+            }
+
+            std::set<uint64> missing(batch.begin(), batch.end());
+            auto timer = db.getSelectTimer("reviewable_request_prefetch");
+            loadRequests(prep, [this, &db, &missing](LedgerEntry const& entry)
+            {
+                auto const& request = entry.data.reviewableRequest();
+                missing.erase(request.requestID);
+                putCachedEntry(getLedgerKey(entry), std::make_shared<LedgerEntry const>(entry), db);
+            });
+
+            for (auto requestID : missing)
+            {
+                LedgerKey key;
+                key.type(LedgerEntryType::REVIEWABLE_REQUEST);
+                key.reviewableRequest().requestID = requestID;
+                putCachedEntry(key, nullptr, db);
+            }
+        }
     }
 
     bool
@@ -235,7 +331,12 @@ namespace stellar {
         if (cachedEntryExists(key, db))
         {
             auto p = getCachedEntry(key, db);
-            return p ? std::make_shared<ReviewableRequestFrame>(*p) : nullptr;
+            auto result = p ? std::make_shared<ReviewableRequestFrame>(*p) : nullptr;
+            if (!!delta && !!result)
+            {
+                delta->recordEntry(*result);
+            }
+            return result;
         }
 
         std::string sql = selectorReviewableRequest;
@@ -286,20 +387,19 @@ loadRequests(AccountID const& rawRequestor, ReviewableRequestType requestType,
     Database& db)
 {
     std::string sql = selectorReviewableRequest;
-    sql += +" WHERE requestor = :requstor";
+    sql += +" WHERE requestor = :requstor AND request_type = :request_type";
     auto prep = db.getPreparedStatement(sql);
     auto& st = prep.statement();
     auto requestor = PubKeyUtils::toStrKey(rawRequestor);
     st.exchange(use(requestor));
+    auto rawRequestType = static_cast<int32_t>(requestType);
+    st.exchange(use(rawRequestType));
 
     vector<ReviewableRequestFrame::pointer> result;
     auto timer = db.getSelectTimer("reviewable_request");
-    loadRequests(prep, [&result,requestType](LedgerEntry const& entry)
+    loadRequests(prep, [&result](LedgerEntry const& entry)
     {
-        auto request = make_shared<ReviewableRequestFrame>(entry);
-        if (request->getRequestType() != requestType)
-            return;
-        result.push_back(request);
+        result.push_back(make_shared<ReviewableRequestFrame>(entry));
     });
 
     return result;
@@ -51,9 +51,23 @@ namespace stellar
         std::vector<ReviewableRequestFrame::pointer> loadRequests(AccountID const& requestor, ReviewableRequestType requestType,
             Database& db);
 
+        // whether a request other than `requestID` has the reference
         bool exists(Database & db, AccountID const & requestor, stellar::string64 reference, uint64_t requestID = 0);
         bool isReferenceExist(Database & db, AccountID const & requestor, string64 reference, uint64_t requestID = 0);
 
+        // the requestor and reference of every request that has one
+        void loadReferences(Database& db,
+            std::function<void(uint64_t, AccountID const&, std::string const&)> referenceProcessor);
+
+        // Loads the requests into the entry cache, PREFETCH_BATCH_SIZE per
+        // query, so that loading them one by one afterwards doesn't query.
+        void prefetch(std::vector<uint64> const& requestIDs, Database& db);
+        static size_t const PREFETCH_BATCH_SIZE = 100;
+
+        // schema upgrade: the request type column, and indexes by requestor,
+        // reviewer and hash
+        void addRequestTypeAndIndexes(Database& db);
+
     private:
         ReviewableRequestHelper() { ; }
         ~ReviewableRequestHelper() { ; }
@@ -0,0 +1,94 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/ReviewableRequestIndex.h"
+#include "crypto/SecretKey.h"
+#include "ledger/ReviewableRequestHelper.h"
+#include "util/Logging.h"
+
+namespace stellar
+{
+
+void
+ReviewableRequestIndex::load(Database& db)
+{
+    clear();
+    ReviewableRequestHelper::Instance()->loadReferences(
+        db, [this](uint64_t requestID, AccountID const& requestor,
+                   std::string const& reference) {
+            insert(requestID, requestor, reference);
+        });
+    mLoaded = true;
+    CLOG(DEBUG, "Ledger") << "Loaded " << mRequests.size()
+                          << " reviewable request references";
+}
+
+void
+ReviewableRequestIndex::insert(uint64_t requestID, AccountID const& requestor,
+                               std::string const& reference)
+{
+    Reference key(PubKeyUtils::toStrKey(requestor), reference);
+    mRequests[key] = requestID;
+    mReferences[requestID] = key;
+}
+
+void
+ReviewableRequestIndex::erase(uint64_t requestID)
+{
+    auto it = mReferences.find(requestID);
+    if (it == mReferences.end())
+    {
+        return;
+    }
+    mRequests.erase(it->second);
+    mReferences.erase(it);
+}
+
+bool
+ReviewableRequestIndex::referenceExists(AccountID const& requestor,
+                                        std::string const& reference,
+                                        uint64_t requestID, Database& db)
+{
+    if (!mLoaded)
+    {
+        load(db);
+    }
+
+    auto it =
+        mRequests.find(Reference(PubKeyUtils::toStrKey(requestor), reference));
+    return it != mRequests.end() && it->second != requestID;
+}
+
+void
+ReviewableRequestIndex::requestStored(LedgerEntry const& entry)
+{
+    // not loaded yet, nothing to keep up to date
+    if (!mLoaded)
+    {
+        return;
+    }
+
+    auto const& request = entry.data.reviewableRequest();
+    // the reference may have changed
+    erase(request.requestID);
+    if (request.reference)
+    {
+        insert(request.requestID, request.requestor, *request.reference);
+    }
+}
+
+void
+ReviewableRequestIndex::requestDeleted(uint64_t requestID)
+{
+    erase(requestID);
+}
+
+void
+ReviewableRequestIndex::clear()
+{
+    mRequests.clear();
+    mReferences.clear();
+    mLoaded = false;
+}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/StellarXDR.h"
+#include "util/NonCopyable.h"
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace stellar
+{
+class Database;
+
+/**
+ * Resident references of the pending reviewable requests, so that checking a
+ * new request's reference is unique -- which every issuance, withdrawal and
+ * sale request does -- doesn't query the database.
+ *
+ * The references are loaded the first time one is checked, and from then on
+ * ReviewableRequestHelper writes every stored or deleted request through to
+ * them. Changes that a LedgerDelta rolls back aren't undone here; rather,
+ * the references are dropped and loaded again on next use.
+ */
+class ReviewableRequestIndex : NonMovableOrCopyable
+{
+    // (requestor, reference)
+    typedef std::pair<std::string, std::string> Reference;
+
+    bool mLoaded{false};
+    // the request holding each reference; there is at most one
+    std::map<Reference, uint64_t> mRequests;
+    std::unordered_map<uint64_t, Reference> mReferences;
+
+    void load(Database& db);
+    void insert(uint64_t requestID, AccountID const& requestor,
+                std::string const& reference);
+    void erase(uint64_t requestID);
+
+  public:
+    // Whether a request other than `requestID` has `reference`.
+    bool referenceExists(AccountID const& requestor,
+                         std::string const& reference, uint64_t requestID,
+                         Database& db);
+
+    // Write-through of requests stored to, or deleted from, the database.
+    void requestStored(LedgerEntry const& entry);
+    void requestDeleted(uint64_t requestID);
+
+    void clear();
+};
+}
@@ -7,6 +7,7 @@
 #include "LedgerDelta.h"
 #include "util/basen.h"
 #include "SaleQuoteAssetHelper.h"
+#include "ledger/SaleSchedule.h"
 
 using namespace soci;
 using namespace std;
@@ -40,7 +41,7 @@ void SaleHelper::dropAll(Database& db)
         ");";
 
     SaleQuoteAssetHelper::dropAll(db);
-
+    db.getSaleSchedule().clear();
 }
 
 void SaleHelper::storeAdd(LedgerDelta& delta, Database& db,
@@ -67,6 +68,7 @@ void SaleHelper::storeDelete(LedgerDelta& delta, Database& db,
     st.execute(true);
     SaleQuoteAssetHelper::deleteAllForSale(db, key.sale().saleID);
     delta.deleteEntry(key);
+    db.getSaleSchedule().saleDeleted(key.sale().saleID);
 }
 
 bool SaleHelper::exists(Database& db, LedgerKey const& key)
@@ -183,6 +185,7 @@ void SaleHelper::storeUpdateHelper(LedgerDelta& delta, Database& db,
     {
         delta.modEntry(*saleFrame);
     }
+    db.getSaleSchedule().saleStored(saleFrame->mEntry);
 }
 
 void SaleHelper::loadSales(Database& db, StatementContext& prep,
@@ -313,6 +316,22 @@ std::vector<SaleFrame::pointer> SaleHelper::loadSalesForOwner(AccountID owner,
     return result;
 }
 
+std::vector<SaleFrame::pointer> SaleHelper::loadAllSales(Database& db)
+{
+    auto prep = db.getPreparedStatement(selectorSale);
+
+    vector<SaleFrame::pointer> result;
+    auto timer = db.getSelectTimer("sale");
+    loadSales(db, prep, [&result](LedgerEntry const& entry)
+    {
+        auto retSale = make_shared<SaleFrame>(entry);
+        retSale->normalize();
+        result.push_back(retSale);
+    });
+
+    return result;
+}
+
 EntryFrame::pointer SaleHelper::storeLoad(LedgerKey const& key, Database& db)
 {
     return loadSale(key.sale().saleID, db);
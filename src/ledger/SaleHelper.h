@@ -42,6 +42,7 @@ namespace stellar
         SaleFrame::pointer loadSale(uint64_t saleID, AssetCode const& base, AssetCode const& quote, Database& db, LedgerDelta* delta = nullptr);
 
         std::vector<SaleFrame::pointer> loadSalesForOwner(AccountID owner, Database& db);
+        std::vector<SaleFrame::pointer> loadAllSales(Database& db);
 
     private:
         SaleHelper() { ; }
@@ -0,0 +1,133 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/SaleSchedule.h"
+#include "ledger/SaleHelper.h"
+#include "util/Logging.h"
+
+namespace stellar
+{
+
+void
+SaleSchedule::load(Database& db)
+{
+    auto sales = SaleHelper::Instance()->loadAllSales(db);
+    clear();
+    for (auto const& sale : sales)
+    {
+        insert(sale->mEntry);
+    }
+    mLoaded = true;
+    CLOG(DEBUG, "Ledger") << "Loaded " << sales.size() << " sales";
+}
+
+void
+SaleSchedule::insert(LedgerEntry const& entry)
+{
+    auto const& sale = entry.data.sale();
+    mSales[sale.saleID].mEntry = entry;
+    mByEndTime.emplace(sale.endTime, sale.saleID);
+    mUnchecked.insert(sale.saleID);
+}
+
+void
+SaleSchedule::erase(uint64_t saleID)
+{
+    auto it = mSales.find(saleID);
+    if (it == mSales.end())
+    {
+        return;
+    }
+    mByEndTime.erase(
+        std::make_pair(it->second.mEntry.data.sale().endTime, saleID));
+    mUnchecked.erase(saleID);
+    mHardCapReached.erase(saleID);
+    mSales.erase(it);
+}
+
+void
+SaleSchedule::loadDueSales(uint64_t closeTime,
+                           HardCapCheck const& hardCapReached,
+                           std::vector<DueSale>& sales, Database& db)
+{
+    if (!mLoaded)
+    {
+        load(db);
+    }
+
+    if (mPricesChanged)
+    {
+        for (auto const& sale : mSales)
+        {
+            mUnchecked.insert(sale.first);
+        }
+        mPricesChanged = false;
+    }
+    for (auto saleID : mUnchecked)
+    {
+        auto& sale = mSales.at(saleID);
+        sale.mHardCapReached =
+            hardCapReached(std::make_shared<SaleFrame>(sale.mEntry));
+        if (sale.mHardCapReached)
+        {
+            mHardCapReached.insert(saleID);
+        }
+        else
+        {
+            mHardCapReached.erase(saleID);
+        }
+    }
+    mUnchecked.clear();
+
+    std::set<uint64_t> due(mHardCapReached);
+    for (auto it = mByEndTime.begin();
+         it != mByEndTime.end() && it->first <= closeTime; ++it)
+    {
+        due.insert(it->second);
+    }
+
+    for (auto saleID : due)
+    {
+        auto const& sale = mSales.at(saleID);
+        sales.push_back({saleID, sale.mEntry.data.sale().endTime,
+                         sale.mHardCapReached});
+    }
+}
+
+void
+SaleSchedule::saleStored(LedgerEntry const& entry)
+{
+    // not loaded yet, nothing to keep up to date
+    if (!mLoaded)
+    {
+        return;
+    }
+    // the end time may have changed
+    erase(entry.data.sale().saleID);
+    insert(entry);
+}
+
+void
+SaleSchedule::saleDeleted(uint64_t saleID)
+{
+    erase(saleID);
+}
+
+void
+SaleSchedule::pricesChanged()
+{
+    mPricesChanged = true;
+}
+
+void
+SaleSchedule::clear()
+{
+    mSales.clear();
+    mByEndTime.clear();
+    mUnchecked.clear();
+    mHardCapReached.clear();
+    mPricesChanged = false;
+    mLoaded = false;
+}
+}
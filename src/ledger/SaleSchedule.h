@@ -0,0 +1,88 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/SaleFrame.h"
+#include "util/NonCopyable.h"
+#include <functional>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace stellar
+{
+class Database;
+
+/**
+ * Resident copies of the open sales, indexed by end time, so that the sales
+ * due to be closed or cancelled are found without loading every sale and
+ * computing its cap on each check. A sale is due once its end time has
+ * passed, or once its current cap has reached its hard cap; the latter is
+ * only computed again for sales stored since, or for all of them after the
+ * asset pair prices it's converted at have changed.
+ *
+ * The sales are loaded the first time they're asked for, and from then on
+ * SaleHelper writes every stored or deleted sale through to them. Changes
+ * that a LedgerDelta rolls back aren't undone here; rather, the sales are
+ * dropped and loaded again on next use.
+ */
+class SaleSchedule : NonMovableOrCopyable
+{
+  public:
+    struct DueSale
+    {
+        uint64_t saleID;
+        uint64_t endTime;
+        bool hardCapReached;
+    };
+
+    // Whether the current cap of the sale has reached its hard cap.
+    typedef std::function<bool(SaleFrame::pointer const&)> HardCapCheck;
+
+  private:
+    struct Sale
+    {
+        LedgerEntry mEntry;
+        bool mHardCapReached{false};
+    };
+
+    bool mLoaded{false};
+    std::unordered_map<uint64_t, Sale> mSales;
+    // (end time, sale ID)
+    std::set<std::pair<uint64_t, uint64_t>> mByEndTime;
+    // sales whose hard cap is to be checked again
+    std::set<uint64_t> mUnchecked;
+    // all sales are to be checked again
+    bool mPricesChanged{false};
+    std::set<uint64_t> mHardCapReached;
+
+    void load(Database& db);
+    void insert(LedgerEntry const& entry);
+    void erase(uint64_t saleID);
+
+  public:
+    // Appends to `sales`, in sale ID order, the sales that have ended by
+    // `closeTime` or that have reached their hard cap.
+    void loadDueSales(uint64_t closeTime, HardCapCheck const& hardCapReached,
+                      std::vector<DueSale>& sales, Database& db);
+
+    // Write-through of sales stored to, or deleted from, the sale table.
+    void saleStored(LedgerEntry const& entry);
+    void saleDeleted(uint64_t saleID);
+
+    // The asset pair prices have changed, so may have the caps of the sales
+    // in their default quote assets.
+    void pricesChanged();
+
+    void clear();
+
+    size_t
+    numLoadedSales() const
+    {
+        return mSales.size();
+    }
+};
+}
@@ -199,6 +199,10 @@ class Application
     // with caution.
     virtual asio::io_service& getWorkerIOService() = 0;
 
+    // The number of threads serving the worker IO service. May be 0, in which
+    // case work posted to it never runs.
+    virtual size_t getWorkerThreadCount() const = 0;
+
     // Perform actions necessary to transition from BOOTING_STATE to other
     // states. In particular: either reload or reinitialize the database, and
     // either restart or begin reacquiring SCP consensus (as instructed by
@@ -418,7 +418,10 @@ namespace stellar {
     void ApplicationImpl::checkDBSync() {
         checkDBAgainstBuckets(this->getMetrics(), this->getBucketManager(),
                               this->getDatabase(),
-                              this->getBucketManager().getBucketList());
+                              this->getBucketManager().getBucketList(),
+                              this->getWorkerThreadCount() == 0
+                                  ? nullptr
+                                  : &this->getWorkerIOService());
     }
 
     void
@@ -593,6 +596,11 @@ namespace stellar {
         return mWorkerIOService;
     }
 
+    size_t
+    ApplicationImpl::getWorkerThreadCount() const {
+        return mWorkerThreads.size();
+    }
+
     std::vector<std::unique_ptr<Invariant>> ApplicationImpl::enabledInvariants() {
         auto result = std::vector<std::unique_ptr<Invariant>>{};
         if (mConfig.INVARIANT_CHECK_CACHE_CONSISTENT_WITH_DATABASE) {
@@ -94,6 +94,8 @@ namespace stellar {
 
         virtual asio::io_service &getWorkerIOService() override;
 
+        virtual size_t getWorkerThreadCount() const override;
+
         void newDB() override;
 
         virtual void start() override;
@@ -12,6 +12,7 @@
 #include "main/CommandHandler.h"
 #include "main/Config.h"
 #include "overlay/BanManager.h"
+#include "overlay/LoadManager.h"
 #include "overlay/OverlayManager.h"
 #include "util/Logging.h"
 #include "util/make_unique.h"
@@ -27,6 +28,10 @@
 
 #include <regex>
 #include <ledger/AssetHelper.h>
+#include "database/Database.h"
+#include "ledger/AssetFrame.h"
+#include "ledger/OrderBookCache.h"
+#include "transactions/CheckSaleStateOpFrame.h"
 #include "transactions/test/TxTests.h"
 using namespace stellar::txtest;
 
@@ -79,6 +84,8 @@ CommandHandler::CommandHandler(Application& app) : mApp(app)
                       std::bind(&CommandHandler::dropcursor, this, _1, _2));
     mServer->addRoute("droppeer",
                       std::bind(&CommandHandler::dropPeer, this, _1, _2));
+    mServer->addRoute("duesales",
+                      std::bind(&CommandHandler::dueSales, this, _1, _2));
     mServer->addRoute("generateload",
                       std::bind(&CommandHandler::generateLoad, this, _1, _2));
     mServer->addRoute("info", std::bind(&CommandHandler::info, this, _1, _2));
@@ -91,6 +98,8 @@ CommandHandler::CommandHandler(Application& app) : mApp(app)
                       std::bind(&CommandHandler::manualClose, this, _1, _2));
     mServer->addRoute("metrics",
                       std::bind(&CommandHandler::metrics, this, _1, _2));
+    mServer->addRoute("orderbook",
+                      std::bind(&CommandHandler::orderBook, this, _1, _2));
     mServer->addRoute("peers", std::bind(&CommandHandler::peers, this, _1, _2));
     mServer->addRoute("quorum",
                       std::bind(&CommandHandler::quorum, this, _1, _2));
@@ -272,11 +281,20 @@ CommandHandler::fileNotFound(std::string const& params, std::string& retStr)
         "rotate log files"
         "</p><p><h1> /manualclose</h1>"
         "close the current ledger; must be used with MANUAL_CLOSE set to true"
+        "</p><p><h1> /duesales[?time=T]</h1>"
+        "returns the IDs of the sales that a check sale state operation would "
+        "close or cancel at close time T (the last ledger's, by default), in "
+        "JSON format"
         "</p><p><h1> /metrics</h1>"
         "returns a snapshot of the metrics registry (for monitoring and "
         "debugging purpose)"
+        "</p><p><h1> /orderbook?base=CODE&quote=CODE[&id=N][&depth=D]</h1>"
+        "returns the best bid and ask of order book N (the secondary market, "
+        "0, by default) of the asset pair, and the amounts offered at each of "
+        "its best D (default 10) price levels per side, in JSON format"
         "</p><p><h1> /peers</h1>"
-        "returns the list of known peers in JSON format"
+        "returns the list of known peers in JSON format, with the recent "
+        "per-second cost of each type of message they sent us"
         "</p><p><h1> /quorum?[node=NODE_ID][&compact=true]</h1>"
         "returns information about the quorum for node NODE_ID (this node by"
         " default). NODE_ID is either a full key (`GABCD...`), an alias "
@@ -352,6 +370,40 @@ parseOptionalNumParam(std::map<std::string, std::string> const& map,
     return true;
 }
 
+void
+CommandHandler::dueSales(std::string const& params, std::string& retStr)
+{
+    Json::Value root;
+
+    std::map<std::string, std::string> retMap;
+    http::server::server::parseParams(params, retMap);
+
+    uint64_t closeTime = mApp.getLedgerManager().getCloseTime();
+    std::string timeStr = retMap["time"];
+    if (!timeStr.empty())
+    {
+        closeTime = strtoull(timeStr.c_str(), NULL, 0);
+    }
+
+    std::vector<SaleSchedule::DueSale> sales;
+    CheckSaleStateOpFrame::loadDueSales(closeTime, mApp.getDatabase(), sales);
+
+    root["close_time"] = Json::UInt64(closeTime);
+    auto& due = root["sales"];
+    due = Json::Value(Json::arrayValue);
+    for (auto const& sale : sales)
+    {
+        Json::Value s;
+        s["id"] = Json::UInt64(sale.saleID);
+        s["end_time"] = Json::UInt64(sale.endTime);
+        s["ended"] = sale.endTime <= closeTime;
+        s["hard_cap_reached"] = sale.hardCapReached;
+        due.append(s);
+    }
+
+    retStr = root.toStyledString();
+}
+
 void
 CommandHandler::generateLoad(std::string const& params, std::string& retStr)
 {
@@ -397,6 +449,78 @@ CommandHandler::generateLoad(std::string const& params, std::string& retStr)
     }
 }
 
+void
+CommandHandler::orderBook(std::string const& params, std::string& retStr)
+{
+    Json::Value root;
+
+    std::map<std::string, std::string> retMap;
+    http::server::server::parseParams(params, retMap);
+
+    AssetCode base = retMap["base"];
+    AssetCode quote = retMap["quote"];
+    if (!AssetFrame::isAssetCodeValid(base) ||
+        !AssetFrame::isAssetCodeValid(quote))
+    {
+        root["status"] = "error";
+        root["detail"] = "Must specify valid asset codes: "
+                         "orderbook?base=CODE&quote=CODE";
+        retStr = root.toStyledString();
+        return;
+    }
+
+    uint64_t orderBookID = strtoull(retMap["id"].c_str(), NULL, 0);
+    size_t depth = 10;
+    std::string depthStr = retMap["depth"];
+    if (!depthStr.empty())
+    {
+        size_t n = strtoul(depthStr.c_str(), NULL, 0);
+        if (n != 0)
+        {
+            depth = n;
+        }
+    }
+
+    root["base"] = base;
+    root["quote"] = quote;
+    root["order_book_id"] = Json::UInt64(orderBookID);
+
+    auto& db = mApp.getDatabase();
+    for (bool isBuy : {true, false})
+    {
+        std::vector<OrderBookCache::DepthLevel> levels;
+        db.getOrderBookCache().loadDepth(depth, base, quote, orderBookID,
+                                         isBuy, levels, db);
+
+        auto& best = root[isBuy ? "best_bid" : "best_ask"];
+        auto& side = root[isBuy ? "bids" : "asks"];
+        side = Json::Value(Json::arrayValue);
+        if (!levels.empty())
+        {
+            best = Json::Int64(levels.front().price);
+        }
+
+        uint64_t cumulativeBase = 0;
+        uint64_t cumulativeQuote = 0;
+        for (auto const& level : levels)
+        {
+            cumulativeBase += level.baseAmount;
+            cumulativeQuote += level.quoteAmount;
+
+            Json::Value l;
+            l["price"] = Json::Int64(level.price);
+            l["offers"] = Json::UInt64(level.numOffers);
+            l["base_amount"] = Json::UInt64(level.baseAmount);
+            l["quote_amount"] = Json::UInt64(level.quoteAmount);
+            l["cumulative_base_amount"] = Json::UInt64(cumulativeBase);
+            l["cumulative_quote_amount"] = Json::UInt64(cumulativeQuote);
+            side.append(l);
+        }
+    }
+
+    retStr = root.toStyledString();
+}
+
 void
 CommandHandler::peers(std::string const& params, std::string& retStr)
 {
@@ -413,6 +537,18 @@ CommandHandler::peers(std::string const& params, std::string& retStr)
         root["peers"][counter]["id"] =
             mApp.getConfig().toStrKey(peer->getPeerID());
 
+        auto costs = mApp.getOverlayManager().getLoadManager().getPeerCosts(
+            peer->getPeerID());
+        for (auto const& kv : costs->mMessageCosts)
+        {
+            auto& c = root["peers"][counter]["costs"]
+                          [LoadManager::messageTypeName(kv.first)];
+            c["time_ns"] = kv.second.mTimeSpent.one_minute_rate();
+            c["send_bytes"] = kv.second.mBytesSend.one_minute_rate();
+            c["recv_bytes"] = kv.second.mBytesRecv.one_minute_rate();
+            c["queries"] = kv.second.mSQLQueries.one_minute_rate();
+        }
+
         counter++;
     }
 
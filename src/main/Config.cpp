@@ -31,7 +31,7 @@ operationalID(PubKeyUtils::fromStrKey("GABAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA
     FORCE_SCP = false;
     LEDGER_PROTOCOL_VERSION = static_cast<int32_t >(LedgerVersion::NEW_SIGNER_TYPES);
     OVERLAY_PROTOCOL_MIN_VERSION = 5;
-    OVERLAY_PROTOCOL_VERSION = 5;
+    OVERLAY_PROTOCOL_VERSION = 6;
 
     VERSION_STR = STELLAR_CORE_VERSION;
     DESIRED_BASE_RESERVE = 0;
@@ -53,6 +53,7 @@ operationalID(PubKeyUtils::fromStrKey("GABAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA
     LOG_FILE_PATH = "stellar-core.log";
     TMP_DIR_PATH = "tmp";
     BUCKET_DIR_PATH = "buckets";
+    INDEX_BUCKETS = false;
 
     DESIRED_BASE_FEE = 0;
     DESIRED_MAX_TX_PER_LEDGER = 50;
@@ -66,6 +67,9 @@ operationalID(PubKeyUtils::fromStrKey("GABAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA
     PREFERRED_PEERS_ONLY = false;
 
     MINIMUM_IDLE_PERCENT = 0;
+    MAX_PEER_OUTBOUND_QUEUE_BYTES = 32 * 1024 * 1024;
+    FETCH_PEERS_IN_PARALLEL = 2;
+    OVERLAY_COMPRESSION_THRESHOLD = 4096;
 
     MAX_CONCURRENT_SUBPROCESSES = 16;
     PARANOID_MODE = false;
@@ -485,6 +489,39 @@ Config::load(std::string const& filename)
                 MINIMUM_IDLE_PERCENT =
                     (uint32_t)item.second->as<int64_t>()->value();
             }
+            else if (item.first == "MAX_PEER_OUTBOUND_QUEUE_BYTES")
+            {
+                if (!item.second->as<int64_t>() ||
+                    item.second->as<int64_t>()->value() <= 0)
+                {
+                    throw std::invalid_argument(
+                        "invalid MAX_PEER_OUTBOUND_QUEUE_BYTES");
+                }
+                MAX_PEER_OUTBOUND_QUEUE_BYTES =
+                    (size_t)item.second->as<int64_t>()->value();
+            }
+            else if (item.first == "FETCH_PEERS_IN_PARALLEL")
+            {
+                if (!item.second->as<int64_t>() ||
+                    item.second->as<int64_t>()->value() <= 0)
+                {
+                    throw std::invalid_argument(
+                        "invalid FETCH_PEERS_IN_PARALLEL");
+                }
+                FETCH_PEERS_IN_PARALLEL =
+                    (uint32_t)item.second->as<int64_t>()->value();
+            }
+            else if (item.first == "OVERLAY_COMPRESSION_THRESHOLD")
+            {
+                if (!item.second->as<int64_t>() ||
+                    item.second->as<int64_t>()->value() < 0)
+                {
+                    throw std::invalid_argument(
+                        "invalid OVERLAY_COMPRESSION_THRESHOLD");
+                }
+                OVERLAY_COMPRESSION_THRESHOLD =
+                    (size_t)item.second->as<int64_t>()->value();
+            }
             else if (item.first == "HISTORY")
             {
                 auto hist = item.second->as_group();
@@ -542,6 +579,14 @@ Config::load(std::string const& filename)
                 }
                 DATABASE = item.second->as<std::string>()->value();
             }
+            else if (item.first == "INDEX_BUCKETS")
+            {
+                if (!item.second->as<bool>())
+                {
+                    throw std::invalid_argument("invalid INDEX_BUCKETS");
+                }
+                INDEX_BUCKETS = item.second->as<bool>()->value();
+            }
             else if (item.first == "PARANOID_MODE")
             {
                 if (!item.second->as<bool>())
@@ -125,6 +125,9 @@ class Config : public std::enable_shared_from_this<Config>
     std::string LOG_FILE_PATH;
     std::string TMP_DIR_PATH;
     std::string BUCKET_DIR_PATH;
+    // Build each bucket's point-lookup index as the bucket is written, rather
+    // than on the first lookup that needs it.
+    bool INDEX_BUCKETS;
     uint32_t DESIRED_BASE_FEE;     // in stroops
     uint32_t DESIRED_BASE_RESERVE; // in stroops
     uint32_t DESIRED_MAX_TX_PER_LEDGER;
@@ -167,6 +170,19 @@ class Config : public std::enable_shared_from_this<Config>
     // totally insensitive to overloading.
     uint32_t MINIMUM_IDLE_PERCENT;
 
+    // Maximum number of bytes of messages queued for sending to a single
+    // peer. When exceeded, the oldest queued transaction floods are dropped;
+    // if that is not enough the peer is disconnected.
+    size_t MAX_PEER_OUTBOUND_QUEUE_BYTES;
+
+    // Number of peers asked concurrently for a missing tx set or quorum set.
+    // The first answer cancels the other requests.
+    uint32_t FETCH_PEERS_IN_PARALLEL;
+
+    // Messages of at least this many bytes are sent compressed to peers
+    // whose overlay version supports it. 0 disables compression.
+    size_t OVERLAY_COMPRESSION_THRESHOLD;
+
     // process-management config
     size_t MAX_CONCURRENT_SUBPROCESSES;
 
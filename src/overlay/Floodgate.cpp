@@ -10,6 +10,7 @@
 #include "util/Logging.h"
 #include "crypto/Hex.h"
 #include "medida/counter.h"
+#include "medida/meter.h"
 #include "medida/metrics_registry.h"
 #include "xdrpp/marshal.h"
 
@@ -30,6 +31,10 @@ Floodgate::Floodgate(Application& app)
           app.getMetrics().NewCounter({"overlay", "memory", "flood-map"}))
     , mSendFromBroadcast(app.getMetrics().NewMeter(
           {"overlay", "message", "send-from-broadcast"}, "message"))
+    , mRecvUnique(app.getMetrics().NewMeter({"overlay", "flood", "unique"},
+                                            "message"))
+    , mRecvDuplicate(app.getMetrics().NewMeter(
+          {"overlay", "flood", "duplicate"}, "message"))
     , mShuttingDown(false)
 {
 }
@@ -67,11 +72,13 @@ Floodgate::addRecord(StellarMessage const& msg, Peer::pointer peer)
         mFloodMap[index] = std::make_shared<FloodRecord>(
             msg, mApp.getHerder().getCurrentLedgerSeq(), peer);
         mFloodMapSize.set_count(mFloodMap.size());
+        mRecvUnique.Mark();
         return true;
     }
     else
     {
         result->second->mPeersTold.insert(peer);
+        mRecvDuplicate.Mark();
         return false;
     }
 }
@@ -48,6 +48,8 @@ class Floodgate
     Application& mApp;
     medida::Counter& mFloodMapSize;
     medida::Meter& mSendFromBroadcast;
+    medida::Meter& mRecvUnique;
+    medida::Meter& mRecvDuplicate;
     bool mShuttingDown;
 
   public:
@@ -4,6 +4,7 @@
 
 #include "overlay/ItemFetcher.h"
 #include "main/Application.h"
+#include "main/Config.h"
 #include "overlay/OverlayManager.h"
 #include "util/Logging.h"
 #include "medida/metrics_registry.h"
@@ -14,6 +15,8 @@
 #include "herder/Herder.h"
 #include "xdrpp/marshal.h"
 
+#include <algorithm>
+
 namespace stellar
 {
 
@@ -115,6 +118,7 @@ ItemFetcher<TrackerT>::recv(uint256 itemID)
         }
         // stop the timer, stop requesting the item as we have it
         iter->second->mTimer.cancel();
+        iter->second->cancelAsks(false);
     }
 }
 
@@ -133,6 +137,7 @@ Tracker::Tracker(Application& app, uint256 const& id)
 Tracker::~Tracker()
 {
     mTimer.cancel();
+    cancelAsks(false);
 }
 
 // returns false if no one cares about this guy anymore
@@ -157,7 +162,7 @@ Tracker::clearEnvelopesBelow(uint64 slotIndex)
     }
 
     mTimer.cancel();
-    mLastAskedPeer = nullptr;
+    cancelAsks(false);
     mIsStopped = true;
 
     return false;
@@ -166,27 +171,30 @@ Tracker::clearEnvelopesBelow(uint64 slotIndex)
 void
 Tracker::doesntHave(Peer::pointer peer)
 {
-    if (mLastAskedPeer == peer)
+    auto it = std::find(mAskedPeers.begin(), mAskedPeers.end(), peer);
+    if (it != mAskedPeers.end())
     {
         CLOG(TRACE, "Overlay") << "Does not have " << hexAbbrev(mItemID);
-        tryNextPeer();
+        mAskedPeers.erase(it);
+        // replace the peer right away; only wait out the back-off if
+        // everyone we asked in this round said no
+        if (askMorePeers() || mAskedPeers.empty())
+        {
+            scheduleNextTry();
+        }
     }
 }
 
 void
 Tracker::tryNextPeer()
 {
-    // will be called by some timer or when we get a
-    // response saying they don't have it
-    Peer::pointer peer;
-
-    CLOG(TRACE, "Overlay") << "tryNextPeer " << hexAbbrev(mItemID) << " last: "
-                           << (mLastAskedPeer ? mLastAskedPeer->toString()
-                                              : "<none>");
+    // will be called by some timer or when we start fetching the item
+    CLOG(TRACE, "Overlay") << "tryNextPeer " << hexAbbrev(mItemID)
+                           << " outstanding: " << mAskedPeers.size();
 
     // if we don't have a list of peers to ask and we're not
     // currently asking peers, build a new list
-    if (mPeersToAsk.empty() && !mLastAskedPeer)
+    if (mPeersToAsk.empty() && mAskedPeers.empty())
     {
         std::set<std::shared_ptr<Peer>> peersWithEnvelope;
         for (auto const& e : mWaitingEnvelopes)
@@ -195,21 +203,29 @@ Tracker::tryNextPeer()
             peersWithEnvelope.insert(s.begin(), s.end());
         }
 
-        mPeersToAsk.clear();
-
-        // move the peers that have the envelope to the back,
-        // to be processed first
-        for (auto const& p : mApp.getOverlayManager().getRandomPeers())
+        // peers that have the envelope are the most likely to have the item,
+        // then prefer peers that answered quickly in the past; peers we know
+        // nothing about rank in the middle. Best candidates go to the back,
+        // to be processed first.
+        auto latency = [](Peer::pointer const& p)
         {
-            if (peersWithEnvelope.find(p) != peersWithEnvelope.end())
-            {
-                mPeersToAsk.emplace_back(p);
-            }
-            else
+            auto l = p->getFetchLatencyMs();
+            return l < 0 ? MS_TO_WAIT_FOR_FETCH_REPLY.count() / 2.0 : l;
+        };
+        auto peers = mApp.getOverlayManager().getRandomPeers();
+        std::stable_sort(
+            peers.begin(), peers.end(),
+            [&](Peer::pointer const& a, Peer::pointer const& b)
             {
-                mPeersToAsk.emplace_front(p);
-            }
-        }
+                bool aHas = peersWithEnvelope.find(a) != peersWithEnvelope.end();
+                bool bHas = peersWithEnvelope.find(b) != peersWithEnvelope.end();
+                if (aHas != bHas)
+                {
+                    return bHas;
+                }
+                return latency(a) > latency(b);
+            });
+        mPeersToAsk.assign(peers.begin(), peers.end());
 
         mNumListRebuild++;
 
@@ -219,21 +235,53 @@ Tracker::tryNextPeer()
         mTryNextPeerReset.Mark();
     }
 
-    while (!peer && !mPeersToAsk.empty())
+    // anyone still outstanding at this point did not answer in time
+    cancelAsks(true);
+    askMorePeers();
+    scheduleNextTry();
+}
+
+bool
+Tracker::askMorePeers()
+{
+    size_t parallel =
+        std::max<size_t>(1, mApp.getConfig().FETCH_PEERS_IN_PARALLEL);
+    bool asked = false;
+    while (mAskedPeers.size() < parallel && !mPeersToAsk.empty())
     {
-        peer = mPeersToAsk.back();
+        auto peer = mPeersToAsk.back();
+        mPeersToAsk.pop_back();
         if (!peer->isAuthenticated())
         {
-            peer.reset();
+            continue;
         }
-        mPeersToAsk.pop_back();
+
+        CLOG(TRACE, "Overlay") << "Asking for " << hexAbbrev(mItemID) << " to "
+                               << peer->toString();
+        mTryNextPeer.Mark();
+        mAskedPeers.push_back(peer);
+        askPeer(peer);
+        asked = true;
     }
+    return asked;
+}
 
+void
+Tracker::cancelAsks(bool timedOut)
+{
+    for (auto const& peer : mAskedPeers)
+    {
+        peer->cancelFetchRequest(mItemID, timedOut);
+    }
+    mAskedPeers.clear();
+}
+
+void
+Tracker::scheduleNextTry()
+{
     std::chrono::milliseconds nextTry;
-    if (!peer)
-    { // we have asked all our peers
-        // clear mLastAskedPeer so that we rebuild a new list
-        mLastAskedPeer.reset();
+    if (mAskedPeers.empty())
+    { // we have asked all our peers, back off before building a new list
         if (mNumListRebuild > MAX_REBUILD_FETCH_LIST)
         {
             nextTry = MS_TO_WAIT_FOR_FETCH_REPLY * MAX_REBUILD_FETCH_LIST;
@@ -245,11 +293,6 @@ Tracker::tryNextPeer()
     }
     else
     {
-        mLastAskedPeer = peer;
-        CLOG(TRACE, "Overlay") << "Asking for " << hexAbbrev(mItemID) << " to "
-                               << peer->toString();
-        mTryNextPeer.Mark();
-        askPeer(peer);
         nextTry = MS_TO_WAIT_FOR_FETCH_REPLY;
     }
 
@@ -44,7 +44,8 @@ class Tracker
   protected:
     template <class T> friend class ItemFetcher;
     Application& mApp;
-    Peer::pointer mLastAskedPeer;
+    // peers asked in the current round that have not answered yet
+    std::vector<Peer::pointer> mAskedPeers;
     int mNumListRebuild;
     std::deque<Peer::pointer> mPeersToAsk;
     VirtualTimer mTimer;
@@ -63,6 +64,14 @@ class Tracker
     void doesntHave(Peer::pointer peer);
     void tryNextPeer();
 
+    // ask peers from mPeersToAsk until FETCH_PEERS_IN_PARALLEL requests are
+    // outstanding; returns true if any new peer was asked
+    bool askMorePeers();
+    // forget all outstanding requests, charging the peers for the time they
+    // took if they didn't answer in time
+    void cancelAsks(bool timedOut);
+    void scheduleNextTry();
+
   public:
     explicit Tracker(Application& app, uint256 const& id);
 
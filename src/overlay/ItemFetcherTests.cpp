@@ -11,6 +11,7 @@
 #include <crypto/SHA.h>
 #include <crypto/Hex.h>
 #include "test/test_marshaler.h"
+#include <algorithm>
 
 namespace stellar
 {
@@ -127,4 +128,163 @@ activity")
     }
 }
 */
+
+namespace
+{
+// An application connected over loopback to four others, which never answer
+// it, so that its fetch requests stay outstanding until the tracker gives up
+// on them.
+class ItemFetcherTests
+{
+  protected:
+    VirtualClock mClock;
+    Application::pointer mApp;
+    std::vector<Application::pointer> mRemotes;
+    std::vector<std::shared_ptr<LoopbackPeerConnection>> mConnections;
+    std::vector<Peer::pointer> mPeers;
+    SCPEnvelope mEnvelope;
+
+    ItemFetcherTests()
+    {
+        Config cfg = getTestConfig(0);
+        cfg.FETCH_PEERS_IN_PARALLEL = 2;
+        // the envelope waiting for the item isn't a real one
+        cfg.MANUAL_CLOSE = true;
+        mApp = Application::create(mClock, cfg);
+        for (int i = 1; i <= 4; i++)
+        {
+            mRemotes.push_back(Application::create(mClock, getTestConfig(i)));
+            mConnections.push_back(std::make_shared<LoopbackPeerConnection>(
+                *mApp, *mRemotes.back()));
+            mPeers.push_back(mConnections.back()->getInitiator());
+        }
+        while (std::any_of(mPeers.begin(), mPeers.end(),
+                           [](Peer::pointer const& p) {
+                               return !p->isAuthenticated();
+                           }))
+        {
+            mClock.crank(false);
+        }
+        for (auto const& c : mConnections)
+        {
+            c->getAcceptor()->setCorked(true);
+        }
+        mEnvelope.statement.slotIndex = 1;
+    }
+
+    std::vector<Peer::pointer>
+    fetching(uint256 const& itemID)
+    {
+        std::vector<Peer::pointer> res;
+        std::copy_if(mPeers.begin(), mPeers.end(), std::back_inserter(res),
+                     [&](Peer::pointer const& p) {
+                         return p->isFetching(itemID);
+                     });
+        return res;
+    }
+
+    void
+    crankFor(std::chrono::milliseconds d)
+    {
+        bool done = false;
+        VirtualTimer timer(*mApp);
+        timer.expires_from_now(d);
+        timer.async_wait([&]() { done = true; }, VirtualTimer::onFailureNoop);
+        while (!done)
+        {
+            mClock.crank(true);
+        }
+    }
+};
+}
+
+TEST_CASE_METHOD(ItemFetcherTests, "fetcher asks peers in parallel",
+                 "[overlay][fetcher]")
+{
+    ItemFetcher<TxSetTracker> fetcher(*mApp);
+    Hash item = sha256(ByteSlice("item"));
+    fetcher.fetch(item, mEnvelope);
+
+    auto first = fetching(item);
+    REQUIRE(first.size() == 2);
+
+    SECTION("and asks the others once they time out")
+    {
+        crankFor(std::chrono::milliseconds(1600));
+        auto second = fetching(item);
+        REQUIRE(second.size() == 2);
+        for (auto const& p : first)
+        {
+            REQUIRE(std::find(second.begin(), second.end(), p) ==
+                    second.end());
+            // a timed out request counts as a latency sample
+            REQUIRE(p->getFetchLatencyMs() >= 1500);
+        }
+    }
+
+    SECTION("and cancels the other requests when the item arrives")
+    {
+        fetcher.recv(item);
+        REQUIRE(fetching(item).empty());
+        for (auto const& p : first)
+        {
+            REQUIRE(p->getFetchLatencyMs() < 0);
+        }
+    }
+
+    SECTION("and cancels them when the tracker is dropped")
+    {
+        fetcher.stopFetchingBelow(2);
+        crankFor(std::chrono::milliseconds(1));
+        REQUIRE(fetching(item).empty());
+    }
+}
+
+TEST_CASE_METHOD(ItemFetcherTests, "dropped fetcher cancels its requests",
+                 "[overlay][fetcher]")
+{
+    Hash item = sha256(ByteSlice("item"));
+    {
+        ItemFetcher<TxSetTracker> fetcher(*mApp);
+        fetcher.fetch(item, mEnvelope);
+        REQUIRE(fetching(item).size() == 2);
+    }
+    REQUIRE(fetching(item).empty());
+}
+
+TEST_CASE_METHOD(ItemFetcherTests, "fetcher asks the fastest peers first",
+                 "[overlay][fetcher]")
+{
+    // peer i takes (4 - i) * 100ms to time out on a probe
+    Hash probe = sha256(ByteSlice("probe"));
+    for (auto const& p : mPeers)
+    {
+        p->sendGetTxSet(probe);
+    }
+    for (auto it = mPeers.rbegin(); it != mPeers.rend(); ++it)
+    {
+        crankFor(std::chrono::milliseconds(100));
+        (*it)->cancelFetchRequest(probe, true);
+    }
+    for (size_t i = 1; i < mPeers.size(); i++)
+    {
+        REQUIRE(mPeers[i - 1]->getFetchLatencyMs() >
+                mPeers[i]->getFetchLatencyMs());
+    }
+
+    ItemFetcher<QuorumSetTracker> fetcher(*mApp);
+    Hash item = sha256(ByteSlice("item"));
+    fetcher.fetch(item, mEnvelope);
+    auto asked = fetching(item);
+    REQUIRE(asked.size() == 2);
+    REQUIRE(std::find(asked.begin(), asked.end(), mPeers[2]) != asked.end());
+    REQUIRE(std::find(asked.begin(), asked.end(), mPeers[3]) != asked.end());
+
+    // then the slower ones, once the fast ones time out
+    crankFor(std::chrono::milliseconds(1600));
+    asked = fetching(item);
+    REQUIRE(asked.size() == 2);
+    REQUIRE(std::find(asked.begin(), asked.end(), mPeers[0]) != asked.end());
+    REQUIRE(std::find(asked.begin(), asked.end(), mPeers[1]) != asked.end());
+}
 }
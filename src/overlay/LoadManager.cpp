@@ -8,9 +8,12 @@
 #include "overlay/LoadManager.h"
 #include "overlay/OverlayManager.h"
 #include "util/Logging.h"
+#include "util/make_unique.h"
 #include "util/types.h"
 #include "lib/util/format.h"
 
+#include <algorithm>
+#include <cctype>
 #include <chrono>
 
 namespace stellar
@@ -52,6 +55,14 @@ timeMag(uint64_t nanos)
     return "0";
 }
 
+std::string
+LoadManager::messageTypeName(MessageType type)
+{
+    std::string name = xdr::xdr_traits<MessageType>::enum_name(type);
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    return name;
+}
+
 void
 LoadManager::reportLoads(std::vector<Peer::pointer> const& peers,
                          Application& app)
@@ -61,18 +72,37 @@ LoadManager::reportLoads(std::vector<Peer::pointer> const& peers,
     CLOG(INFO, "Overlay")
         << "------------------------------------------------------";
     CLOG(INFO, "Overlay") << fmt::format(
-        "{:>10s} {:>10s} {:>10s} {:>10s} {:>10s}", "peer", "time", "send",
-        "recv", "query");
+        "{:>10s} {:>10s} {:>10s} {:>10s} {:>10s} {:>10s}", "peer", "time",
+        "send", "recv", "query", "queued");
     for (auto const& peer : peers)
     {
         auto cost = getPeerCosts(peer->getPeerID());
         CLOG(INFO, "Overlay") << fmt::format(
-            "{:>10s} {:>10s} {:>10s} {:>10s} {:>10d}",
+            "{:>10s} {:>10s} {:>10s} {:>10s} {:>10d} {:>10s}",
             app.getConfig().toShortString(peer->getPeerID()),
             timeMag(static_cast<uint64_t>(cost->mTimeSpent.one_minute_rate())),
             byteMag(static_cast<uint64_t>(cost->mBytesSend.one_minute_rate())),
             byteMag(static_cast<uint64_t>(cost->mBytesRecv.one_minute_rate())),
-            cost->mSQLQueries.count());
+            cost->mSQLQueries.count(),
+            byteMag(peer->getOutboundQueueBytes()));
+    }
+    CLOG(INFO, "Overlay") << "";
+    CLOG(INFO, "Overlay") << "Cumulative message-type costs:";
+    CLOG(INFO, "Overlay")
+        << "------------------------------------------------------";
+    CLOG(INFO, "Overlay") << fmt::format(
+        "{:>18s} {:>10s} {:>10s} {:>10s} {:>10s}", "type", "time", "send",
+        "recv", "query");
+    for (auto const& kv : mMessageTypeMeters)
+    {
+        auto const& m = *kv.second;
+        CLOG(INFO, "Overlay") << fmt::format(
+            "{:>18s} {:>10s} {:>10s} {:>10s} {:>10d}",
+            messageTypeName(kv.first),
+            timeMag(static_cast<uint64_t>(m.mTimeSpent.one_minute_rate())),
+            byteMag(static_cast<uint64_t>(m.mBytesSend.one_minute_rate())),
+            byteMag(static_cast<uint64_t>(m.mBytesRecv.one_minute_rate())),
+            m.mSQLQueries.count());
     }
     CLOG(INFO, "Overlay") << "";
 }
@@ -100,16 +130,78 @@ LoadManager::maybeShedExcessLoad(Application& app)
         auto peers = app.getOverlayManager().getPeers();
         reportLoads(peers, app);
 
-        // Look for the worst-behaved of the current peers and kick them out.
+        // A peer that has let more than half of its outbound queue budget
+        // pile up is holding on to our memory while lagging behind on
+        // consensus; prefer shedding it over the most expensive peer.
         std::shared_ptr<Peer> victim;
-        std::shared_ptr<LoadManager::PeerCosts> victimCost;
+        size_t victimQueued = app.getConfig().MAX_PEER_OUTBOUND_QUEUE_BYTES / 2;
         for (auto peer : peers)
         {
-            auto peerCost = getPeerCosts(peer->getPeerID());
-            if (!victim || victimCost->isLessThan(peerCost))
+            auto queued = peer->getOutboundQueueBytes();
+            if (queued > victimQueued)
             {
                 victim = peer;
-                victimCost = peerCost;
+                victimQueued = queued;
+            }
+        }
+
+        // Otherwise find the class of message that has recently cost us the
+        // most time, and the peer that has been sending us the most of it.
+        if (!victim)
+        {
+            MessageType worstType = MessageType::ERROR_MSG;
+            double worstRate = 0;
+            for (auto const& kv : mMessageTypeMeters)
+            {
+                auto rate = kv.second->mTimeSpent.one_minute_rate();
+                if (rate > worstRate)
+                {
+                    worstType = kv.first;
+                    worstRate = rate;
+                }
+            }
+
+            double victimRate = 0;
+            if (worstRate > 0)
+            {
+                for (auto peer : peers)
+                {
+                    auto peerCost = getPeerCosts(peer->getPeerID());
+                    auto it = peerCost->mMessageCosts.find(worstType);
+                    if (it == peerCost->mMessageCosts.end())
+                    {
+                        continue;
+                    }
+                    auto rate = it->second.mTimeSpent.one_minute_rate();
+                    if (rate > victimRate)
+                    {
+                        victim = peer;
+                        victimRate = rate;
+                    }
+                }
+            }
+
+            if (victim)
+            {
+                CLOG(WARNING, "Overlay")
+                    << "Most expensive message type is "
+                    << messageTypeName(worstType);
+            }
+        }
+
+        // Failing that look for the worst-behaved of the current peers and
+        // kick them out.
+        if (!victim)
+        {
+            std::shared_ptr<LoadManager::PeerCosts> victimCost;
+            for (auto peer : peers)
+            {
+                auto peerCost = getPeerCosts(peer->getPeerID());
+                if (!victim || victimCost->isLessThan(peerCost))
+                {
+                    victim = peer;
+                    victimCost = peerCost;
+                }
             }
         }
 
@@ -136,6 +228,27 @@ LoadManager::PeerCosts::PeerCosts()
 {
 }
 
+LoadManager::MessageCosts::MessageCosts()
+    : mTimeSpent("nanoseconds")
+    , mBytesSend("byte")
+    , mBytesRecv("byte")
+    , mSQLQueries("query")
+{
+}
+
+LoadManager::MessageTypeMeters::MessageTypeMeters(Application& app,
+                                                  MessageType type)
+    : mTimeSpent(app.getMetrics().NewMeter(
+          {"overlay", "cost-time", messageTypeName(type)}, "nanoseconds"))
+    , mBytesSend(app.getMetrics().NewMeter(
+          {"overlay", "cost-send", messageTypeName(type)}, "byte"))
+    , mBytesRecv(app.getMetrics().NewMeter(
+          {"overlay", "cost-recv", messageTypeName(type)}, "byte"))
+    , mSQLQueries(app.getMetrics().NewMeter(
+          {"overlay", "cost-query", messageTypeName(type)}, "query"))
+{
+}
+
 bool
 LoadManager::PeerCosts::isLessThan(
     std::shared_ptr<LoadManager::PeerCosts> other)
@@ -163,6 +276,36 @@ LoadManager::getPeerCosts(NodeID const& node)
     return p;
 }
 
+LoadManager::MessageTypeMeters&
+LoadManager::getMessageTypeMeters(Application& app, MessageType type)
+{
+    auto& meters = mMessageTypeMeters[type];
+    if (!meters)
+    {
+        meters = make_unique<MessageTypeMeters>(app, type);
+    }
+    return *meters;
+}
+
+void
+LoadManager::debitMessageCosts(Application& app, NodeID const& peer,
+                               MessageType type, uint64_t timeNs,
+                               uint64_t bytesSend, uint64_t bytesRecv,
+                               uint64_t queries)
+{
+    auto& mc = getPeerCosts(peer)->mMessageCosts[type];
+    mc.mTimeSpent.Mark(timeNs);
+    mc.mBytesSend.Mark(bytesSend);
+    mc.mBytesRecv.Mark(bytesRecv);
+    mc.mSQLQueries.Mark(queries);
+
+    auto& tm = getMessageTypeMeters(app, type);
+    tm.mTimeSpent.Mark(timeNs);
+    tm.mBytesSend.Mark(bytesSend);
+    tm.mBytesRecv.Mark(bytesRecv);
+    tm.mSQLQueries.Mark(queries);
+}
+
 LoadManager::PeerContext::PeerContext(Application& app, NodeID const& node)
     : mApp(app)
     , mNode(node)
@@ -193,6 +336,20 @@ LoadManager::PeerContext::~PeerContext()
         pc->mBytesSend.Mark(send);
         pc->mBytesRecv.Mark(recv);
         pc->mSQLQueries.Mark(query);
+        if (mHaveMessageType)
+        {
+            mApp.getOverlayManager().getLoadManager().debitMessageCosts(
+                mApp, mNode, mMessageType, time.count(), 0, mMessageBytes,
+                query);
+        }
     }
 }
+
+void
+LoadManager::PeerContext::setMessage(MessageType type, size_t bytes)
+{
+    mHaveMessageType = true;
+    mMessageType = type;
+    mMessageBytes = bytes;
+}
 }
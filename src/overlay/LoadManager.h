@@ -16,6 +16,9 @@
 
 #include "util/Timer.h"
 
+#include <map>
+#include <memory>
+
 namespace stellar
 {
 
@@ -40,6 +43,22 @@ class LoadManager
     ~LoadManager();
     void reportLoads(std::vector<Peer::pointer> const& peers, Application& app);
 
+    // The name a message type's costs are reported under, both in the
+    // overlay.cost-* metrics and by the peers command.
+    static std::string messageTypeName(MessageType type);
+
+    // Costs incurred handling a single type of message, so that a peer
+    // flooding transactions can be told apart from one hammering us with
+    // GET_TX_SET or GET_SCP_STATE.
+    struct MessageCosts
+    {
+        MessageCosts();
+        medida::Meter mTimeSpent;
+        medida::Meter mBytesSend;
+        medida::Meter mBytesRecv;
+        medida::Meter mSQLQueries;
+    };
+
     // We track the costs incurred by each peer in a PeerCosts structure,
     // and keep these in an LRU cache to avoid overfilling the LoadManager
     // should we have ongoing churn in low-cost peers.
@@ -51,13 +70,41 @@ class LoadManager
         medida::Meter mBytesSend;
         medida::Meter mBytesRecv;
         medida::Meter mSQLQueries;
+
+        // The same costs, broken down by the type of message they were
+        // incurred for.
+        std::map<MessageType, MessageCosts> mMessageCosts;
     };
 
     std::shared_ptr<PeerCosts> getPeerCosts(NodeID const& peer);
 
+    // Debits peer, and the registry-wide totals for type, with the cost of
+    // handling or sending one message of that type.
+    void debitMessageCosts(Application& app, NodeID const& peer,
+                           MessageType type, uint64_t timeNs,
+                           uint64_t bytesSend, uint64_t bytesRecv,
+                           uint64_t queries);
+
   private:
     cache::lru_cache<NodeID, std::shared_ptr<PeerCosts>> mPeerCosts;
 
+    // Per message type totals across all peers. These live in the metrics
+    // registry, so they show up in the metrics command, and are what
+    // load-shedding looks at to find the most expensive class of traffic.
+    struct MessageTypeMeters
+    {
+        MessageTypeMeters(Application& app, MessageType type);
+        medida::Meter& mTimeSpent;
+        medida::Meter& mBytesSend;
+        medida::Meter& mBytesRecv;
+        medida::Meter& mSQLQueries;
+    };
+    std::map<MessageType, std::unique_ptr<MessageTypeMeters>>
+        mMessageTypeMeters;
+
+    MessageTypeMeters& getMessageTypeMeters(Application& app,
+                                            MessageType type);
+
   public:
     // Measure recent load on the system and, if the system appears
     // overloaded, shed one or more of the worst-behaved peers,
@@ -77,9 +124,17 @@ class LoadManager
         std::uint64_t mBytesRecvStart;
         std::uint64_t mSQLQueriesStart;
 
+        bool mHaveMessageType{false};
+        MessageType mMessageType;
+        size_t mMessageBytes{0};
+
       public:
         PeerContext(Application& app, NodeID const& node);
         ~PeerContext();
+
+        // Once the message being handled has been decoded, also debit its
+        // type with the cost of this context.
+        void setMessage(MessageType type, size_t bytes);
     };
 };
 }
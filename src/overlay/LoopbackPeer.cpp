@@ -23,7 +23,10 @@ using namespace std;
 // LoopbackPeer
 ///////////////////////////////////////////////////////////////////////
 
-LoopbackPeer::LoopbackPeer(Application& app, PeerRole role) : Peer(app, role)
+LoopbackPeer::LoopbackPeer(Application& app, PeerRole role)
+    : Peer(app, role)
+    , mHopLatency(
+          app.getMetrics().NewTimer({"overlay", "loopback", "hop-latency"}))
 {
 }
 
@@ -121,7 +124,9 @@ LoopbackPeer::processInQueue()
 {
     if (!mInQueue.empty() && mState != CLOSING)
     {
-        auto const& m = mInQueue.front();
+        auto const& m = mInQueue.front().first;
+        mHopLatency.Update(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - mInQueue.front().second));
         receivedBytes(m->size(), true);
         recvMessage(m);
         mInQueue.pop();
@@ -196,7 +201,8 @@ LoopbackPeer::deliverOne()
         if (remote)
         {
             // move msg to remote's in queue
-            remote->mInQueue.emplace(std::move(msg));
+            remote->mInQueue.emplace(std::move(msg),
+                                     std::chrono::steady_clock::now());
             remote->getApp().getClock().getIOService().post(
                 [remote]()
                 {
@@ -5,6 +5,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "overlay/Peer.h"
+#include <chrono>
 #include <deque>
 #include <random>
 
@@ -26,7 +27,12 @@ class LoopbackPeer : public Peer
   private:
     std::weak_ptr<LoopbackPeer> mRemote;
     std::deque<xdr::msg_ptr> mOutQueue; // sending queue
-    std::queue<xdr::msg_ptr> mInQueue;  // receiving queue
+    // receiving queue, with the wall-clock time each message was delivered
+    std::queue<std::pair<xdr::msg_ptr, std::chrono::steady_clock::time_point>>
+        mInQueue;
+
+    // wall-clock time from delivery until the remote processes a message
+    medida::Timer& mHopLatency;
 
     bool mCorked{false};
     size_t mMaxQueueDepth{0};
@@ -0,0 +1,107 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/MessageCompressor.h"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "util/Logging.h"
+
+#include "medida/histogram.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
+#include <cstring>
+#include <zlib.h>
+
+namespace stellar
+{
+
+MessageCompressor::MessageCompressor(Application& app)
+    : mApp(app)
+    , mCompressTimer(
+          app.getMetrics().NewTimer({"overlay", "compress", "time"}))
+    , mDecompressTimer(
+          app.getMetrics().NewTimer({"overlay", "decompress", "time"}))
+    , mCompressRatio(
+          app.getMetrics().NewHistogram({"overlay", "compress", "ratio"}))
+    , mBytesSaved(
+          app.getMetrics().NewMeter({"overlay", "compress", "saved"}, "byte"))
+    , mNotCompressed(app.getMetrics().NewMeter(
+          {"overlay", "compress", "incompressible"}, "message"))
+{
+}
+
+xdr::msg_ptr
+MessageCompressor::compress(xdr::msg_ptr const& msg)
+{
+    auto threshold = mApp.getConfig().OVERLAY_COMPRESSION_THRESHOLD;
+    if (threshold == 0 || msg->size() < threshold)
+    {
+        return xdr::msg_ptr();
+    }
+
+    auto t = mCompressTimer.TimeScope();
+
+    uLong srcSize = static_cast<uLong>(msg->size());
+    uLongf bound = compressBound(srcSize);
+    std::vector<uint8_t> buf(4 + bound);
+    buf[0] = static_cast<uint8_t>(srcSize >> 24);
+    buf[1] = static_cast<uint8_t>(srcSize >> 16);
+    buf[2] = static_cast<uint8_t>(srcSize >> 8);
+    buf[3] = static_cast<uint8_t>(srcSize);
+
+    // favour speed: these bytes are about to go over the wire and most of
+    // the gain comes from repeated account IDs and asset codes
+    int res = compress2(buf.data() + 4, &bound,
+                        reinterpret_cast<Bytef const*>(msg->data()), srcSize,
+                        Z_BEST_SPEED);
+    if (res != Z_OK || 4 + bound >= msg->size())
+    {
+        mNotCompressed.Mark();
+        return xdr::msg_ptr();
+    }
+
+    auto compressed = xdr::message_t::alloc(4 + bound);
+    memcpy(compressed->data(), buf.data(), 4 + bound);
+    compressed->raw_data()[0] |= static_cast<char>(COMPRESSED_MESSAGE_FLAG >> 24);
+
+    mCompressRatio.Update((100 * compressed->size()) / msg->size());
+    mBytesSaved.Mark(msg->size() - compressed->size());
+    return compressed;
+}
+
+bool
+MessageCompressor::decompress(std::vector<uint8_t> const& body,
+                              std::vector<uint8_t>& out, size_t maxSize)
+{
+    auto t = mDecompressTimer.TimeScope();
+
+    if (body.size() < 4)
+    {
+        return false;
+    }
+    size_t size = (static_cast<size_t>(body[0]) << 24) |
+                  (static_cast<size_t>(body[1]) << 16) |
+                  (static_cast<size_t>(body[2]) << 8) |
+                  static_cast<size_t>(body[3]);
+    if (size == 0 || size > maxSize)
+    {
+        CLOG(ERROR, "Overlay")
+            << "compressed message inflates to unacceptable size: " << size;
+        return false;
+    }
+
+    out.resize(size);
+    uLongf outSize = static_cast<uLongf>(size);
+    int res = uncompress(out.data(), &outSize, body.data() + 4,
+                         static_cast<uLong>(body.size() - 4));
+    if (res != Z_OK || outSize != size)
+    {
+        CLOG(ERROR, "Overlay") << "failed to decompress message: " << res;
+        return false;
+    }
+    return true;
+}
+}
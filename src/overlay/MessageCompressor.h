@@ -0,0 +1,58 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "xdrpp/message.h"
+#include <cstdint>
+#include <vector>
+
+namespace medida
+{
+class Histogram;
+class Meter;
+class Timer;
+}
+
+namespace stellar
+{
+
+class Application;
+
+// Optional compression of large overlay messages between peers that both
+// announce OVERLAY_PROTOCOL_COMPRESSION_VERSION or later in their HELLO.
+//
+// A compressed message travels in the same record-marked frame as any other
+// message, with COMPRESSED_MESSAGE_FLAG set in the record mark. Message
+// lengths never reach that bit, so uncompressed frames are unaffected. The
+// frame body is the 4-byte big-endian length of the serialized
+// AuthenticatedMessage followed by its zlib stream. Compression is applied
+// to the already-authenticated message, so MACs and sequence numbers are
+// computed exactly as without it.
+class MessageCompressor
+{
+    Application& mApp;
+
+    medida::Timer& mCompressTimer;
+    medida::Timer& mDecompressTimer;
+    medida::Histogram& mCompressRatio;
+    medida::Meter& mBytesSaved;
+    medida::Meter& mNotCompressed;
+
+  public:
+    static uint32_t const OVERLAY_PROTOCOL_COMPRESSION_VERSION = 6;
+    static uint32_t const COMPRESSED_MESSAGE_FLAG = 0x40000000;
+
+    explicit MessageCompressor(Application& app);
+
+    // Returns a compressed frame for msg, or an empty pointer if msg is
+    // below OVERLAY_COMPRESSION_THRESHOLD or doesn't shrink.
+    xdr::msg_ptr compress(xdr::msg_ptr const& msg);
+
+    // Decompresses the body of a compressed frame into out. Returns false if
+    // the body is malformed or would inflate to more than maxSize bytes.
+    bool decompress(std::vector<uint8_t> const& body,
+                    std::vector<uint8_t>& out, size_t maxSize);
+};
+}
@@ -5,6 +5,7 @@
 #include "main/Application.h"
 #include "overlay/LoopbackPeer.h"
 #include "main/test.h"
+#include "overlay/LoadManager.h"
 #include "overlay/OverlayManagerImpl.h"
 #include "BanManager.h"
 #include "test/test_marshaler.h"
@@ -37,6 +38,32 @@ TEST_CASE("loopback peer hello", "[overlay]")
     REQUIRE(conn.getAcceptor()->isAuthenticated());
 }
 
+TEST_CASE("peer costs are tracked per message type", "[overlay]")
+{
+    VirtualClock clock;
+    Config const& cfg1 = getTestConfig(0);
+    Config const& cfg2 = getTestConfig(1);
+    auto app1 = Application::create(clock, cfg1);
+    auto app2 = Application::create(clock, cfg2);
+
+    LoopbackPeerConnection conn(*app1, *app2);
+    crankSome(clock);
+    REQUIRE(conn.getAcceptor()->isAuthenticated());
+
+    auto recvCosts = app2->getOverlayManager().getLoadManager().getPeerCosts(
+        cfg1.NODE_SEED.getPublicKey());
+    REQUIRE(recvCosts->mMessageCosts[MessageType::AUTH].mBytesRecv.count() !=
+            0);
+    REQUIRE(app2->getMetrics()
+                .NewMeter({"overlay", "cost-recv", "auth"}, "byte")
+                .count() != 0);
+
+    auto sendCosts = app1->getOverlayManager().getLoadManager().getPeerCosts(
+        cfg2.NODE_SEED.getPublicKey());
+    REQUIRE(sendCosts->mMessageCosts[MessageType::AUTH].mBytesSend.count() !=
+            0);
+}
+
 TEST_CASE("failed auth", "[overlay]")
 {
     VirtualClock clock;
@@ -0,0 +1,257 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/Herder.h"
+#include "herder/TxSetFrame.h"
+#include "ledger/AccountHelper.h"
+#include "ledger/LedgerDelta.h"
+#include "ledger/LedgerManager.h"
+#include "lib/util/format.h"
+#include "main/Application.h"
+#include "main/test.h"
+#include "overlay/OverlayManager.h"
+#include "simulation/Simulation.h"
+#include "simulation/Topologies.h"
+#include "test/test_marshaler.h"
+#include "util/Logging.h"
+#include "xdrpp/marshal.h"
+
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/stats/snapshot.h"
+#include "medida/timer.h"
+
+#include <algorithm>
+#include <chrono>
+
+// In-process overlay benchmark: floods a mix of transactions and SCP
+// nominations through N nodes connected by LoopbackPeers and reports
+// throughput, per-hop latency, flood duplication and main-thread load.
+// Run it with
+//
+//     --test [overlaybench]
+//
+
+namespace stellar
+{
+using namespace txtest;
+
+namespace
+{
+
+struct OverlayBenchResult
+{
+    double mMessagesPerSec;
+    double mBytesPerSec;
+    double mHopLatency50;
+    double mHopLatency95;
+    double mHopLatency99;
+    double mDuplication;
+    uint32_t mBusyPercent;
+};
+
+double
+percentile(std::vector<double> const& sorted, double q)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    auto pos = static_cast<size_t>(q * (sorted.size() - 1));
+    return sorted[pos];
+}
+
+OverlayBenchResult
+runOverlayBench(int numNodes, size_t numMessages, double txFraction)
+{
+    Hash networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+
+    // keep ledgers from closing while we flood
+    int cfgCount = 0;
+    auto cfgGen = [&]()
+    {
+        Config cfg = getTestConfig(cfgCount++);
+        cfg.ARTIFICIALLY_SET_CLOSE_TIME_FOR_TESTING = 10000;
+        cfg.MAX_PEER_CONNECTIONS = 1000;
+        return cfg;
+    };
+
+    // a cycle, so that floods take several hops and duplicates happen
+    auto simulation = Topologies::cycle(numNodes, 1.0, Simulation::OVER_LOOPBACK,
+                                        networkID, cfgGen);
+    simulation->startAllNodes();
+    auto nodes = simulation->getNodes();
+
+    // one source account per message, cloned from the root account on every
+    // node, as in the flooding tests
+    std::vector<SecretKey> sources;
+    std::vector<PublicKey> sourcesPub;
+    {
+        auto accountHelper = AccountHelper::Instance();
+        auto rootA = accountHelper->loadAccount(getRoot().getPublicKey(),
+                                                nodes[0]->getDatabase());
+        LedgerEntry gen(rootA->mEntry);
+        auto& account = gen.data.account();
+        for (size_t i = 0; i < numMessages; i++)
+        {
+            sources.emplace_back(SecretKey::random());
+            sourcesPub.emplace_back(sources.back().getPublicKey());
+            account.accountID = sourcesPub.back();
+            for (auto n : nodes)
+            {
+                LedgerHeader lh;
+                Database& db = n->getDatabase();
+                LedgerDelta delta(lh, db, false);
+                EntryHelperProvider::storeAddEntry(delta, db, gen);
+            }
+        }
+    }
+
+    // enough for connections to be made
+    simulation->crankForAtLeast(std::chrono::seconds(1), false);
+
+    auto injectTransaction = [&](size_t i, Application& app)
+    {
+        SecretKey dest = SecretKey::random();
+        auto tx = createCreateAccountTx(networkID, sources[i], dest, 0,
+                                        AccountType::GENERAL);
+        REQUIRE(app.getHerder().recvTransaction(tx) ==
+                Herder::TX_STATUS_PENDING);
+        app.getOverlayManager().broadcastMessage(tx->toStellarMessage());
+    };
+
+    auto injectSCP = [&](size_t i, Application& app)
+    {
+        SecretKey dest = SecretKey::random();
+        auto tx = createCreateAccountTx(networkID, sources[i], dest, 0,
+                                        AccountType::GENERAL);
+        auto const& lcl = app.getLedgerManager().getLastClosedLedgerHeader();
+        TxSetFrame txSet(lcl.hash);
+        txSet.add(tx);
+        txSet.sortForHash();
+        auto& herder = app.getHerder();
+        herder.recvTxSet(txSet.getContentsHash(), txSet);
+
+        SCPQuorumSet qset;
+        qset.threshold = 1;
+        qset.validators.emplace_back(sourcesPub[i]);
+        Hash qSetHash = sha256(xdr::xdr_to_opaque(qset));
+        herder.recvSCPQuorumSet(qSetHash, qset);
+
+        StellarValue sv(txSet.getContentsHash(),
+                        lcl.header.scpValue.closeTime + 1, emptyUpgradeSteps,
+                        StellarValue::_ext_t(LedgerVersion::EMPTY_VERSION));
+        SCPEnvelope envelope;
+        auto& st = envelope.statement;
+        st.slotIndex = lcl.header.ledgerSeq + 1;
+        st.pledges.type(SCPStatementType::NOMINATE);
+        auto& nom = st.pledges.nominate();
+        nom.votes.emplace_back(xdr::xdr_to_opaque(sv));
+        nom.quorumSetHash = qSetHash;
+        st.nodeID = sourcesPub[i];
+        envelope.signature = sources[i].sign(
+            xdr::xdr_to_opaque(app.getNetworkID(), EnvelopeType::SCP, st));
+
+        // the herder broadcasts it through the overlay once it is ready
+        herder.recvSCPEnvelope(envelope);
+    };
+
+    auto meter = [](Application& app, std::string const& type,
+                    std::string const& name)
+    {
+        return app.getMetrics()
+            .NewMeter({"overlay", type, name}, "message")
+            .count();
+    };
+
+    // every node but the origin records each message exactly once as unique
+    auto allReceived = [&]()
+    {
+        uint64_t unique = 0;
+        for (auto n : nodes)
+        {
+            unique += meter(*n, "flood", "unique");
+        }
+        return unique >= numMessages * (nodes.size() - 1);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < numMessages; i++)
+    {
+        auto& app = *nodes[i % nodes.size()];
+        if (i < static_cast<size_t>(txFraction * numMessages))
+        {
+            injectTransaction(i, app);
+        }
+        else
+        {
+            injectSCP(i, app);
+        }
+    }
+    simulation->crankUntil(allReceived, std::chrono::seconds(60), false);
+    auto wall = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count() /
+                1000000.0;
+
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    uint64_t unique = 0;
+    uint64_t duplicate = 0;
+    std::vector<double> latencies;
+    for (auto n : nodes)
+    {
+        messages += meter(*n, "message", "write");
+        bytes += n->getMetrics()
+                     .NewMeter({"overlay", "byte", "write"}, "byte")
+                     .count();
+        unique += meter(*n, "flood", "unique");
+        duplicate += meter(*n, "flood", "duplicate");
+        auto values = n->getMetrics()
+                          .NewTimer({"overlay", "loopback", "hop-latency"})
+                          .GetSnapshot()
+                          .getValues();
+        latencies.insert(latencies.end(), values.begin(), values.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    OverlayBenchResult res;
+    res.mMessagesPerSec = wall > 0 ? messages / wall : 0;
+    res.mBytesPerSec = wall > 0 ? bytes / wall : 0;
+    res.mHopLatency50 = percentile(latencies, 0.50);
+    res.mHopLatency95 = percentile(latencies, 0.95);
+    res.mHopLatency99 = percentile(latencies, 0.99);
+    res.mDuplication =
+        unique > 0 ? static_cast<double>(unique + duplicate) / unique : 0;
+    res.mBusyPercent = 100 - simulation->getClock().recentIdleCrankPercent();
+
+    REQUIRE(allReceived());
+    simulation->stopAllNodes();
+    return res;
+}
+}
+
+TEST_CASE("overlay throughput over loopback", "[overlaybench][bench][hide]")
+{
+    size_t const numMessages = 200;
+
+    LOG(INFO) << fmt::format(
+        "{:>6s} {:>6s} {:>10s} {:>12s} {:>8s} {:>8s} {:>8s} {:>6s} {:>5s}",
+        "nodes", "tx%", "msg/s", "byte/s", "hop50ms", "hop95ms", "hop99ms",
+        "dup", "busy%");
+    for (int numNodes : {4, 8, 16})
+    {
+        for (double txFraction : {1.0, 0.5, 0.0})
+        {
+            auto r = runOverlayBench(numNodes, numMessages, txFraction);
+            LOG(INFO) << fmt::format(
+                "{:>6d} {:>6.0f} {:>10.0f} {:>12.0f} {:>8.3f} {:>8.3f} "
+                "{:>8.3f} {:>6.2f} {:>5d}",
+                numNodes, 100 * txFraction, r.mMessagesPerSec, r.mBytesPerSec,
+                r.mHopLatency50, r.mHopLatency95, r.mHopLatency99,
+                r.mDuplication, r.mBusyPercent);
+        }
+    }
+}
+}
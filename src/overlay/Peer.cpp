@@ -19,6 +19,7 @@
 #include "overlay/PeerRecord.h"
 #include "BanManager.h"
 #include "util/Logging.h"
+#include "util/types.h"
 
 #include "medida/metrics_registry.h"
 #include "medida/timer.h"
@@ -331,6 +332,7 @@ Peer::sendGetTxSet(uint256 const& setID)
     newMsg.type(MessageType::GET_TX_SET);
     newMsg.txSetHash() = setID;
 
+    noteFetchRequest(setID);
     sendMessage(newMsg);
 }
 void
@@ -343,9 +345,63 @@ Peer::sendGetQuorumSet(uint256 const& setID)
     newMsg.type(MessageType::GET_SCP_QUORUMSET);
     newMsg.qSetHash() = setID;
 
+    noteFetchRequest(setID);
     sendMessage(newMsg);
 }
 
+void
+Peer::noteFetchRequest(uint256 const& itemID)
+{
+    mFetchRequests.emplace(itemID, mApp.getClock().now());
+}
+
+void
+Peer::noteFetchReply(uint256 const& itemID, bool gotItem)
+{
+    auto it = mFetchRequests.find(itemID);
+    if (it != mFetchRequests.end())
+    {
+        // a DONT_HAVE is quick to produce and says nothing about how fast
+        // the peer serves items, so only actual items are sampled
+        if (gotItem)
+        {
+            addFetchLatencySample(mApp.getClock().now() - it->second);
+        }
+        mFetchRequests.erase(it);
+    }
+}
+
+void
+Peer::cancelFetchRequest(uint256 const& itemID, bool timedOut)
+{
+    auto it = mFetchRequests.find(itemID);
+    if (it != mFetchRequests.end())
+    {
+        if (timedOut)
+        {
+            addFetchLatencySample(mApp.getClock().now() - it->second);
+        }
+        mFetchRequests.erase(it);
+    }
+}
+
+void
+Peer::addFetchLatencySample(VirtualClock::duration d)
+{
+    double ms =
+        static_cast<double>(
+            std::chrono::duration_cast<std::chrono::microseconds>(d).count()) /
+        1000.0;
+    if (mFetchLatencyMs < 0)
+    {
+        mFetchLatencyMs = ms;
+    }
+    else
+    {
+        mFetchLatencyMs = 0.75 * mFetchLatencyMs + 0.25 * ms;
+    }
+}
+
 void
 Peer::sendGetPeers()
 {
@@ -493,6 +549,18 @@ Peer::sendMessage(StellarMessage const& msg)
         break;
     };
 
+    queueMessage(msg);
+}
+
+void
+Peer::queueMessage(StellarMessage const& msg)
+{
+    this->sendMessage(authenticateMessage(msg));
+}
+
+xdr::msg_ptr
+Peer::authenticateMessage(StellarMessage const& msg)
+{
     AuthenticatedMessage amsg;
     amsg.v0().message = msg;
     if (msg.type() != MessageType::HELLO && msg.type() != MessageType::ERROR_MSG)
@@ -502,8 +570,31 @@ Peer::sendMessage(StellarMessage const& msg)
             hmacSha256(mSendMacKey, xdr::xdr_to_opaque(mSendMacSeq, msg));
         ++mSendMacSeq;
     }
-    xdr::msg_ptr xdrBytes(xdr::xdr_to_msg(amsg));
-    this->sendMessage(std::move(xdrBytes));
+    auto res = xdr::xdr_to_msg(amsg);
+    if (!isZero(mPeerID.ed25519()))
+    {
+        mApp.getOverlayManager().getLoadManager().debitMessageCosts(
+            mApp, mPeerID, msg.type(), 0, res->size(), 0, 0);
+    }
+    return res;
+}
+
+Peer::MessagePriority
+Peer::getMessagePriority(StellarMessage const& msg)
+{
+    switch (msg.type())
+    {
+    case MessageType::TRANSACTION:
+        return PRIORITY_FLOOD;
+    case MessageType::TX_SET:
+    case MessageType::SCP_QUORUMSET:
+    case MessageType::PEERS:
+        return PRIORITY_FETCH;
+    default:
+        // handshake, errors, requests and SCP messages are small and have
+        // to go out in the order they were sent
+        return PRIORITY_SCP;
+    }
 }
 
 void
@@ -521,6 +612,7 @@ Peer::recvMessage(xdr::msg_ptr const& msg)
     {
         AuthenticatedMessage am;
         xdr::xdr_from_msg(msg, am);
+        loadCtx.setMessage(am.v0().message.type(), msg->size());
         recvMessage(am);
     }
     catch (xdr::xdr_runtime_error& e)
@@ -710,6 +802,7 @@ Peer::recvMessage(StellarMessage const& stellarMsg)
 void
 Peer::recvDontHave(StellarMessage const& msg)
 {
+    noteFetchReply(msg.dontHave().reqHash, false);
     mApp.getHerder().peerDoesntHave(msg.dontHave().type, msg.dontHave().reqHash,
                                     shared_from_this());
 }
@@ -736,6 +829,7 @@ void
 Peer::recvTxSet(StellarMessage const& msg)
 {
     TxSetFrame frame(mApp.getNetworkID(), msg.txSet());
+    noteFetchReply(frame.getContentsHash(), true);
     mApp.getHerder().recvTxSet(frame.getContentsHash(), frame);
 }
 
@@ -787,6 +881,7 @@ void
 Peer::recvSCPQuorumSet(StellarMessage const& msg)
 {
     Hash hash = sha256(xdr::xdr_to_opaque(msg.qSet()));
+    noteFetchReply(hash, true);
     mApp.getHerder().recvSCPQuorumSet(hash, msg.qSet());
 }
 
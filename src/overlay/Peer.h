@@ -10,6 +10,7 @@
 #include "util/Timer.h"
 #include "database/Database.h"
 #include "util/NonCopyable.h"
+#include <map>
 
 namespace medida
 {
@@ -50,6 +51,20 @@ class Peer : public std::enable_shared_from_this<Peer>,
         WE_CALLED_REMOTE
     };
 
+    // Outbound messages are classified so that a peer which can't keep up
+    // still receives consensus traffic first; lower values are written
+    // first, and floods are the first to be shed when a queue is over
+    // budget.
+    enum MessagePriority
+    {
+        PRIORITY_SCP = 0,
+        PRIORITY_FETCH = 1,
+        PRIORITY_FLOOD = 2,
+        PRIORITY_COUNT = 3
+    };
+
+    static MessagePriority getMessagePriority(StellarMessage const& msg);
+
     static medida::Meter& getByteReadMeter(Application& app);
     static medida::Meter& getByteWriteMeter(Application& app);
 
@@ -76,6 +91,12 @@ class Peer : public std::enable_shared_from_this<Peer>,
     VirtualClock::time_point mLastRead;
     VirtualClock::time_point mLastWrite;
 
+    // Outstanding GET_TX_SET / GET_SCP_QUORUMSET requests and a decaying
+    // average of how long this peer takes to answer them, used by
+    // ItemFetcher to rank peers. Negative until the first sample.
+    std::map<uint256, VirtualClock::time_point> mFetchRequests;
+    double mFetchLatencyMs{-1};
+
     medida::Meter& mMessageRead;
     medida::Meter& mMessageWrite;
     medida::Meter& mByteRead;
@@ -159,6 +180,9 @@ class Peer : public std::enable_shared_from_this<Peer>,
     void sendHello();
     void sendAuth();
     void sendSCPQuorumSet(SCPQuorumSetPtr qSet);
+    void noteFetchRequest(uint256 const& itemID);
+    void noteFetchReply(uint256 const& itemID, bool gotItem);
+    void addFetchLatencySample(VirtualClock::duration d);
     void sendDontHave(MessageType type, uint256 const& itemID);
     void sendPeers();
 
@@ -170,6 +194,14 @@ class Peer : public std::enable_shared_from_this<Peer>,
     // messages somewhere else. The async write request will point _into_
     // this owned buffer. This is really the best we can do.
     virtual void sendMessage(xdr::msg_ptr&& xdrBytes) = 0;
+
+    // Called by sendMessage(StellarMessage) once metrics are recorded. The
+    // default authenticates and writes immediately; subclasses that queue
+    // messages themselves must call authenticateMessage only when the
+    // message is actually written, so that MAC sequence numbers follow wire
+    // order.
+    virtual void queueMessage(StellarMessage const& msg);
+    xdr::msg_ptr authenticateMessage(StellarMessage const& msg);
     virtual void
     connected()
     {
@@ -198,6 +230,25 @@ class Peer : public std::enable_shared_from_this<Peer>,
     void sendGetPeers();
     void sendGetScpState(uint32 ledgerSeq);
 
+    // Called by ItemFetcher when it no longer waits for an answer to
+    // sendGetTxSet/sendGetQuorumSet; a timed out request counts as a latency
+    // sample.
+    void cancelFetchRequest(uint256 const& itemID, bool timedOut);
+
+    // Whether an answer to sendGetTxSet/sendGetQuorumSet for itemID is
+    // still awaited.
+    bool
+    isFetching(uint256 const& itemID) const
+    {
+        return mFetchRequests.find(itemID) != mFetchRequests.end();
+    }
+
+    double
+    getFetchLatencyMs() const
+    {
+        return mFetchLatencyMs;
+    }
+
     void sendMessage(StellarMessage const& msg);
 
     PeerRole
@@ -209,6 +260,13 @@ class Peer : public std::enable_shared_from_this<Peer>,
     bool isConnected() const;
     bool isAuthenticated() const;
 
+    // Bytes of messages accepted by sendMessage but not yet written.
+    virtual size_t
+    getOutboundQueueBytes() const
+    {
+        return 0;
+    }
+
     PeerState
     getState() const
     {
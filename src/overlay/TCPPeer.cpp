@@ -13,6 +13,7 @@
 #include "overlay/PeerRecord.h"
 #include "medida/metrics_registry.h"
 #include "medida/meter.h"
+#include "medida/counter.h"
 #include "main/Config.h"
 #include "util/GlobalChecks.h"
 
@@ -30,10 +31,29 @@ using namespace std;
 // TCPPeer
 ///////////////////////////////////////////////////////////////////////
 
+TCPPeer::OutboundQueue::OutboundQueue(Application& app,
+                                      std::string const& name)
+    : mEnqueueMeter(
+          app.getMetrics().NewMeter({"overlay", "enqueue", name}, "message"))
+    , mShedMeter(
+          app.getMetrics().NewMeter({"overlay", "shed", name}, "message"))
+    , mBytesCounter(app.getMetrics().NewCounter(
+          {"overlay", "memory", "outbound-" + name}))
+{
+}
+
 TCPPeer::TCPPeer(Application& app, Peer::PeerRole role,
                  std::shared_ptr<TCPPeer::SocketType> socket)
-    : Peer(app, role), mSocket(socket)
+    : Peer(app, role)
+    , mSocket(socket)
+    , mCompressor(app)
+    , mDropInOutboundQueueMeter(app.getMetrics().NewMeter(
+          {"overlay", "drop", "outbound-queue"}, "drop"))
 {
+    mOutboundQueues.reserve(PRIORITY_COUNT);
+    mOutboundQueues.emplace_back(app, "scp");
+    mOutboundQueues.emplace_back(app, "fetch");
+    mOutboundQueues.emplace_back(app, "flood");
 }
 
 TCPPeer::pointer
@@ -103,6 +123,7 @@ TCPPeer::~TCPPeer()
 {
     assertThreadIsMain();
     mIdleTimer.cancel();
+    clearOutboundQueues();
     if (mSocket)
     {
         // Ignore: this indicates an attempt to cancel events
@@ -124,6 +145,97 @@ TCPPeer::getIP()
     return mIP;
 }
 
+size_t
+TCPPeer::getOutboundQueueBytes() const
+{
+    return mOutboundQueueBytes;
+}
+
+void
+TCPPeer::queueMessage(StellarMessage const& msg)
+{
+    assertThreadIsMain();
+
+    auto size = xdr::xdr_size(msg);
+    auto& queue = mOutboundQueues[getMessagePriority(msg)];
+    queue.mMessages.emplace_back(msg, size);
+    queue.mBytes += size;
+    queue.mEnqueueMeter.Mark();
+    queue.mBytesCounter.inc(size);
+    mOutboundQueueBytes += size;
+
+    if (mOutboundQueueBytes > mApp.getConfig().MAX_PEER_OUTBOUND_QUEUE_BYTES &&
+        !shedOutboundFloods())
+    {
+        // Even without floods the peer is too far behind to be useful to
+        // consensus. An ERROR_MSG would only be queued behind everything
+        // else, so just disconnect.
+        CLOG(WARNING, "Overlay")
+            << "TCPPeer: outbound queue of " << mOutboundQueueBytes
+            << " bytes over limit, dropping " << toString();
+        mDropInOutboundQueueMeter.Mark();
+        drop();
+        return;
+    }
+
+    if (!mWriting)
+    {
+        mWriting = true;
+        // kick off the async write chain if we're the first one
+        messageSender();
+    }
+}
+
+bool
+TCPPeer::shedOutboundFloods()
+{
+    // drop the oldest floods first: they are the most likely to already
+    // have reached the peer through someone else
+    auto& floods = mOutboundQueues[PRIORITY_FLOOD];
+    auto limit = mApp.getConfig().MAX_PEER_OUTBOUND_QUEUE_BYTES;
+    while (mOutboundQueueBytes > limit && !floods.mMessages.empty())
+    {
+        auto size = floods.mMessages.front().second;
+        floods.mMessages.pop_front();
+        floods.mBytes -= size;
+        floods.mShedMeter.Mark();
+        floods.mBytesCounter.dec(size);
+        mOutboundQueueBytes -= size;
+    }
+    return mOutboundQueueBytes <= limit;
+}
+
+bool
+TCPPeer::popOutboundMessage(StellarMessage& msg)
+{
+    for (auto& queue : mOutboundQueues)
+    {
+        if (!queue.mMessages.empty())
+        {
+            auto size = queue.mMessages.front().second;
+            msg = std::move(queue.mMessages.front().first);
+            queue.mMessages.pop_front();
+            queue.mBytes -= size;
+            queue.mBytesCounter.dec(size);
+            mOutboundQueueBytes -= size;
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+TCPPeer::clearOutboundQueues()
+{
+    for (auto& queue : mOutboundQueues)
+    {
+        queue.mBytesCounter.dec(queue.mBytes);
+        queue.mBytes = 0;
+        queue.mMessages.clear();
+    }
+    mOutboundQueueBytes = 0;
+}
+
 void
 TCPPeer::sendMessage(xdr::msg_ptr&& xdrBytes)
 {
@@ -146,6 +258,18 @@ TCPPeer::sendMessage(xdr::msg_ptr&& xdrBytes)
     }
 }
 
+bool
+TCPPeer::canCompress() const
+{
+    // only once both sides know each other's overlay version, and never
+    // before the remote peer has authenticated us and will accept it
+    return isAuthenticated() &&
+           mRemoteOverlayVersion >=
+               MessageCompressor::OVERLAY_PROTOCOL_COMPRESSION_VERSION &&
+           mApp.getConfig().OVERLAY_PROTOCOL_VERSION >=
+               MessageCompressor::OVERLAY_PROTOCOL_COMPRESSION_VERSION;
+}
+
 void
 TCPPeer::messageSender()
 {
@@ -153,6 +277,27 @@ TCPPeer::messageSender()
 
     auto self = static_pointer_cast<TCPPeer>(shared_from_this());
 
+    // authenticate the next queued message only now, so that whatever was
+    // shed from the queues never consumed a MAC sequence number
+    if (mWriteQueue.empty())
+    {
+        StellarMessage msg;
+        if (popOutboundMessage(msg))
+        {
+            auto xdrBytes = authenticateMessage(msg);
+            if (canCompress())
+            {
+                auto compressed = mCompressor.compress(xdrBytes);
+                if (compressed)
+                {
+                    xdrBytes = std::move(compressed);
+                }
+            }
+            mWriteQueue.emplace(
+                std::make_shared<xdr::msg_ptr>(std::move(xdrBytes)));
+        }
+    }
+
     // if nothing to do, flush and return
     if (mWriteQueue.empty())
     {
@@ -161,7 +306,8 @@ TCPPeer::messageSender()
                                  self->writeHandler(ec, 0);
                                  if (!ec)
                                  {
-                                     if (!self->mWriteQueue.empty())
+                                     if (!self->mWriteQueue.empty() ||
+                                         self->mOutboundQueueBytes != 0)
                                      {
                                          self->messageSender();
                                      }
@@ -254,7 +400,16 @@ int
 TCPPeer::getIncomingMsgLength()
 {
     int length = mIncomingHeader[0];
-    length &= 0x7f; // clear the XDR 'continuation' bit
+    mIncomingCompressed =
+        (length & (MessageCompressor::COMPRESSED_MESSAGE_FLAG >> 24)) != 0;
+    if (mIncomingCompressed && !canCompress())
+    {
+        mErrorRead.Mark();
+        CLOG(ERROR, "Overlay") << "TCP: unexpected compressed message";
+        drop();
+        return 0;
+    }
+    length &= 0x3f; // clear the XDR 'continuation' bit and compression flag
     length <<= 8;
     length |= mIncomingHeader[1];
     length <<= 8;
@@ -359,6 +514,18 @@ TCPPeer::recvMessage()
     assertThreadIsMain();
     try
     {
+        if (mIncomingCompressed)
+        {
+            std::vector<uint8_t> inflated;
+            if (!mCompressor.decompress(mIncomingBody, inflated,
+                                        MAX_MESSAGE_SIZE))
+            {
+                Peer::drop(ErrorCode::DATA, "received corrupt compression");
+                return;
+            }
+            mIncomingBody.swap(inflated);
+        }
+
         xdr::xdr_get g(mIncomingBody.data(),
                        mIncomingBody.data() + mIncomingBody.size());
         AuthenticatedMessage am;
@@ -4,12 +4,16 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "overlay/MessageCompressor.h"
 #include "overlay/Peer.h"
 #include "util/Timer.h"
+#include <deque>
 #include <queue>
+#include <vector>
 
 namespace medida
 {
+class Counter;
 class Meter;
 }
 
@@ -22,17 +26,45 @@ class TCPPeer : public Peer
     typedef asio::buffered_stream<asio::ip::tcp::socket> SocketType;
 
   private:
+    friend class TCPPeerTests;
+
     std::string mIP;
     std::shared_ptr<SocketType> mSocket;
     std::vector<uint8_t> mIncomingHeader;
     std::vector<uint8_t> mIncomingBody;
+    bool mIncomingCompressed{false};
+    MessageCompressor mCompressor;
+
+    // Messages waiting to be written, one queue per MessagePriority. They
+    // are kept unauthenticated so that floods can be shed without leaving
+    // gaps in the MAC sequence; a message is authenticated and serialized
+    // into mWriteQueue only when the socket is ready to write it.
+    struct OutboundQueue
+    {
+        OutboundQueue(Application& app, std::string const& name);
+
+        std::deque<std::pair<StellarMessage, size_t>> mMessages;
+        size_t mBytes{0};
+
+        medida::Meter& mEnqueueMeter;
+        medida::Meter& mShedMeter;
+        medida::Counter& mBytesCounter;
+    };
 
+    std::vector<OutboundQueue> mOutboundQueues;
+    size_t mOutboundQueueBytes{0};
+    medida::Meter& mDropInOutboundQueueMeter;
     std::queue<std::shared_ptr<xdr::msg_ptr>> mWriteQueue;
     bool mWriting{false};
 
     void recvMessage();
+    void queueMessage(StellarMessage const& msg) override;
     void sendMessage(xdr::msg_ptr&& xdrBytes) override;
 
+    bool popOutboundMessage(StellarMessage& msg);
+    bool shedOutboundFloods();
+    void clearOutboundQueues();
+    bool canCompress() const;
     void messageSender();
 
     int getIncomingMsgLength();
@@ -63,5 +95,6 @@ class TCPPeer : public Peer
 
     virtual void drop() override;
     virtual std::string getIP() override;
+    virtual size_t getOutboundQueueBytes() const override;
 };
 }
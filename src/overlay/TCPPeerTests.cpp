@@ -6,10 +6,18 @@
 #include "TCPPeer.h"
 #include "main/Application.h"
 #include "main/test.h"
+#include "overlay/MessageCompressor.h"
 #include "overlay/PeerDoor.h"
 #include "simulation/Simulation.h"
 #include "overlay/OverlayManager.h"
 #include "test/test_marshaler.h"
+#include "transactions/test/TxTests.h"
+#include "xdrpp/marshal.h"
+
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 
 namespace stellar
 {
@@ -50,4 +58,332 @@ TEST_CASE("TCPPeer can communicate", "[overlay]")
     REQUIRE(p1->isAuthenticated());
     s->stopAllNodes();
 }
+
+TEST_CASE("outbound message priority classes", "[overlay]")
+{
+    StellarMessage msg;
+
+    msg.type(MessageType::SCP_MESSAGE);
+    REQUIRE(Peer::getMessagePriority(msg) == Peer::PRIORITY_SCP);
+    msg.type(MessageType::GET_TX_SET);
+    REQUIRE(Peer::getMessagePriority(msg) == Peer::PRIORITY_SCP);
+    msg.type(MessageType::ERROR_MSG);
+    REQUIRE(Peer::getMessagePriority(msg) == Peer::PRIORITY_SCP);
+
+    msg.type(MessageType::TX_SET);
+    REQUIRE(Peer::getMessagePriority(msg) == Peer::PRIORITY_FETCH);
+    msg.type(MessageType::SCP_QUORUMSET);
+    REQUIRE(Peer::getMessagePriority(msg) == Peer::PRIORITY_FETCH);
+
+    msg.type(MessageType::TRANSACTION);
+    REQUIRE(Peer::getMessagePriority(msg) == Peer::PRIORITY_FLOOD);
+}
+
+// Two nodes connected over loopback TCP, where the first one's outbound
+// queue to the second is inspected. Nothing is written while the clock
+// isn't cranked, so messages sent in between pile up as they would for a
+// slow peer.
+class TCPPeerTests
+{
+  protected:
+    Hash mNetworkID{sha256(getTestConfig().NETWORK_PASSPHRASE)};
+    Simulation::pointer mSimulation;
+    Application::pointer mApp0;
+    Application::pointer mApp1;
+    TCPPeer::pointer mPeer0;
+    SecretKey mRoot{txtest::getRoot()};
+
+    void
+    connect(size_t maxQueueBytes)
+    {
+        mSimulation =
+            std::make_shared<Simulation>(Simulation::OVER_TCP, mNetworkID);
+
+        auto v10SecretKey = SecretKey::fromSeed(sha256("v10"));
+        auto v11SecretKey = SecretKey::fromSeed(sha256("v11"));
+
+        SCPQuorumSet n0_qset;
+        n0_qset.threshold = 1;
+        n0_qset.validators.push_back(v10SecretKey.getPublicKey());
+        Config cfg = getTestConfig(1);
+        cfg.ARTIFICIALLY_ACCELERATE_TIME_FOR_TESTING = true;
+        cfg.MAX_PEER_OUTBOUND_QUEUE_BYTES = maxQueueBytes;
+        mApp0 = mSimulation->getNode(mSimulation->addNode(
+            v10SecretKey, n0_qset, mSimulation->getClock(), &cfg));
+
+        SCPQuorumSet n1_qset;
+        n1_qset.threshold = 1;
+        n1_qset.validators.push_back(v11SecretKey.getPublicKey());
+        mApp1 = mSimulation->getNode(mSimulation->addNode(
+            v11SecretKey, n1_qset, mSimulation->getClock()));
+
+        mSimulation->addPendingConnection(v10SecretKey.getPublicKey(),
+                                          v11SecretKey.getPublicKey());
+        mSimulation->startAllNodes();
+        mSimulation->crankForAtLeast(std::chrono::seconds(1), false);
+
+        mPeer0 = std::static_pointer_cast<TCPPeer>(
+            mApp0->getOverlayManager().getConnectedPeer(
+                "127.0.0.1", mApp1->getConfig().PEER_PORT));
+        REQUIRE(mPeer0);
+        REQUIRE(mPeer0->isAuthenticated());
+
+        // let whatever the handshake and consensus queued drain
+        mSimulation->crankUntil(
+            [&]() { return mPeer0->getOutboundQueueBytes() == 0; },
+            std::chrono::seconds(5), false);
+    }
+
+    StellarMessage
+    flood()
+    {
+        auto dest = SecretKey::random();
+        return txtest::createCreateAccountTx(mNetworkID, mRoot, dest, 0,
+                                             AccountType::GENERAL)
+            ->toStellarMessage();
+    }
+
+    StellarMessage
+    getSCPState(uint32 ledgerSeq)
+    {
+        StellarMessage msg;
+        msg.type(MessageType::GET_SCP_STATE);
+        msg.getSCPLedgerSeq() = ledgerSeq;
+        return msg;
+    }
+
+    std::vector<StellarMessage>
+    queued(Peer::MessagePriority priority)
+    {
+        std::vector<StellarMessage> res;
+        for (auto const& m : mPeer0->mOutboundQueues[priority].mMessages)
+        {
+            res.push_back(m.first);
+        }
+        return res;
+    }
+
+    // Whether the next message sent goes straight to the socket rather than
+    // to the queues.
+    bool
+    writesNextImmediately()
+    {
+        return !mPeer0->mWriting;
+    }
+
+    bool
+    popQueued(StellarMessage& msg)
+    {
+        return mPeer0->popOutboundMessage(msg);
+    }
+
+    uint64_t
+    meter(Application& app, std::string const& type, std::string const& name)
+    {
+        return app.getMetrics()
+            .NewMeter({"overlay", type, name}, "message")
+            .count();
+    }
+
+    int64_t
+    queuedBytesCounter(std::string const& name)
+    {
+        return mApp0->getMetrics()
+            .NewCounter({"overlay", "memory", "outbound-" + name})
+            .count();
+    }
+
+    uint64_t
+    received(Application& app, std::string const& name)
+    {
+        return app.getMetrics().NewTimer({"overlay", "recv", name}).count();
+    }
+};
+
+TEST_CASE_METHOD(TCPPeerTests, "slow peer sheds the oldest floods",
+                 "[overlay]")
+{
+    size_t const floodSize = xdr::xdr_size(flood());
+    size_t const keep = 10;
+    size_t const sent = 30;
+    connect(keep * floodSize);
+
+    auto shed = meter(*mApp0, "shed", "flood");
+    auto enqueued = meter(*mApp0, "enqueue", "flood");
+    auto receivedBefore = received(*mApp1, "transaction");
+    size_t inFlight = writesNextImmediately() ? 1 : 0;
+
+    std::vector<StellarMessage> floods;
+    for (size_t i = 0; i < sent; i++)
+    {
+        floods.push_back(flood());
+        mPeer0->sendMessage(floods.back());
+    }
+
+    REQUIRE(mPeer0->isConnected());
+    REQUIRE(mPeer0->getOutboundQueueBytes() <= keep * floodSize);
+    REQUIRE(meter(*mApp0, "enqueue", "flood") - enqueued == sent);
+    REQUIRE(meter(*mApp0, "shed", "flood") - shed == sent - inFlight - keep);
+    REQUIRE(queuedBytesCounter("flood") ==
+            static_cast<int64_t>(keep * floodSize));
+
+    // the newest floods are the ones kept, in the order they were sent
+    auto kept = queued(Peer::PRIORITY_FLOOD);
+    REQUIRE(kept.size() == keep);
+    REQUIRE(std::equal(kept.begin(), kept.end(), floods.end() - keep));
+
+    // what's left goes out with its MACs in sequence
+    mSimulation->crankUntil(
+        [&]() {
+            return received(*mApp1, "transaction") - receivedBefore ==
+                   keep + inFlight;
+        },
+        std::chrono::seconds(10), false);
+    REQUIRE(received(*mApp1, "transaction") - receivedBefore ==
+            keep + inFlight);
+    REQUIRE(mPeer0->isAuthenticated());
+    REQUIRE(mPeer0->getOutboundQueueBytes() == 0);
+    REQUIRE(queuedBytesCounter("flood") == 0);
+
+    mSimulation->stopAllNodes();
+}
+
+TEST_CASE_METHOD(TCPPeerTests, "slow peer writes consensus traffic first",
+                 "[overlay]")
+{
+    connect(32 * 1024 * 1024);
+
+    auto enqueued = meter(*mApp0, "enqueue", "scp");
+    // keep the floods from going out straight away
+    if (writesNextImmediately())
+    {
+        mPeer0->sendMessage(getSCPState(1));
+        enqueued++;
+    }
+    for (size_t i = 0; i < 5; i++)
+    {
+        mPeer0->sendMessage(flood());
+    }
+    mPeer0->sendMessage(getSCPState(2));
+    mPeer0->sendMessage(getSCPState(3));
+
+    REQUIRE(meter(*mApp0, "enqueue", "scp") - enqueued == 2);
+    REQUIRE(queuedBytesCounter("scp") ==
+            static_cast<int64_t>(2 * xdr::xdr_size(getSCPState(2))));
+
+    StellarMessage msg;
+    REQUIRE(popQueued(msg));
+    REQUIRE(msg == getSCPState(2));
+    REQUIRE(popQueued(msg));
+    REQUIRE(msg == getSCPState(3));
+    for (size_t i = 0; i < 5; i++)
+    {
+        REQUIRE(popQueued(msg));
+        REQUIRE(msg.type() == MessageType::TRANSACTION);
+    }
+    REQUIRE(!popQueued(msg));
+    REQUIRE(mPeer0->getOutboundQueueBytes() == 0);
+    REQUIRE(queuedBytesCounter("scp") == 0);
+    REQUIRE(queuedBytesCounter("flood") == 0);
+
+    mSimulation->stopAllNodes();
+}
+
+TEST_CASE_METHOD(TCPPeerTests,
+                 "slow peer is dropped when consensus traffic is over budget",
+                 "[overlay]")
+{
+    size_t const scpSize = xdr::xdr_size(getSCPState(1));
+    size_t const floodSize = xdr::xdr_size(flood());
+    connect(2 * floodSize);
+
+    auto shed = meter(*mApp0, "shed", "flood");
+    auto dropped = mApp0->getMetrics()
+                       .NewMeter({"overlay", "drop", "outbound-queue"}, "drop")
+                       .count();
+    if (writesNextImmediately())
+    {
+        mPeer0->sendMessage(getSCPState(1));
+    }
+    mPeer0->sendMessage(flood());
+    mPeer0->sendMessage(flood());
+    REQUIRE(queued(Peer::PRIORITY_FLOOD).size() == 2);
+
+    // floods make way for consensus traffic first
+    mPeer0->sendMessage(getSCPState(2));
+    REQUIRE(mPeer0->isConnected());
+    REQUIRE(queued(Peer::PRIORITY_FLOOD).size() == 1);
+    REQUIRE(meter(*mApp0, "shed", "flood") - shed == 1);
+
+    uint32 seq = 3;
+    while (mPeer0->isConnected())
+    {
+        REQUIRE(seq * scpSize <= 4 * floodSize);
+        mPeer0->sendMessage(getSCPState(seq++));
+    }
+    REQUIRE(queued(Peer::PRIORITY_FLOOD).empty());
+    REQUIRE(meter(*mApp0, "shed", "flood") - shed == 2);
+    REQUIRE(mApp0->getMetrics()
+                .NewMeter({"overlay", "drop", "outbound-queue"}, "drop")
+                .count() -
+            dropped ==
+            1);
+
+    mSimulation->crankForAtLeast(std::chrono::seconds(1), false);
+    REQUIRE(!mApp0->getOverlayManager().getConnectedPeer(
+        "127.0.0.1", mApp1->getConfig().PEER_PORT));
+
+    mSimulation->stopAllNodes();
+}
+
+TEST_CASE("large messages compress and inflate back", "[overlay]")
+{
+    VirtualClock clock;
+    Config cfg = getTestConfig();
+    cfg.OVERLAY_COMPRESSION_THRESHOLD = 1024;
+    auto app = Application::create(clock, cfg);
+    MessageCompressor compressor(*app);
+
+    StellarMessage msg;
+    msg.type(MessageType::PEERS);
+    for (uint32_t i = 0; i < 500; ++i)
+    {
+        PeerAddress pa;
+        pa.ip.type(IPAddrType::IPv4);
+        pa.port = 11625;
+        pa.numFailures = i % 3;
+        msg.peers().push_back(pa);
+    }
+    AuthenticatedMessage amsg;
+    amsg.v0().message = msg;
+    auto xdrBytes = xdr::xdr_to_msg(amsg);
+
+    auto compressed = compressor.compress(xdrBytes);
+    REQUIRE(compressed);
+    REQUIRE(compressed->size() < xdrBytes->size());
+    REQUIRE((compressed->raw_data()[0] &
+             (MessageCompressor::COMPRESSED_MESSAGE_FLAG >> 24)) != 0);
+
+    std::vector<uint8_t> body(compressed->data(),
+                              compressed->data() + compressed->size());
+    std::vector<uint8_t> inflated;
+    REQUIRE(compressor.decompress(body, inflated, 0x1000000));
+    REQUIRE(inflated.size() == xdrBytes->size());
+    REQUIRE(std::equal(inflated.begin(), inflated.end(),
+                       reinterpret_cast<uint8_t const*>(xdrBytes->data())));
+
+    SECTION("refuses to inflate beyond the limit")
+    {
+        REQUIRE(!compressor.decompress(body, inflated, 1024));
+    }
+
+    SECTION("leaves small messages alone")
+    {
+        StellarMessage small;
+        small.type(MessageType::GET_PEERS);
+        AuthenticatedMessage asmall;
+        asmall.v0().message = small;
+        REQUIRE(!compressor.compress(xdr::xdr_to_msg(asmall)));
+    }
+}
 }
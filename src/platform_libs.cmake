@@ -21,6 +21,10 @@ target_link_libraries(core xdrpp)
 target_link_libraries(core sodium)
 target_link_libraries(core coincore)
 
+find_package(ZLIB REQUIRED)
+include_directories(${ZLIB_INCLUDE_DIRS})
+target_link_libraries(core ${ZLIB_LIBRARIES})
+
 #For windows.
 if(${CMAKE_HOST_WIN32})
     find_library(WSOCK32_LIBRARY wsock32)
@@ -17,6 +17,7 @@
 #include "issuance/CreateIssuanceRequestOpFrame.h"
 #include "dex/CreateOfferOpFrame.h"
 #include "dex/CreateSaleParticipationOpFrame.h"
+#include "dex/SaleSettlement.h"
 #include "ledger/BalanceHelper.h"
 
 namespace stellar
@@ -109,13 +110,16 @@ bool CheckSaleStateOpFrame::handleClose(SaleFrame::pointer sale, Application& ap
     {
         if (quoteAsset.currentCap == 0)
             continue;
-        const auto saleOfferResult = applySaleOffer(saleOwnerAccount, sale, quoteAsset, app, lm, delta);
         CheckSubSaleClosedResult result;
-        result.saleDetails = saleOfferResult;
+        // settle() writes nothing unless it settles
+        SaleSettlement settlement(app, lm, delta, sale, quoteAsset, saleOwnerAccount);
+        if (!settlement.settle(result.saleDetails))
+        {
+            result.saleDetails = closeOfferByOffer(saleOwnerAccount, sale, quoteAsset, app, lm, delta);
+        }
         result.saleBaseBalance = sale->getBaseBalanceID();
         result.saleQuoteBalance = quoteAsset.quoteBalance;
         success.effect.saleClosed().results.push_back(result);
-        cancelAllOffersForQuoteAsset(sale, quoteAsset, delta, db);
     }
     SaleHelper::Instance()->storeDelete(delta, db, sale->getKey());
 
@@ -129,6 +133,14 @@ bool CheckSaleStateOpFrame::handleClose(SaleFrame::pointer sale, Application& ap
     return true;
 }
 
+ManageOfferSuccessResult CheckSaleStateOpFrame::closeOfferByOffer(const AccountFrame::pointer saleOwnerAccount, SaleFrame::pointer sale,
+    SaleQuoteAsset const& saleQuoteAsset, Application& app, LedgerManager& lm, LedgerDelta& delta)
+{
+    auto result = applySaleOffer(saleOwnerAccount, sale, saleQuoteAsset, app, lm, delta);
+    cancelAllOffersForQuoteAsset(sale, saleQuoteAsset, delta, app.getDatabase());
+    return result;
+}
+
 void CheckSaleStateOpFrame::unlockPendingIssunace(const SaleFrame::pointer sale,
     LedgerDelta& delta, Database& db) const
 {
@@ -288,6 +300,22 @@ bool CheckSaleStateOpFrame::doCheckValid(Application& app)
     return true;
 }
 
+void CheckSaleStateOpFrame::loadDueSales(const uint64_t closeTime, Database& db,
+    std::vector<SaleSchedule::DueSale>& sales)
+{
+    const auto hardCapReached = [&db](SaleFrame::pointer const& sale)
+    {
+        uint64_t currentCap = 0;
+        if (!CreateSaleParticipationOpFrame::getSaleCurrentCap(sale, db, currentCap))
+        {
+            CLOG(WARNING, Logging::OPERATION_LOGGER) << "Failed to calculate current cap for sale: " << sale->getID();
+            return false;
+        }
+        return currentCap >= sale->getHardCap();
+    };
+    db.getSaleSchedule().loadDueSales(closeTime, hardCapReached, sales, db);
+}
+
 std::string CheckSaleStateOpFrame::getInnerResultCodeAsStr()
 {
     const auto code = getInnerCode(mResult);
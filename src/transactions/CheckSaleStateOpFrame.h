@@ -6,6 +6,7 @@
 
 #include "transactions/OperationFrame.h"
 #include "ledger/SaleFrame.h"
+#include "ledger/SaleSchedule.h"
 
 namespace stellar
 {
@@ -57,6 +58,18 @@ public:
 
     std::string getInnerResultCodeAsStr() override;
 
+    // Closes one quote asset of a sale by applying the sale's offer and then
+    // cancelling what's left of the book, one offer at a time -- what
+    // SaleSettlement does in bulk whenever the book allows it.
+    ManageOfferSuccessResult closeOfferByOffer(AccountFrame::pointer saleOwner, SaleFrame::pointer sale,
+                                               SaleQuoteAsset const& saleQuoteAsset, Application& app,
+                                               LedgerManager& lm, LedgerDelta& delta);
+
+    // Appends to `sales` the sales a CheckSaleState applied at `closeTime`
+    // would close or cancel, so that the checker only submits those.
+    static void loadDueSales(uint64_t closeTime, Database& db,
+                             std::vector<SaleSchedule::DueSale>& sales);
+
     void updateAvailableForIssuance(const SaleFrame::pointer sale, LedgerDelta &delta, Database &db) const;
 };
 }
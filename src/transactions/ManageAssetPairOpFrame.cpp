@@ -15,6 +15,7 @@
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
 #include "ledger/OfferHelper.h"
+#include "ledger/OrderBookCache.h"
 #include "dex/OfferManager.h"
 #include "ledger/BalanceHelper.h"
 
@@ -131,9 +132,18 @@ ManageAssetPairOpFrame::doApply(Application& app,
 		assetPairEntry.physicalPrice = mManageAssetPair.physicalPrice;
 		assetPairEntry.currentPrice = mManageAssetPair.physicalPrice + premium;
                 auto orderBookID = ManageOfferOpFrame::SECONDARY_MARKET_ORDER_BOOK_ID;
-                uint64_t minAllowedPrice = assetPair->getMinAllowedPrice();
-                const auto offersToRemove = OfferHelper::Instance()->loadOffersWithFilters(assetPair->getBaseAsset(), assetPair->getQuoteAsset(), &orderBookID, &minAllowedPrice, db);
-                OfferManager::deleteOffers(offersToRemove, db, delta);
+                int64_t minAllowedPrice = assetPair->getMinAllowedPrice();
+                // the resident book tells from its lowest levels whether
+                // there's anything to remove at all, which mostly there isn't
+                if (minAllowedPrice < 0 ||
+                    db.getOrderBookCache().hasOffersBelow(
+                        minAllowedPrice, assetPair->getBaseAsset(),
+                        assetPair->getQuoteAsset(), orderBookID, db))
+                {
+                    uint64_t priceUpperBound = minAllowedPrice;
+                    const auto offersToRemove = OfferHelper::Instance()->loadOffersWithFilters(assetPair->getBaseAsset(), assetPair->getQuoteAsset(), &orderBookID, &priceUpperBound, db);
+                    OfferManager::deleteOffers(offersToRemove, db, delta);
+                }
 	}
 
 	EntryHelperProvider::storeChangeEntry(delta, db, assetPair->mEntry);
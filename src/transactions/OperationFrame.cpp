@@ -6,6 +6,7 @@
 #include "OperationFrame.h"
 #include "main/Application.h"
 #include "xdrpp/marshal.h"
+#include <exception>
 #include <string>
 #include "util/Logging.h"
 #include "ledger/LedgerDelta.h"
@@ -35,8 +36,10 @@
 
 #include "database/Database.h"
 
+#include "medida/histogram.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "dex/ManageOfferOpFrame.h"
 #include "CheckSaleStateOpFrame.h"
 
@@ -103,9 +106,48 @@ OperationFrame::OperationFrame(Operation const& op, OperationResult& res,
 {
 }
 
+OperationFrame::ApplyContext::ApplyContext(Application& app,
+                                           OperationFrame& operation)
+    : mApp(app)
+    , mOperation(operation)
+    , mStart(std::chrono::steady_clock::now())
+    , mSQLQueriesStart(app.getDatabase().getQueryMeter().count())
+    , mCacheHitsStart(app.getDatabase().getEntryCacheHitMeter().count())
+    , mCacheMissesStart(app.getDatabase().getEntryCacheMissMeter().count())
+{
+}
+
+OperationFrame::ApplyContext::~ApplyContext()
+{
+    // the result is unknown if applying threw
+    if (std::uncaught_exception())
+    {
+        return;
+    }
+
+    auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - mStart);
+    auto& db = mApp.getDatabase();
+    auto query = db.getQueryMeter().count() - mSQLQueriesStart;
+    auto hits = db.getEntryCacheHitMeter().count() - mCacheHitsStart;
+    auto misses = db.getEntryCacheMissMeter().count() - mCacheMissesStart;
+
+    auto& metrics = mApp.getMetrics();
+    std::string type = xdr::xdr_traits<OperationType>::enum_name(
+        mOperation.getOperation().body.type());
+    metrics.NewTimer({"operation", type, "apply"}).Update(time);
+    metrics.NewTimer({"operation", type, mOperation.getResultCodeAsStr()})
+        .Update(time);
+    metrics.NewHistogram({"operation", type, "query"}).Update(query);
+    metrics.NewHistogram({"operation", type, "entry-cache-hit"}).Update(hits);
+    metrics.NewHistogram({"operation", type, "entry-cache-miss"})
+        .Update(misses);
+}
+
 bool
 OperationFrame::apply(LedgerDelta& delta, Application& app)
 {
+    ApplyContext context(app, *this);
     bool res;
     res = checkValid(app, &delta);
     if (!res)
@@ -226,6 +268,76 @@ OperationFrame::getResultCode() const
     return mResult.code();
 }
 
+namespace
+{
+template <typename T>
+std::string
+resultCodeName(T code)
+{
+    return xdr::xdr_traits<T>::enum_name(code);
+}
+}
+
+std::string
+OperationFrame::getResultCodeAsStr(OperationResult const& result)
+{
+    if (result.code() != OperationResultCode::opINNER)
+    {
+        return resultCodeName(result.code());
+    }
+
+    auto const& tr = result.tr();
+    switch (tr.type())
+    {
+    case OperationType::CREATE_ACCOUNT:
+        return resultCodeName(tr.createAccountResult().code());
+    case OperationType::PAYMENT:
+        return resultCodeName(tr.paymentResult().code());
+    case OperationType::SET_OPTIONS:
+        return resultCodeName(tr.setOptionsResult().code());
+    case OperationType::CREATE_ISSUANCE_REQUEST:
+        return resultCodeName(tr.createIssuanceRequestResult().code());
+    case OperationType::SET_FEES:
+        return resultCodeName(tr.setFeesResult().code());
+    case OperationType::MANAGE_ACCOUNT:
+        return resultCodeName(tr.manageAccountResult().code());
+    case OperationType::CREATE_WITHDRAWAL_REQUEST:
+        return resultCodeName(tr.createWithdrawalRequestResult().code());
+    case OperationType::MANAGE_BALANCE:
+        return resultCodeName(tr.manageBalanceResult().code());
+    case OperationType::REVIEW_PAYMENT_REQUEST:
+        return resultCodeName(tr.reviewPaymentRequestResult().code());
+    case OperationType::MANAGE_ASSET:
+        return resultCodeName(tr.manageAssetResult().code());
+    case OperationType::CREATE_PREISSUANCE_REQUEST:
+        return resultCodeName(tr.createPreIssuanceRequestResult().code());
+    case OperationType::SET_LIMITS:
+        return resultCodeName(tr.setLimitsResult().code());
+    case OperationType::MANAGE_ASSET_PAIR:
+        return resultCodeName(tr.manageAssetPairResult().code());
+    case OperationType::DIRECT_DEBIT:
+        return resultCodeName(tr.directDebitResult().code());
+    case OperationType::MANAGE_OFFER:
+        return resultCodeName(tr.manageOfferResult().code());
+    case OperationType::MANAGE_INVOICE:
+        return resultCodeName(tr.manageInvoiceResult().code());
+    case OperationType::REVIEW_REQUEST:
+        return resultCodeName(tr.reviewRequestResult().code());
+    case OperationType::CREATE_SALE_REQUEST:
+        return resultCodeName(tr.createSaleCreationRequestResult().code());
+    case OperationType::CHECK_SALE_STATE:
+        return resultCodeName(tr.checkSaleStateResult().code());
+    default:
+        return "unknown";
+    }
+}
+
+std::string
+OperationFrame::getResultCodeAsStr() const
+{
+    return getResultCodeAsStr(mResult);
+}
+
 
 // called when determining if we should accept this operation.
 // called when determining if we should flood
@@ -15,6 +15,7 @@
 #include "overlay/StellarXDR.h"
 #include "util/types.h"
 #include "ledger/FeeFrame.h"
+#include <chrono>
 
 namespace medida
 {
@@ -34,6 +35,24 @@ class OperationFrame
 
   private:
 	bool checkCounterparties(Application& app, std::unordered_map<AccountID, CounterpartyDetails>& counterparties);
+
+    // Debits the metrics of the operation's type, and of its type and result
+    // code, with the time, SQL queries and entry cache lookups spent applying
+    // it.
+    class ApplyContext
+    {
+        Application& mApp;
+        OperationFrame& mOperation;
+
+        std::chrono::steady_clock::time_point mStart;
+        std::uint64_t mSQLQueriesStart;
+        std::uint64_t mCacheHitsStart;
+        std::uint64_t mCacheMissesStart;
+
+      public:
+        ApplyContext(Application& app, OperationFrame& operation);
+        ~ApplyContext();
+    };
   
   protected:
 
@@ -109,6 +128,11 @@ class OperationFrame
         return mResult;
     }
     OperationResultCode getResultCode() const;
+    // The name of the inner result code, if the operation got as far as
+    // having one, or else of the result code. Taken from the result's XDR,
+    // so it's known for every operation type.
+    static std::string getResultCodeAsStr(OperationResult const& result);
+    std::string getResultCodeAsStr() const;
 
     bool checkValid(Application& app, LedgerDelta* delta = nullptr);
 
@@ -12,6 +12,7 @@
 #include "util/XDRStream.h"
 #include "ledger/LedgerDelta.h"
 #include "ledger/AccountHelper.h"
+#include "ledger/ReviewableRequestHelper.h"
 #include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
 #include "database/Database.h"
@@ -379,6 +380,8 @@ bool TransactionFrame::applyTx(LedgerDelta& delta, TransactionMeta& meta,
         auto& opTimer =
             app.getMetrics().NewTimer({ "transaction", "op", "apply" });
 
+        prefetchReviewableRequests(app.getDatabase());
+
         for (auto& op : mOperations)
         {
             auto time = opTimer.TimeScope();
@@ -424,6 +427,24 @@ bool TransactionFrame::applyTx(LedgerDelta& delta, TransactionMeta& meta,
     return !errorEncountered;
 }
 
+void TransactionFrame::prefetchReviewableRequests(Database& db)
+{
+    vector<uint64> requestIDs;
+    for (auto const& op : mEnvelope.tx.operations)
+    {
+        if (op.body.type() == OperationType::REVIEW_REQUEST)
+        {
+            requestIDs.push_back(op.body.reviewRequestOp().requestID);
+        }
+    }
+
+    // a single request is loaded as cheaply when it's reviewed
+    if (requestIDs.size() > 1)
+    {
+        ReviewableRequestHelper::Instance()->prefetch(requestIDs, db);
+    }
+}
+
 void TransactionFrame::unwrapNestedException(const exception& e,
     stringstream& str)
 {
@@ -475,44 +496,36 @@ TransactionFrame::storeTransaction(LedgerManager& ledgerManager,
                                    TransactionMeta& tm, int txindex,
                                    TransactionResultSet& resultSet) const
 {
-    auto txBytes(xdr::xdr_to_opaque(mEnvelope));
-
-    resultSet.results.emplace_back(getResultPair());
-    auto txResultBytes(xdr::xdr_to_opaque(resultSet.results.back()));
-
-    std::string txBody;
-    txBody = bn::encode_b64(txBytes);
+    auto& db = ledgerManager.getDatabase();
 
-    std::string txResult;
-    txResult = bn::encode_b64(txResultBytes);
+    std::vector<uint8_t> txBody(xdr::xdr_to_opaque(mEnvelope));
 
-    xdr::opaque_vec<> txMeta(xdr::xdr_to_opaque(tm));
+    resultSet.results.emplace_back(getResultPair());
+    std::vector<uint8_t> txResult(
+        xdr::xdr_to_opaque(resultSet.results.back()));
 
-    std::string meta;
-    meta = bn::encode_b64(txMeta);
+    std::vector<uint8_t> meta(xdr::xdr_to_opaque(tm));
 
     string txIDString(binToHex(getContentsHash()));
 
-    auto& db = ledgerManager.getDatabase();
-    auto prep = db.getPreparedStatement(
+    BinaryStatement st(
+        db, db.getSession(),
         "INSERT INTO txhistory "
         "( txid, ledgerseq, txindex,  txbody, txresult, txmeta) VALUES "
         "(:id,  :seq,      :txindex, :txb,   :txres,   :meta)");
 
-    auto& st = prep.statement();
-    st.exchange(soci::use(txIDString));
-    st.exchange(soci::use(ledgerManager.getCurrentLedgerHeader().ledgerSeq));
-    st.exchange(soci::use(txindex));
-    st.exchange(soci::use(txBody));
-    st.exchange(soci::use(txResult));
-    st.exchange(soci::use(meta));
-    st.define_and_bind();
+    st.use(txIDString);
+    st.use(ledgerManager.getCurrentLedgerHeader().ledgerSeq);
+    st.use(txindex);
+    st.useBinary(txBody);
+    st.useBinary(txResult);
+    st.useBinary(meta);
     {
         auto timer = db.getInsertTimer("txhistory");
-        st.execute(true);
+        st.execute();
     }
 
-    if (st.get_affected_rows() != 1)
+    if (st.getAffectedRows() != 1)
     {
         throw std::runtime_error("Could not update data in SQL");
     }
@@ -559,31 +572,27 @@ TransactionFrame::storeTransactionFee(LedgerManager& ledgerManager,
                                       LedgerEntryChanges const& changes,
                                       int txindex) const
 {
-    xdr::opaque_vec<> txChanges(xdr::xdr_to_opaque(changes));
+    auto& db = ledgerManager.getDatabase();
 
-    std::string txChanges64;
-    txChanges64 = bn::encode_b64(txChanges);
+    std::vector<uint8_t> txChanges(xdr::xdr_to_opaque(changes));
 
     string txIDString(binToHex(getContentsHash()));
 
-    auto& db = ledgerManager.getDatabase();
-    auto prep = db.getPreparedStatement(
-        "INSERT INTO txfeehistory "
-        "( txid, ledgerseq, txindex,  txchanges) VALUES "
-        "(:id,  :seq,      :txindex, :txchanges)");
+    BinaryStatement st(db, db.getSession(),
+                       "INSERT INTO txfeehistory "
+                       "( txid, ledgerseq, txindex,  txchanges) VALUES "
+                       "(:id,  :seq,      :txindex, :txchanges)");
 
-    auto& st = prep.statement();
-    st.exchange(soci::use(txIDString));
-    st.exchange(soci::use(ledgerManager.getCurrentLedgerHeader().ledgerSeq));
-    st.exchange(soci::use(txindex));
-    st.exchange(soci::use(txChanges64));
-    st.define_and_bind();
+    st.use(txIDString);
+    st.use(ledgerManager.getCurrentLedgerHeader().ledgerSeq);
+    st.use(txindex);
+    st.useBinary(txChanges);
     {
         auto timer = db.getInsertTimer("txfeehistory");
-        st.execute(true);
+        st.execute();
     }
 
-    if (st.get_affected_rows() != 1)
+    if (st.getAffectedRows() != 1)
     {
         throw std::runtime_error("Could not update data in SQL");
     }
@@ -633,21 +642,19 @@ TransactionResultSet
 TransactionFrame::getTransactionHistoryResults(Database& db, uint32 ledgerSeq)
 {
     TransactionResultSet res;
-    std::string txresult64;
-    auto prep =
-        db.getPreparedStatement("SELECT txresult FROM txhistory "
-                                "WHERE ledgerseq = :lseq ORDER BY txindex ASC");
-    auto& st = prep.statement();
+    std::vector<uint8_t> result;
+    BinaryStatement st(db, db.getSession(),
+                       "SELECT txresult FROM txhistory "
+                       "WHERE ledgerseq = :lseq ORDER BY txindex ASC");
 
-    st.exchange(soci::use(ledgerSeq));
-    st.exchange(soci::into(txresult64));
-    st.define_and_bind();
-    st.execute(true);
-    while (st.got_data())
+    st.use(ledgerSeq);
+    st.intoBinary(result);
+    {
+        auto timer = db.getSelectTimer("txhistory");
+        st.execute();
+    }
+    while (st.gotData())
     {
-        std::vector<uint8_t> result;
-        bn::decode_b64(txresult64, result);
-
         res.results.emplace_back();
         TransactionResultPair& p = res.results.back();
 
@@ -663,21 +670,19 @@ std::vector<LedgerEntryChanges>
 TransactionFrame::getTransactionFeeMeta(Database& db, uint32 ledgerSeq)
 {
     std::vector<LedgerEntryChanges> res;
-    std::string changes64;
-    auto prep =
-        db.getPreparedStatement("SELECT txchanges FROM txfeehistory "
-                                "WHERE ledgerseq = :lseq ORDER BY txindex ASC");
-    auto& st = prep.statement();
+    std::vector<uint8_t> changesRaw;
+    BinaryStatement st(db, db.getSession(),
+                       "SELECT txchanges FROM txfeehistory "
+                       "WHERE ledgerseq = :lseq ORDER BY txindex ASC");
 
-    st.exchange(soci::into(changes64));
-    st.exchange(soci::use(ledgerSeq));
-    st.define_and_bind();
-    st.execute(true);
-    while (st.got_data())
+    st.use(ledgerSeq);
+    st.intoBinary(changesRaw);
+    {
+        auto timer = db.getSelectTimer("txfeehistory");
+        st.execute();
+    }
+    while (st.gotData())
     {
-        std::vector<uint8_t> changesRaw;
-        bn::decode_b64(changes64, changesRaw);
-
         xdr::xdr_get g1(&changesRaw.front(), &changesRaw.back() + 1);
         res.emplace_back();
         xdr_argpack_archive(g1, res.back());
@@ -696,7 +701,8 @@ TransactionFrame::copyTransactionsToStream(Hash const& networkID, Database& db,
                                            XDROutputFileStream& txResultOut)
 {
     auto timer = db.getSelectTimer("txhistory");
-    std::string txBody, txResult, txMeta;
+    std::vector<uint8_t> body;
+    std::vector<uint8_t> result;
     uint32_t begin = ledgerSeq, end = ledgerSeq + ledgerCount;
     size_t n = 0;
 
@@ -704,23 +710,26 @@ TransactionFrame::copyTransactionsToStream(Hash const& networkID, Database& db,
     uint32_t curLedgerSeq;
 
     assert(begin <= end);
-    soci::statement st =
-        (sess.prepare << "SELECT ledgerseq, txbody, txresult FROM txhistory "
-                         "WHERE ledgerseq >= :begin AND ledgerseq < :end ORDER "
-                         "BY ledgerseq ASC, txindex ASC",
-         soci::into(curLedgerSeq), soci::into(txBody), soci::into(txResult),
-         soci::use(begin), soci::use(end));
+    BinaryStatement st(db, sess,
+                       "SELECT ledgerseq, txbody, txresult FROM txhistory "
+                       "WHERE ledgerseq >= :begin AND ledgerseq < :end ORDER "
+                       "BY ledgerseq ASC, txindex ASC");
+    st.into(curLedgerSeq);
+    st.intoBinary(body);
+    st.intoBinary(result);
+    st.use(begin);
+    st.use(end);
 
     Hash h;
     TxSetFrame txSet(h); // we're setting the hash later
     TransactionHistoryResultEntry results;
 
-    st.execute(true);
+    st.execute();
 
     uint32_t lastLedgerSeq = curLedgerSeq;
     results.ledgerSeq = curLedgerSeq;
 
-    while (st.got_data())
+    while (st.gotData())
     {
         if (curLedgerSeq != lastLedgerSeq)
         {
@@ -733,12 +742,6 @@ TransactionFrame::copyTransactionsToStream(Hash const& networkID, Database& db,
             lastLedgerSeq = curLedgerSeq;
         }
 
-        std::vector<uint8_t> body;
-        bn::decode_b64(txBody, body);
-
-        std::vector<uint8_t> result;
-        bn::decode_b64(txResult, result);
-
         xdr::xdr_get g1(&body.front(), &body.back() + 1);
         xdr_argpack_archive(g1, tx);
 
@@ -768,22 +771,16 @@ TransactionFrame::copyTransactionsToStream(Hash const& networkID, Database& db,
     return n;
 }
 
-void
-TransactionFrame::dropAll(Database& db)
+static void
+createHistoryTables(Database& db, std::string const& dataType)
 {
-    db.getSession() << "DROP TABLE IF EXISTS txhistory";
-
-    db.getSession() << "DROP TABLE IF EXISTS txfeehistory";
-
-    db.getSession() << "DROP TABLE IF EXISTS txtiming";
-
     db.getSession() << "CREATE TABLE txhistory ("
                        "txid        CHARACTER(64) NOT NULL,"
                        "ledgerseq   INT NOT NULL CHECK (ledgerseq >= 0),"
                        "txindex     INT NOT NULL,"
-                       "txbody      TEXT NOT NULL,"
-                       "txresult    TEXT NOT NULL,"
-                       "txmeta      TEXT NOT NULL,"
+                       "txbody      " << dataType << " NOT NULL,"
+                       "txresult    " << dataType << " NOT NULL,"
+                       "txmeta      " << dataType << " NOT NULL,"
                        "PRIMARY KEY (ledgerseq, txindex)"
                        ")";
 	db.getSession() << "CREATE INDEX txhistroy_id_index ON txhistory(txid);";
@@ -794,18 +791,129 @@ TransactionFrame::dropAll(Database& db)
                        "txid        CHARACTER(64) NOT NULL,"
                        "ledgerseq   INT NOT NULL CHECK (ledgerseq >= 0),"
                        "txindex     INT NOT NULL,"
-                       "txchanges   TEXT NOT NULL,"
+                       "txchanges   " << dataType << " NOT NULL,"
                        "PRIMARY KEY (ledgerseq, txindex)"
                        ")";
 
+    db.getSession() << "CREATE INDEX histfeebyseq ON txfeehistory (ledgerseq);";
+}
+
+void
+TransactionFrame::dropAll(Database& db)
+{
+    db.getSession() << "DROP TABLE IF EXISTS txhistory";
+
+    db.getSession() << "DROP TABLE IF EXISTS txfeehistory";
+
+    db.getSession() << "DROP TABLE IF EXISTS txtiming";
+
+    // base64 TEXT columns, converted to binary by upgradeToBinaryHistory
+    createHistoryTables(db, "TEXT");
+
     db.getSession() << "CREATE TABLE txtiming ("
                        "txid        CHARACTER(64) NOT NULL,"
                        "valid_before   BIGINT NOT NULL CHECK (valid_before >= 0),"
                        "PRIMARY KEY (txid)"
                        ")";
+}
 
+void
+TransactionFrame::upgradeToBinaryHistory(Database& db)
+{
+    auto& sess = db.getSession();
+    if (!db.isSqlite())
+    {
+        sess << "ALTER TABLE txhistory "
+                "ALTER COLUMN txbody TYPE BYTEA USING decode(txbody, 'base64'), "
+                "ALTER COLUMN txresult TYPE BYTEA "
+                "USING decode(txresult, 'base64'), "
+                "ALTER COLUMN txmeta TYPE BYTEA USING decode(txmeta, 'base64')";
+        sess << "ALTER TABLE txfeehistory "
+                "ALTER COLUMN txchanges TYPE BYTEA "
+                "USING decode(txchanges, 'base64')";
+        return;
+    }
+
+    // SQLite can neither change a column's type nor decode base64, so move
+    // the old tables aside and copy their rows into new ones.
+    soci::transaction tx(sess);
+    sess << "DROP INDEX IF EXISTS txhistroy_id_index";
+    sess << "DROP INDEX IF EXISTS histbyseq";
+    sess << "DROP INDEX IF EXISTS histfeebyseq";
+    sess << "ALTER TABLE txhistory RENAME TO txhistory_b64";
+    sess << "ALTER TABLE txfeehistory RENAME TO txfeehistory_b64";
+    createHistoryTables(db, "BLOB");
+
+    std::string txID;
+    uint32_t ledgerSeq;
+    int txIndex;
+    {
+        std::string body64, result64, meta64;
+        std::vector<uint8_t> body, result, meta;
+        soci::statement sel =
+            (sess.prepare << "SELECT txid, ledgerseq, txindex, txbody, "
+                             "txresult, txmeta FROM txhistory_b64",
+             soci::into(txID), soci::into(ledgerSeq), soci::into(txIndex),
+             soci::into(body64), soci::into(result64), soci::into(meta64));
+        BinaryStatement ins(db, sess,
+                            "INSERT INTO txhistory "
+                            "(txid, ledgerseq, txindex, txbody, txresult, "
+                            "txmeta) VALUES "
+                            "(:id, :seq, :txindex, :txb, :txres, :meta)");
+        ins.use(txID);
+        ins.use(ledgerSeq);
+        ins.use(txIndex);
+        ins.useBinary(body);
+        ins.useBinary(result);
+        ins.useBinary(meta);
+        sel.execute(true);
+        while (sel.got_data())
+        {
+            body.clear();
+            bn::decode_b64(body64, body);
+            result.clear();
+            bn::decode_b64(result64, result);
+            meta.clear();
+            bn::decode_b64(meta64, meta);
+            {
+                auto timer = db.getInsertTimer("txhistory");
+                ins.execute();
+            }
+            sel.fetch();
+        }
+    }
+    {
+        std::string changes64;
+        std::vector<uint8_t> changes;
+        soci::statement sel =
+            (sess.prepare << "SELECT txid, ledgerseq, txindex, txchanges "
+                             "FROM txfeehistory_b64",
+             soci::into(txID), soci::into(ledgerSeq), soci::into(txIndex),
+             soci::into(changes64));
+        BinaryStatement ins(db, sess,
+                            "INSERT INTO txfeehistory "
+                            "(txid, ledgerseq, txindex, txchanges) VALUES "
+                            "(:id, :seq, :txindex, :txchanges)");
+        ins.use(txID);
+        ins.use(ledgerSeq);
+        ins.use(txIndex);
+        ins.useBinary(changes);
+        sel.execute(true);
+        while (sel.got_data())
+        {
+            changes.clear();
+            bn::decode_b64(changes64, changes);
+            {
+                auto timer = db.getInsertTimer("txfeehistory");
+                ins.execute();
+            }
+            sel.fetch();
+        }
+    }
 
-    db.getSession() << "CREATE INDEX histfeebyseq ON txfeehistory (ledgerseq);";
+    sess << "DROP TABLE txhistory_b64";
+    sess << "DROP TABLE txfeehistory_b64";
+    tx.commit();
 }
 
 void
@@ -57,6 +57,8 @@ class TransactionFrame
 	void resetSignatureTracker();
     void resetResults();
     void markResultFailed();
+    // loads the requests reviewed by the transaction in one go
+    void prefetchReviewableRequests(Database& db);
 
     bool applyTx(LedgerDelta& delta, TransactionMeta& meta, Application& app, std::vector<LedgerDelta::KeyEntryMap>& stateBeforeOp);
     static void unwrapNestedException(const std::exception& e, std::stringstream& str);
@@ -207,6 +209,10 @@ class TransactionFrame
                                            XDROutputFileStream& txResultOut);
     static void dropAll(Database& db);
 
+    // Schema upgrade converting the base64 TEXT columns of txhistory and
+    // txfeehistory to binary, existing rows included.
+    static void upgradeToBinaryHistory(Database& db);
+
     static void deleteOldEntries(Database& db, uint32_t ledgerSeq,
         uint64 ledgerCloseTime);
 
@@ -0,0 +1,74 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "transactions/dex/BalanceBatch.h"
+#include "ledger/BalanceHelper.h"
+#include "ledger/LedgerDelta.h"
+#include "util/Logging.h"
+
+#include <cassert>
+
+namespace stellar
+{
+
+BalanceBatch::BalanceBatch(LedgerDelta& delta, Database& db)
+    : mDelta(delta), mDb(db)
+{
+}
+
+BalanceFrame::pointer
+BalanceBatch::load(BalanceID const& balanceID)
+{
+    auto it = mBalances.find(balanceID);
+    if (it != mBalances.end())
+    {
+        return it->second;
+    }
+
+    auto balance =
+        BalanceHelper::Instance()->loadBalance(balanceID, mDb, &mDelta);
+    if (!balance)
+    {
+        CLOG(ERROR, Logging::OPERATION_LOGGER)
+            << "Invalid database state: offer must have matching balance: "
+            << BalanceKeyUtils::toStrKey(balanceID);
+        throw std::runtime_error(
+            "invalid database state: offer must have matching balance");
+    }
+    mBalances[balanceID] = balance;
+    return balance;
+}
+
+void
+BalanceBatch::change(BalanceFrame::pointer const& balance)
+{
+    assert(mBalances[balance->getBalanceID()] == balance);
+    if (!balance->isValid())
+    {
+        throw std::runtime_error("Invalid balance");
+    }
+
+    balance->touch(mDelta);
+    mDelta.modEntry(*balance);
+    if (mChangedIDs.insert(balance->getBalanceID()).second)
+    {
+        mChanged.push_back(balance);
+    }
+}
+
+void
+BalanceBatch::flush()
+{
+    std::vector<LedgerEntry> entries;
+    entries.reserve(mChanged.size());
+    for (auto const& balance : mChanged)
+    {
+        entries.push_back(balance->mEntry);
+    }
+    BalanceHelper::Instance()->updateBalances(entries, mDb);
+
+    mChanged.clear();
+    mChangedIDs.clear();
+}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/BalanceFrame.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace stellar
+{
+class Database;
+class LedgerDelta;
+
+/**
+ * The balances behind the offers one operation goes through, each loaded
+ * once however many of its offers are matched or cancelled, and written back
+ * once by flush(). Every change is recorded in the delta as it's made, so the
+ * meta is the same as if each had been stored right away; only the database
+ * writes are put off, and then done in one statement.
+ */
+class BalanceBatch
+{
+    LedgerDelta& mDelta;
+    Database& mDb;
+
+    std::unordered_map<BalanceID, BalanceFrame::pointer> mBalances;
+    // changed since the last flush, each once
+    std::vector<BalanceFrame::pointer> mChanged;
+    std::unordered_set<BalanceID> mChangedIDs;
+
+  public:
+    BalanceBatch(LedgerDelta& delta, Database& db);
+
+    // Throws if the balance doesn't exist: offers never outlive theirs.
+    BalanceFrame::pointer load(BalanceID const& balanceID);
+
+    // Records the current state of a balance loaded above.
+    void change(BalanceFrame::pointer const& balance);
+
+    void flush();
+};
+}
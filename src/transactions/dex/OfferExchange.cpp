@@ -8,6 +8,7 @@
 #include "ledger/LedgerManager.h"
 #include "ledger/BalanceHelper.h"
 #include "ledger/OfferHelper.h"
+#include "ledger/OrderBookCache.h"
 #include "util/Logging.h"
 #include "xdrpp/printer.h"
 
@@ -22,6 +23,7 @@ OfferExchange::OfferExchange(AccountManager& accountManager, LedgerDelta& delta,
     , mAccountManager(accountManager)
     , mAssetPair(assetPair)
     , mCommissionBalance(commissionBalance)
+    , mBalances(delta, ledgerManager.getDatabase())
 {
     mNow = mLedgerManager.getCloseTime();
     mFeePaidByA = 0;
@@ -182,21 +184,6 @@ void OfferExchange::unlockBalancesForTakenOffer(OfferFrame& offer,
         throw std::runtime_error("Failed to mark offer as taken");
 }
 
-BalanceFrame::pointer OfferExchange::loadBalance(
-    BalanceID& balanceID, Database& db)
-{
-    auto balanceHelper = BalanceHelper::Instance();
-    BalanceFrame::pointer balance = balanceHelper->loadBalance(balanceID, db,
-                                                               &mDelta);
-    if (!balance)
-    {
-        throw std::runtime_error(
-                                 "invalid database state: offer must have matching balance");
-    }
-
-    return balance;
-}
-
 bool OfferExchange::isOfferPriceMeetAssetPairRestrictions(
     AssetPairFrame::pointer assetPair, int64_t offerPrice)
 {
@@ -268,11 +255,11 @@ OfferExchange::CrossOfferResult OfferExchange::crossOffer(
     Database& db = mLedgerManager.getDatabase();
 
     OfferEntry& offerB = offerFrameB.getOffer();
-    BalanceFrame::pointer baseBalanceB = loadBalance(offerB.baseBalance, db);
+    BalanceFrame::pointer baseBalanceB = mBalances.load(offerB.baseBalance);
     bool isOfferValid = true;
 
     // if first balance is not valid - no need to load second
-    BalanceFrame::pointer quoteBalanceB = loadBalance(offerB.quoteBalance, db);
+    BalanceFrame::pointer quoteBalanceB = mBalances.load(offerB.quoteBalance);
 
     isOfferValid = isOfferValid &&
                    isOfferPriceMeetAssetPairRestrictions(mAssetPair,
@@ -281,12 +268,42 @@ OfferExchange::CrossOfferResult OfferExchange::crossOffer(
     // one of the balances is not valid for trading or offer does not meet asset pair restrictions, so canceling offer
     if (!isOfferValid)
     {
+        // Only the base balance has ever been stored here, so a buy offer's
+        // quote stays locked. The ledger depends on it: unlock a copy that's
+        // thrown away, leaving the loaded quote balance as it is.
+        auto discardedQuoteBalanceB =
+            std::make_shared<BalanceFrame>(*quoteBalanceB);
+        markOfferAsTaken(offerFrameB, baseBalanceB, discardedQuoteBalanceB, db);
+        mBalances.change(baseBalanceB);
+        return eOfferTaken;
+    }
+
+    if (matchOffers(offerA, baseBalanceA, quoteBalanceA, offerB, baseBalanceB,
+                    quoteBalanceB) == eOfferCantConvert)
+    {
+        return eOfferCantConvert;
+    }
+
+    if (!offerNeedsMore(offerB))
+    {
+        // entire offer is taken
         markOfferAsTaken(offerFrameB, baseBalanceB, quoteBalanceB, db);
-        EntryHelperProvider::storeChangeEntry(mDelta, db, baseBalanceB->mEntry);
-        EntryHelperProvider::storeChangeEntry(mDelta, db, baseBalanceB->mEntry);
+        mBalances.change(baseBalanceB);
+        mBalances.change(quoteBalanceB);
         return eOfferTaken;
     }
 
+    EntryHelperProvider::storeChangeEntry(mDelta, db, offerFrameB.mEntry);
+    mBalances.change(baseBalanceB);
+    mBalances.change(quoteBalanceB);
+    return eOfferPartial;
+}
+
+OfferExchange::CrossOfferResult OfferExchange::matchOffers(
+    OfferEntry& offerA, BalanceFrame::pointer baseBalanceA,
+    BalanceFrame::pointer quoteBalanceA, OfferEntry& offerB,
+    BalanceFrame::pointer baseBalanceB, BalanceFrame::pointer quoteBalanceB)
+{
     auto exchangeResult = exchange(offerA, offerB);
     if (exchangeResult.type == ExchangeResultType::RESULT_OVERFLOW)
         return eOfferCantConvert;
@@ -296,7 +313,7 @@ OfferExchange::CrossOfferResult OfferExchange::crossOffer(
         LOG(ERROR) << "baseAmountA: " << offerA.baseAmount << " quoteAmountA: "
             << offerA.quoteAmount << " baseAmountB: " << offerB.baseAmount <<
             " quoteAmountB:" << offerB.quoteAmount << " matchingPrice: " <<
-            offerFrameB.getPrice() << " offerB is buy:" << offerB.isBuy;
+            offerB.price << " offerB is buy:" << offerB.isBuy;
         throw std::runtime_error("After match baseDelta or quoteDelta is zero");
     }
 
@@ -311,20 +328,7 @@ OfferExchange::CrossOfferResult OfferExchange::crossOffer(
     assert(mCommissionBalance->addBalance(exchangeResult.buyerFee));
     assert(mCommissionBalance->addBalance(exchangeResult.sellerFee));
 
-    if (!offerNeedsMore(offerB))
-    {
-        // entire offer is taken
-        markOfferAsTaken(offerFrameB, baseBalanceB, quoteBalanceB, db);
-        EntryHelperProvider::storeChangeEntry(mDelta, db, baseBalanceB->mEntry);
-        EntryHelperProvider::
-            storeChangeEntry(mDelta, db, quoteBalanceB->mEntry);
-        return eOfferTaken;
-    }
-
-    EntryHelperProvider::storeChangeEntry(mDelta, db, offerFrameB.mEntry);
-    EntryHelperProvider::storeChangeEntry(mDelta, db, baseBalanceB->mEntry);
-    EntryHelperProvider::storeChangeEntry(mDelta, db, quoteBalanceB->mEntry);
-    return eOfferPartial;
+    return offerNeedsMore(offerB) ? eOfferPartial : eOfferTaken;
 }
 
 bool OfferExchange::offerNeedsMore(OfferEntry& offer)
@@ -351,25 +355,42 @@ OfferExchange::convertWithOffers(
     OfferEntry& offerA, BalanceFrame::pointer baseBalanceA,
     BalanceFrame::pointer quoteBalanceA,
     std::function<OfferFilterResult(OfferFrame const&)> filter)
+{
+    auto res = crossOffers(offerA, baseBalanceA, quoteBalanceA, filter);
+    // a maker's balance is written once, however many of its offers were
+    // crossed
+    mBalances.flush();
+    return res;
+}
+
+OfferExchange::ConvertResult
+OfferExchange::crossOffers(
+    OfferEntry& offerA, BalanceFrame::pointer baseBalanceA,
+    BalanceFrame::pointer quoteBalanceA,
+    std::function<OfferFilterResult(OfferFrame const&)> const& filter)
 {
     const size_t OFFERS_TO_TAKE = 5;
     Database& db = mLedgerManager.getDatabase();
+    auto& orderBooks = db.getOrderBookCache();
 
-    size_t offerOffset = 0;
+    // offers taken leave the book, so resume after the last one looked at
+    // rather than counting how far in we are
+    OrderBookCache::Position cursor;
+    bool haveCursor = false;
 
     while (offerNeedsMore(offerA))
     {
         std::vector<OfferFrame::pointer> retList;
-        auto offerHelper = OfferHelper::Instance();
-        offerHelper->loadBestOffers(OFFERS_TO_TAKE, offerOffset,
-                                    mAssetPair->getBaseAsset(),
-                                    mAssetPair->getQuoteAsset(), mOrderBookID, !offerA.isBuy,
-                                    retList, db);
-
-        offerOffset += retList.size();
+        orderBooks.loadBestOffers(OFFERS_TO_TAKE, mAssetPair->getBaseAsset(),
+                                  mAssetPair->getQuoteAsset(), mOrderBookID,
+                                  !offerA.isBuy, haveCursor ? &cursor : nullptr,
+                                  retList, db);
 
         for (auto& offerB : retList)
         {
+            cursor = {offerB->getPrice(), offerB->getOfferID()};
+            haveCursor = true;
+
             if (filter)
             {
                 OfferFilterResult r = filter(*offerB);
@@ -390,9 +411,6 @@ OfferExchange::convertWithOffers(
             switch (cor)
             {
             case eOfferTaken:
-                assert(offerOffset > 0);
-                offerOffset--; // adjust offset as an offer was deleted
-                break;
             case eOfferPartial:
                 break;
             case eOfferCantConvert:
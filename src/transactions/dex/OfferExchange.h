@@ -6,6 +6,7 @@
 
 #include "ledger/OfferFrame.h"
 #include "ledger/AssetPairFrame.h"
+#include "transactions/dex/BalanceBatch.h"
 #include <functional>
 #include <vector>
 #include "transactions/AccountManager.h"
@@ -43,6 +44,9 @@ class OfferExchange
 
     BalanceFrame::pointer mCommissionBalance;
 
+    // the balances of the offers crossed, written back once matching is done
+    BalanceBatch mBalances;
+
     std::vector<ClaimOfferAtom> mOfferTrail;
     int64_t mFeePaidByA;
 
@@ -69,22 +73,30 @@ private:
                             int64_t sellerBase, int64_t sellerQuote,
                             int64_t matchPrice);
 
-    BalanceFrame::pointer loadBalance(BalanceID& balanceID, Database& db);
-
     // deletes offer and unlockes locked amount
     void markOfferAsTaken(OfferFrame& offer, BalanceFrame::pointer baseBalance,
                           BalanceFrame::pointer quoteBalance, Database& db);
 
+    // changes offerB's balances only in mBalances, which the caller flushes
+    CrossOfferResult crossOffer(OfferEntry& offerA,
+                                BalanceFrame::pointer baseBalanceA,
+                                BalanceFrame::pointer quoteBalanceA,
+                                OfferFrame& offerB);
+
 public:
     OfferExchange(AccountManager& accountManager, LedgerDelta& delta,
                   LedgerManager& ledgerManager,
                   AssetPairFrame::pointer assetPair,
                   BalanceFrame::pointer commissionBalance, uint64_t orderBookID);
 
-    CrossOfferResult crossOffer(OfferEntry& offerA,
-                                BalanceFrame::pointer baseBalanceA,
-                                BalanceFrame::pointer quoteBalanceA,
-                                OfferFrame& offerB);
+    // matches offerA against offerB, updating both offers, their balances
+    // and the commission balance in memory only; the caller stores them
+    CrossOfferResult matchOffers(OfferEntry& offerA,
+                                 BalanceFrame::pointer baseBalanceA,
+                                 BalanceFrame::pointer quoteBalanceA,
+                                 OfferEntry& offerB,
+                                 BalanceFrame::pointer baseBalanceB,
+                                 BalanceFrame::pointer quoteBalanceB);
 
     enum OfferFilterResult
     {
@@ -100,6 +112,14 @@ public:
         eFilterStop
     };
 
+private:
+    ConvertResult crossOffers(OfferEntry& offerA,
+                              BalanceFrame::pointer baseBalanceA,
+                              BalanceFrame::pointer quoteBalanceA,
+                              std::function<OfferFilterResult(
+                                  OfferFrame const& offer)> const& filter);
+
+public:
     // buys wheat with sheep, crossing as many offers as necessary
     ConvertResult convertWithOffers(OfferEntry& offerA,
                                     BalanceFrame::pointer baseBalanceA,
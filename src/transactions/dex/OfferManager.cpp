@@ -3,6 +3,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "OfferManager.h"
+#include "BalanceBatch.h"
 #include "ledger/BalanceHelper.h"
 #include "ledger/LedgerDelta.h"
 #include "xdrpp/printer.h"
@@ -10,17 +11,10 @@
 
 namespace stellar
 {
-void OfferManager::deleteOffer(OfferFrame::pointer offerFrame, Database& db,
-    LedgerDelta& delta)
+void OfferManager::unlockAndDeleteOffer(OfferFrame::pointer offerFrame,
+    BalanceBatch& balances, Database& db, LedgerDelta& delta)
 {
-    const auto balanceID = offerFrame->getLockedBalance();
-    auto balanceFrame = BalanceHelper::Instance()->loadBalance(balanceID, db, &delta);
-    if (!balanceFrame)
-    {
-        CLOG(ERROR, Logging::OPERATION_LOGGER) << "Invalid database state: failed to load balance to cancel order: " << xdr::xdr_to_string(offerFrame->getOffer());
-        throw std::runtime_error("Invalid database state: failed to load balance to cancel order");
-    }
-
+    auto balanceFrame = balances.load(offerFrame->getLockedBalance());
     const auto amountToUnlock = offerFrame->getLockedAmount();
     if (!balanceFrame->unlock(amountToUnlock))
     {
@@ -29,17 +23,29 @@ void OfferManager::deleteOffer(OfferFrame::pointer offerFrame, Database& db,
     }
 
     EntryHelperProvider::storeDeleteEntry(delta, db, offerFrame->getKey());
-    EntryHelperProvider::storeChangeEntry(delta, db, balanceFrame->mEntry);
+    balances.change(balanceFrame);
+}
+
+void OfferManager::deleteOffer(OfferFrame::pointer offerFrame, Database& db,
+    LedgerDelta& delta)
+{
+    BalanceBatch balances(delta, db);
+    unlockAndDeleteOffer(offerFrame, balances, db, delta);
+    balances.flush();
 }
 
 void OfferManager::deleteOffers(std::vector<OfferFrame::pointer> offers,
     Database& db, LedgerDelta& delta)
 {
+    // offers being cancelled in bulk mostly share owners, so each balance is
+    // loaded and written once
+    BalanceBatch balances(delta, db);
     for (auto& offer : offers)
     {
         delta.recordEntry(*offer);
-        deleteOffer(offer, db, delta);
+        unlockAndDeleteOffer(offer, balances, db, delta);
     }
+    balances.flush();
 }
 
 OfferFrame::pointer OfferManager::buildOffer(AccountID const& sourceID, ManageOfferOp const& op,
@@ -12,9 +12,13 @@
 
 namespace stellar
 {
+class BalanceBatch;
 
 class OfferManager
 {
+    // unlocks the amount locked by offer, in balances, and deletes the offer
+    static void unlockAndDeleteOffer(OfferFrame::pointer offerFrame, BalanceBatch& balances, Database& db, LedgerDelta& delta);
+
 public:
     // delets offer and unlock locked assets by that offer
     static void deleteOffer(OfferFrame::pointer offerFrame, Database& db, LedgerDelta& delta);
@@ -0,0 +1,470 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "SaleSettlement.h"
+#include "OfferExchange.h"
+#include "OfferManager.h"
+#include "bucket/LedgerCmp.h"
+#include "database/Database.h"
+#include "ledger/AssetPairHelper.h"
+#include "ledger/BalanceHelper.h"
+#include "ledger/LedgerDelta.h"
+#include "ledger/LedgerManager.h"
+#include "ledger/OfferHelper.h"
+#include "main/Application.h"
+#include "transactions/AccountManager.h"
+#include "transactions/FeesManager.h"
+#include "util/Logging.h"
+#include "xdrpp/printer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <unordered_set>
+
+namespace stellar
+{
+using namespace std;
+using xdr::operator==;
+
+SaleSettlement::SaleSettlement(Application& app, LedgerManager& lm,
+                               LedgerDelta& delta, SaleFrame::pointer sale,
+                               SaleQuoteAsset const& quoteAsset,
+                               AccountFrame::pointer saleOwner)
+    : mApp(app)
+    , mLedgerManager(lm)
+    , mDelta(delta)
+    , mDb(app.getDatabase())
+    , mSale(sale)
+    , mQuoteAsset(quoteAsset)
+    , mSaleOwner(saleOwner)
+{
+}
+
+bool
+SaleSettlement::prepareSaleOffer()
+{
+    // what CheckSaleStateOpFrame::applySaleOffer and CreateOfferOpFrame
+    // check before matching; whatever fails is left to them to report
+    auto balanceHelper = BalanceHelper::Instance();
+    auto const& ownerID = mSale->getOwnerID();
+    mBaseBalance =
+        balanceHelper->mustLoadBalance(mSale->getBaseBalanceID(), mDb);
+    mQuoteBalance = balanceHelper->loadBalance(mQuoteAsset.quoteBalance, mDb);
+    if (!mQuoteBalance || !(mBaseBalance->getAccountID() == ownerID) ||
+        !(mQuoteBalance->getAccountID() == ownerID) ||
+        mBaseBalance->getAsset() == mQuoteBalance->getAsset())
+    {
+        return false;
+    }
+    record(*mBaseBalance);
+    record(*mQuoteBalance);
+
+    const auto baseAmount =
+        min(mSale->getBaseAmountForCurrentCap(mQuoteAsset.quoteAsset),
+            static_cast<uint64_t>(mBaseBalance->getAmount()));
+    const auto quoteAmount =
+        OfferManager::calculateQuoteAmount(baseAmount, mQuoteAsset.price);
+    const auto feeResult = FeeManager::calculateOfferFeeForAccount(
+        mSaleOwner, mQuoteAsset.quoteAsset, quoteAmount, mDb);
+    if (feeResult.isOverflow)
+    {
+        return false;
+    }
+
+    const auto op = OfferManager::buildManageOfferOp(
+        mSale->getBaseBalanceID(), mQuoteAsset.quoteBalance, false, baseAmount,
+        mQuoteAsset.price, feeResult.calculatedPercentFee, 0, mSale->getID());
+    if (op.amount <= 0 || op.price <= 0 || op.fee < 0 ||
+        OfferManager::calculateQuoteAmount(op.amount, op.price) <= 0)
+    {
+        return false;
+    }
+
+    if (!AccountManager::isAllowedToReceive(op.quoteBalance, mDb))
+    {
+        return false;
+    }
+
+    mAssetPair = AssetPairHelper::Instance()->loadAssetPair(
+        mBaseBalance->getAsset(), mQuoteBalance->getAsset(), mDb);
+    if (!mAssetPair)
+    {
+        return false;
+    }
+    record(*mAssetPair);
+
+    mSaleOffer = OfferManager::buildOffer(ownerID, op, mBaseBalance->getAsset(),
+                                          mQuoteBalance->getAsset());
+    if (!mSaleOffer)
+    {
+        return false;
+    }
+
+    auto& offer = mSaleOffer->getOffer();
+    offer.createdAt = mLedgerManager.getCloseTime();
+    const auto offerFee = FeeManager::calculateOfferFeeForAccount(
+        mSaleOwner, mQuoteBalance->getAsset(), offer.quoteAmount, mDb);
+    if (offerFee.isOverflow)
+    {
+        return false;
+    }
+
+    offer.percentFee = offerFee.percentFee;
+    offer.fee = offerFee.calculatedPercentFee;
+    if (offer.fee > op.fee)
+    {
+        return false;
+    }
+
+    offer.fee = op.fee;
+    if (offer.quoteAmount <= offer.fee || offer.baseAmount <= 0 ||
+        mBaseBalance->lockBalance(offer.baseAmount) !=
+            BalanceFrame::Result::SUCCESS)
+    {
+        return false;
+    }
+
+    // created only once settling can't fail any more; until then the
+    // commission is collected in a balance of no ledger's
+    mCommissionBalance = balanceHelper->loadBalance(
+        mApp.getCommissionID(), mAssetPair->getQuoteAsset(), mDb, nullptr);
+    mCommissionExists = !!mCommissionBalance;
+    if (!mCommissionExists)
+    {
+        mCommissionBalance = BalanceFrame::createNew(
+            BalanceID(), mApp.getCommissionID(), mAssetPair->getQuoteAsset());
+        return true;
+    }
+
+    // CreateOfferOpFrame would work on two frames of the same balance
+    if (mCommissionBalance->getBalanceID() == mBaseBalance->getBalanceID() ||
+        mCommissionBalance->getBalanceID() == mQuoteBalance->getBalanceID())
+    {
+        return false;
+    }
+    record(*mCommissionBalance);
+    return true;
+}
+
+void
+SaleSettlement::createCommissionBalance()
+{
+    if (mCommissionExists)
+    {
+        return;
+    }
+
+    auto collected = mCommissionBalance->getAmount();
+    mCommissionBalance = AccountManager::loadOrCreateBalanceFrameForAsset(
+        mApp.getCommissionID(), mAssetPair->getQuoteAsset(), mDb, mDelta);
+    if (!mCommissionBalance->tryFundAccount(
+            static_cast<uint64_t>(collected)))
+    {
+        CLOG(ERROR, Logging::OPERATION_LOGGER)
+            << "Unexpected state: failed to fund new commission balance "
+            << BalanceKeyUtils::toStrKey(mCommissionBalance->getBalanceID())
+            << " with " << collected;
+        throw runtime_error(
+            "Unexpected state: failed to fund new commission balance");
+    }
+    mCommissionExists = true;
+}
+
+bool
+SaleSettlement::loadOrderBook()
+{
+    auto orderBookID = mSale->getID();
+    mOffers = OfferHelper::Instance()->loadOffersWithFilters(
+        mSale->getBaseAsset(), mQuoteAsset.quoteAsset, &orderBookID, nullptr,
+        mDb);
+    mBalances = BalanceHelper::Instance()->loadOrderBookBalances(
+        mSale->getBaseAsset(), mQuoteAsset.quoteAsset, orderBookID, mDb);
+
+    // CreateOfferOpFrame keeps the sale's and the commission balances aside
+    // while it reloads the others for every offer; keeping one frame per
+    // balance throughout agrees with that only if no offer shares them
+    vector<BalanceID> kept = {mBaseBalance->getBalanceID(),
+                              mQuoteBalance->getBalanceID()};
+    if (mCommissionExists)
+    {
+        kept.push_back(mCommissionBalance->getBalanceID());
+    }
+    for (auto const& balanceID : kept)
+    {
+        if (mBalances.find(balanceID) != mBalances.end())
+        {
+            return false;
+        }
+    }
+    mBalances[mBaseBalance->getBalanceID()] = mBaseBalance;
+    mBalances[mQuoteBalance->getBalanceID()] = mQuoteBalance;
+    return true;
+}
+
+BalanceFrame::pointer
+SaleSettlement::getBalance(BalanceID const& balanceID)
+{
+    auto it = mBalances.find(balanceID);
+    if (it == mBalances.end())
+    {
+        return nullptr;
+    }
+    record(*it->second);
+    return it->second;
+}
+
+void
+SaleSettlement::record(EntryFrame const& entry)
+{
+    mRecords.push_back(entry.copy());
+}
+
+void
+SaleSettlement::add(EntryFrame const& entry)
+{
+    mWrites.push_back({Write::ADD, entry.getKey(), entry.copy()});
+}
+
+void
+SaleSettlement::change(EntryFrame const& entry)
+{
+    mWrites.push_back({Write::CHANGE, entry.getKey(), entry.copy()});
+}
+
+void
+SaleSettlement::remove(LedgerKey const& key)
+{
+    mWrites.push_back({Write::REMOVE, key, nullptr});
+}
+
+void
+SaleSettlement::flush()
+{
+    map<LedgerKey, size_t, LedgerEntryIdCmp> lastWrite;
+    for (size_t i = 0; i < mWrites.size(); i++)
+    {
+        lastWrite[mWrites[i].mKey] = i;
+    }
+
+    // the entries as they were before settling, for the meta; the first
+    // record of an entry is the one kept
+    for (auto const& entry : mRecords)
+    {
+        mDelta.recordEntry(*entry);
+    }
+
+    // every write is recorded in the delta in its turn, so that the meta is
+    // the same as if each had been stored then; but only the last write of
+    // an entry goes to the database
+    vector<LedgerEntry> balances;
+    vector<uint64_t> deletedOffers;
+    for (size_t i = 0; i < mWrites.size(); i++)
+    {
+        auto& write = mWrites[i];
+        const bool isLast = lastWrite[write.mKey] == i;
+        switch (write.mType)
+        {
+        case Write::ADD:
+            EntryHelperProvider::storeAddEntry(mDelta, mDb,
+                                               write.mEntry->mEntry);
+            break;
+        case Write::CHANGE:
+            if (isLast && write.mKey.type() != LedgerEntryType::BALANCE)
+            {
+                EntryHelperProvider::storeChangeEntry(mDelta, mDb,
+                                                      write.mEntry->mEntry);
+                break;
+            }
+            write.mEntry->touch(mDelta);
+            mDelta.modEntry(*write.mEntry);
+            if (isLast)
+            {
+                balances.push_back(write.mEntry->mEntry);
+            }
+            break;
+        case Write::REMOVE:
+            // only offers are removed, and nothing is written after that
+            assert(isLast);
+            assert(write.mKey.type() == LedgerEntryType::OFFER_ENTRY);
+            mDelta.deleteEntry(write.mKey);
+            deletedOffers.push_back(write.mKey.offer().offerID);
+            break;
+        }
+    }
+
+    BalanceHelper::Instance()->updateBalances(balances, mDb);
+    OfferHelper::Instance()->deleteOffers(deletedOffers, mDb);
+    CLOG(DEBUG, Logging::OPERATION_LOGGER)
+        << "Settled sale " << mSale->getID() << " in "
+        << mQuoteAsset.quoteAsset << ": " << mWrites.size() << " writes, "
+        << balances.size() << " balances updated, " << deletedOffers.size()
+        << " offers deleted";
+}
+
+bool
+SaleSettlement::settle(ManageOfferSuccessResult& result)
+{
+    if (!prepareSaleOffer() || !loadOrderBook())
+    {
+        return false;
+    }
+
+    // participations, in the order CreateOfferOpFrame would match them:
+    // best price first, then oldest first
+    vector<OfferFrame::pointer> participations;
+    for (auto const& offer : mOffers)
+    {
+        if (offer->getOffer().isBuy)
+        {
+            participations.push_back(offer);
+        }
+    }
+    stable_sort(participations.begin(), participations.end(),
+                [](OfferFrame::pointer const& l, OfferFrame::pointer const& r) {
+                    return l->getPrice() > r->getPrice();
+                });
+
+    auto const& ownerID = mSale->getOwnerID();
+    auto& offer = mSaleOffer->getOffer();
+    AccountManager accountManager(mApp, mDb, mDelta, mLedgerManager);
+    OfferExchange oe(accountManager, mDelta, mLedgerManager, mAssetPair,
+                     mCommissionBalance, mSale->getID());
+
+    // Matching only changes frames in memory, and queues their writes and
+    // the records of their previous state; on anything unexpected all of
+    // that is dropped and CreateOfferOpFrame is left to make of it what it
+    // does. Nothing reaches the delta or the database before the offers
+    // claimed are known to be settled.
+    unordered_set<uint64_t> taken;
+    for (auto const& offerFrameB : participations)
+    {
+        if (!oe.offerNeedsMore(offer))
+        {
+            break;
+        }
+
+        auto& offerB = offerFrameB->getOffer();
+        if (offerFrameB->getPrice() < offer.price)
+        {
+            break;
+        }
+        if (offerB.ownerID == ownerID)
+        {
+            return false;
+        }
+
+        record(*offerFrameB);
+        auto baseBalanceB = getBalance(offerB.baseBalance);
+        auto quoteBalanceB = getBalance(offerB.quoteBalance);
+        if (!baseBalanceB || !quoteBalanceB ||
+            !OfferExchange::isOfferPriceMeetAssetPairRestrictions(
+                mAssetPair, offerFrameB->getPrice()))
+        {
+            return false;
+        }
+
+        auto r = oe.matchOffers(offer, mBaseBalance, mQuoteBalance, offerB,
+                                baseBalanceB, quoteBalanceB);
+        if (r == OfferExchange::eOfferCantConvert)
+        {
+            return false;
+        }
+
+        if (r == OfferExchange::eOfferTaken)
+        {
+            remove(offerFrameB->getKey());
+            OfferExchange::unlockBalancesForTakenOffer(
+                *offerFrameB, baseBalanceB, quoteBalanceB);
+            change(*baseBalanceB);
+            change(*quoteBalanceB);
+            taken.insert(offerB.offerID);
+            continue;
+        }
+
+        change(*offerFrameB);
+        change(*baseBalanceB);
+        change(*quoteBalanceB);
+        break;
+    }
+
+    auto const& offersClaimed = oe.getOfferTrail();
+    if (offersClaimed.empty())
+    {
+        return false;
+    }
+
+    // from here on there's no going back
+    createCommissionBalance();
+    for (auto const& claim : offersClaimed)
+    {
+        result.offersClaimed.push_back(claim);
+    }
+    mAssetPair->setCurrentPrice(offersClaimed.back().currentPrice);
+    change(*mAssetPair);
+    change(*mCommissionBalance);
+
+    vector<OfferFrame::pointer> remaining;
+    for (auto const& o : mOffers)
+    {
+        if (taken.find(o->getOfferID()) == taken.end())
+        {
+            remaining.push_back(o);
+        }
+    }
+
+    if (oe.offerNeedsMore(offer))
+    {
+        // the newest offer of all, so the last one to be cancelled
+        offer.offerID =
+            mDelta.getHeaderFrame().generateID(LedgerEntryType::OFFER_ENTRY);
+        result.offer.effect(ManageOfferEffect::CREATED);
+        result.offer.offer() = offer;
+        add(*mSaleOffer);
+        remaining.push_back(mSaleOffer);
+    }
+    else
+    {
+        OfferExchange::unlockBalancesForTakenOffer(*mSaleOffer, mBaseBalance,
+                                                   mQuoteBalance);
+        result.offer.effect(ManageOfferEffect::DELETED);
+    }
+
+    result.baseAsset = mAssetPair->getBaseAsset();
+    result.quoteAsset = mAssetPair->getQuoteAsset();
+    change(*mBaseBalance);
+    change(*mQuoteBalance);
+
+    // what's left of the book is cancelled, as OfferManager::deleteOffers
+    // would
+    for (auto const& o : remaining)
+    {
+        record(*o);
+        auto balance = getBalance(o->getLockedBalance());
+        if (!balance)
+        {
+            CLOG(ERROR, Logging::OPERATION_LOGGER)
+                << "Invalid database state: failed to load balance to cancel "
+                   "order: "
+                << xdr::xdr_to_string(o->getOffer());
+            throw runtime_error("Invalid database state: failed to load "
+                                "balance to cancel order");
+        }
+        if (!balance->unlock(o->getLockedAmount()))
+        {
+            CLOG(ERROR, Logging::OPERATION_LOGGER)
+                << "Invalid database state: failed to unlocked locked amount "
+                   "for offer: "
+                << xdr::xdr_to_string(o->getOffer());
+            throw runtime_error("Invalid database state: failed to unlocked "
+                                "locked amount for offer");
+        }
+        remove(o->getKey());
+        change(*balance);
+    }
+
+    flush();
+    return true;
+}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/AccountFrame.h"
+#include "ledger/AssetPairFrame.h"
+#include "ledger/BalanceFrame.h"
+#include "ledger/OfferFrame.h"
+#include "ledger/SaleFrame.h"
+#include <unordered_map>
+#include <vector>
+
+namespace stellar
+{
+class Application;
+class Database;
+class LedgerDelta;
+class LedgerManager;
+
+/**
+ * Closes one quote asset of a sale in bulk. The sale's offer is matched
+ * against the participations and whatever is left of the order book is
+ * cancelled, with the same results, entries and meta as applying a
+ * CreateOfferOpFrame for the sale and then deleting the book's offers one by
+ * one -- but the participations and their balances are loaded with one
+ * query each, matched in memory, and every entry is written once at the end,
+ * balances and offer deletions in one statement each.
+ */
+class SaleSettlement
+{
+    struct Write
+    {
+        enum Type
+        {
+            ADD,
+            CHANGE,
+            REMOVE
+        };
+
+        Type mType;
+        LedgerKey mKey;
+        // as of the write; none for REMOVE
+        EntryFrame::pointer mEntry;
+    };
+
+    Application& mApp;
+    LedgerManager& mLedgerManager;
+    LedgerDelta& mDelta;
+    Database& mDb;
+    SaleFrame::pointer mSale;
+    SaleQuoteAsset const& mQuoteAsset;
+    AccountFrame::pointer mSaleOwner;
+
+    AssetPairFrame::pointer mAssetPair;
+    BalanceFrame::pointer mBaseBalance;
+    BalanceFrame::pointer mQuoteBalance;
+    BalanceFrame::pointer mCommissionBalance;
+    bool mCommissionExists{false};
+    OfferFrame::pointer mSaleOffer;
+
+    std::vector<OfferFrame::pointer> mOffers;
+    std::unordered_map<BalanceID, BalanceFrame::pointer> mBalances;
+    std::vector<Write> mWrites;
+    // the entries loaded, as of before settling, to be recorded in the delta
+    std::vector<EntryFrame::pointer> mRecords;
+
+    bool prepareSaleOffer();
+    bool loadOrderBook();
+    void createCommissionBalance();
+    BalanceFrame::pointer getBalance(BalanceID const& balanceID);
+
+    void record(EntryFrame const& entry);
+    void add(EntryFrame const& entry);
+    void change(EntryFrame const& entry);
+    void remove(LedgerKey const& key);
+    void flush();
+
+  public:
+    SaleSettlement(Application& app, LedgerManager& lm, LedgerDelta& delta,
+                   SaleFrame::pointer sale, SaleQuoteAsset const& quoteAsset,
+                   AccountFrame::pointer saleOwner);
+
+    // Returns false if the order book holds anything settling in bulk
+    // doesn't account for (offers of the sale owner, offers below the asset
+    // pair's minimal price, amounts that overflow, ...). The caller should
+    // then close the sale offer by offer; by then nothing has been written
+    // to the delta or the database, nor has any ID been generated.
+    bool settle(ManageOfferSuccessResult& result);
+};
+}
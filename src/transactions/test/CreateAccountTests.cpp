@@ -10,6 +10,10 @@
 #include "ledger/ExternalSystemAccountID.h"
 #include "ledger/ExternalSystemAccountIDHelper.h"
 #include "test/test_marshaler.h"
+#include "transactions/OperationFrame.h"
+#include "medida/histogram.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 
 using namespace stellar;
 using namespace stellar::txtest;
@@ -60,6 +64,34 @@ TEST_CASE("create account", "[tx][create_account]") {
             REQUIRE(ethKey->getExternalSystemAccountID() == ethKeyAfterUpdate->getExternalSystemAccountID());
         }
     }
+    SECTION("Apply is profiled by operation type and result") {
+        auto& metrics = app.getMetrics();
+        auto& applyTimer = metrics.NewTimer({"operation", "CREATE_ACCOUNT", "apply"});
+        auto& successTimer = metrics.NewTimer({"operation", "CREATE_ACCOUNT", "SUCCESS"});
+        auto& queries = metrics.NewHistogram({"operation", "CREATE_ACCOUNT", "query"});
+        const auto applied = applyTimer.count();
+        const auto succeeded = successTimer.count();
+
+        createAccountHelper.applyTx(createAccountTestBuilder);
+        REQUIRE(applyTimer.count() == applied + 1);
+        REQUIRE(successTimer.count() == succeeded + 1);
+        REQUIRE(queries.max() > 0);
+
+        SECTION("Result is named from its XDR code") {
+            OperationResult result;
+            result.code(OperationResultCode::opINNER);
+            result.tr().type(OperationType::CREATE_ACCOUNT);
+            result.tr().createAccountResult().code(CreateAccountResultCode::MALFORMED);
+            REQUIRE(OperationFrame::getResultCodeAsStr(result) == "MALFORMED");
+
+            result.tr().type(OperationType::MANAGE_BALANCE);
+            result.tr().manageBalanceResult().code(ManageBalanceResultCode::ASSET_NOT_FOUND);
+            REQUIRE(OperationFrame::getResultCodeAsStr(result) == "ASSET_NOT_FOUND");
+
+            result.code(OperationResultCode::opNO_ACCOUNT);
+            REQUIRE(OperationFrame::getResultCodeAsStr(result) == "opNO_ACCOUNT");
+        }
+    }
     SECTION("Can't create system account") {
         auto systemCreateAccountBuilder =
                 createAccountTestBuilder.setOperationResultCode(OperationResultCode::opNOT_ALLOWED);
@@ -15,6 +15,7 @@
 #include "test_helper/ReviewIssuanceRequestHelper.h"
 #include "test_helper/ReviewPreIssuanceRequestHelper.h"
 #include "test/test_marshaler.h"
+#include "medida/meter.h"
 
 
 using namespace stellar;
@@ -117,6 +118,33 @@ void createIssuanceRequestHappyPath(TestManager::pointer testManager, Account& a
 		REQUIRE(assetFrame->getAvailableForIssuance() == preIssuedAmount);
 	}
 
+	SECTION("Prefetch requests")
+	{
+		// not auto reviewed, as not enough is pre issued
+		std::vector<uint64> requestIDs;
+		for (int i = 0; i < 3; i++)
+		{
+			auto issuanceRequestResult = issuanceRequestHelper.applyCreateIssuanceRequest(assetOwner, assetCode,
+				preIssuedAmount + 1, newAccountBalance->getBalanceID(), SecretKey::random().getStrKeyPublic());
+			REQUIRE(!issuanceRequestResult.success().fulfilled);
+			requestIDs.push_back(issuanceRequestResult.success().requestID);
+		}
+		const uint64 missingRequestID = UINT64_MAX;
+		requestIDs.push_back(missingRequestID);
+
+		auto& db = testManager->getDB();
+		reviewableRequestHelper->prefetch(requestIDs, db);
+		const auto queries = db.getQueryMeter().count();
+		for (size_t i = 0; i < requestIDs.size() - 1; i++)
+		{
+			auto request = reviewableRequestHelper->loadRequest(requestIDs[i], db);
+			REQUIRE(!!request);
+			REQUIRE(request->getRequestID() == requestIDs[i]);
+		}
+		REQUIRE(!reviewableRequestHelper->loadRequest(missingRequestID, db));
+		REQUIRE(db.getQueryMeter().count() == queries);
+	}
+
 }
 
 void createPreIssuanceRequestHardPath(TestManager::pointer testManager, Account &assetOwner, Account &root)
@@ -9,6 +9,7 @@
 #include "main/Config.h"
 #include "main/test.h"
 #include "TxTests.h"
+#include "ledger/AssetPairHelper.h"
 #include "ledger/LedgerDelta.h"
 #include "test/test_marshaler.h"
 
@@ -213,6 +214,40 @@ TEST_CASE("manage asset pair", "[tx][manage_asset_pair]")
                                                            ManageAssetPairAction
                                                            ::UPDATE_PRICE);
             }
+            SECTION("Rolled back change is not served")
+            {
+                assetPairTestHelper.applyManageAssetPairTx(root, quote, base,
+                                                           physicalPrice,
+                                                           physicalPriceCorrection,
+                                                           maxPriceStep,
+                                                           policies,
+                                                           ManageAssetPairAction
+                                                           ::CREATE);
+                auto& db = app.getDatabase();
+                auto assetPairHelper = AssetPairHelper::Instance();
+                auto assetPair = assetPairHelper->loadAssetPair(quote, base, db);
+                REQUIRE(assetPair);
+                {
+                    soci::transaction sqlTx(db.getSession());
+                    LedgerDelta delta(app.getLedgerManager()
+                                         .getCurrentLedgerHeader(), db);
+                    assetPair->setCurrentPrice(assetPair->getCurrentPrice() +
+                                               ONE);
+                    EntryHelperProvider::storeChangeEntry(delta, db,
+                                                          assetPair->mEntry);
+                    auto changed = assetPairHelper->loadAssetPair(quote, base,
+                                                                  db);
+                    REQUIRE(changed->getCurrentPrice() ==
+                            assetPair->getCurrentPrice());
+                    // neither is committed, so both are rolled back
+                }
+                auto stored = assetPairHelper->storeLoad(assetPair->getKey(),
+                                                         db);
+                auto loaded = assetPairHelper->loadAssetPair(quote, base, db);
+                REQUIRE(loaded->mEntry == stored->mEntry);
+                REQUIRE(loaded->getCurrentPrice() !=
+                        assetPair->getCurrentPrice());
+            }
         }
     }
 }
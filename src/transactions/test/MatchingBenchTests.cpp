@@ -0,0 +1,376 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "database/Database.h"
+#include "ledger/BalanceHelper.h"
+#include "ledger/LedgerDelta.h"
+#include "ledger/SaleHelper.h"
+#include "lib/util/format.h"
+#include "main/Application.h"
+#include "main/test.h"
+#include "test/test_marshaler.h"
+#include "transactions/dex/OfferManager.h"
+#include "util/Logging.h"
+#include "TxTests.h"
+#include "test_helper/CheckSaleStateTestHelper.h"
+#include "test_helper/CreateAccountTestHelper.h"
+#include "test_helper/IssuanceRequestHelper.h"
+#include "test_helper/ManageAssetPairTestHelper.h"
+#include "test_helper/ManageAssetTestHelper.h"
+#include "test_helper/ManageBalanceTestHelper.h"
+#include "test_helper/ManageOfferTestHelper.h"
+#include "test_helper/ParticipateInSaleTestHelper.h"
+#include "test_helper/SaleRequestHelper.h"
+
+#include "medida/meter.h"
+
+#include <chrono>
+
+// Matching-engine benchmark: seeds order books of a given shape -- on the
+// secondary market (order book 0) or as the participations of a sale -- and
+// reports how long ManageOffer, sale participation and CheckSaleState take to
+// apply and how many SQL statements they run per offer matched. Run it with
+//
+//     --test [dexbench]
+//
+
+namespace stellar
+{
+using namespace txtest;
+
+namespace
+{
+
+struct ApplyStats
+{
+    double mSeconds;
+    uint64_t mQueries;
+};
+
+// Applies `tx` as closing a ledger would, without the checks
+// TestManager::applyCheck runs against the whole database after every
+// transaction -- those would dominate seeding a book of any size.
+ApplyStats
+applyTx(TestManager& testManager, TransactionFramePtr tx)
+{
+    auto& app = testManager.getApp();
+    auto& db = testManager.getDB();
+    LedgerDelta delta(testManager.getLedgerManager().getCurrentLedgerHeader(),
+                      db);
+    tx->clearCached();
+    REQUIRE(tx->checkValid(app));
+    tx->processSeqNum();
+
+    auto queries = db.getQueryMeter().count();
+    auto start = std::chrono::steady_clock::now();
+    bool applied = tx->apply(delta, app);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    REQUIRE(applied);
+    delta.commit();
+    return {elapsed.count(), db.getQueryMeter().count() - queries};
+}
+
+Account
+createAccount(TestManager::pointer testManager, Account& root,
+              AccountType accountType)
+{
+    auto account = Account{SecretKey::random(), 0};
+    applyTx(*testManager, CreateAccountTestBuilder()
+                              .setSource(root)
+                              .setToPublicKey(account.key.getPublicKey())
+                              .setType(accountType)
+                              .setRecovery(SecretKey::random().getPublicKey())
+                              .buildTx(testManager));
+    return account;
+}
+
+BalanceID
+fundAccount(TestManager::pointer testManager, Account& root,
+            Account& account, AssetCode const& asset, uint64_t amount)
+{
+    auto balance = BalanceHelper::Instance()->loadBalance(
+        account.key.getPublicKey(), asset, testManager->getDB(), nullptr);
+    REQUIRE(balance);
+    IssuanceRequestHelper issuanceHelper(testManager);
+    auto request = issuanceHelper.createIssuanceRequest(
+        asset, amount, balance->getBalanceID());
+    applyTx(*testManager,
+            issuanceHelper.createIssuanceRequestTx(
+                root, request, SecretKey::random().getStrKeyPublic()));
+    return balance->getBalanceID();
+}
+
+// The ask side of a secondary market book: `mLevels` prices, `mPriceStep`
+// apart, each with `mOffersPerLevel` offers of one base unit, placed in turn
+// by `mOwners` accounts.
+struct BookShape
+{
+    int mLevels;
+    int mOffersPerLevel;
+    int64_t mPriceStep;
+    int mOwners;
+};
+
+struct MatchBenchResult
+{
+    double mPlaceSeconds;
+    double mPlaceQueries;
+    double mSweepSeconds;
+    uint64_t mSweepQueries;
+    size_t mSweepMatches;
+};
+
+MatchBenchResult
+runMatchBench(BookShape const& shape)
+{
+    Config const& cfg = getTestConfig(0, Config::TESTDB_POSTGRESQL);
+    VirtualClock clock;
+    Application::pointer app = Application::create(clock, cfg);
+    app->start();
+    auto testManager = TestManager::make(*app);
+
+    auto root = Account{getRoot(), 0};
+    AssetCode base = "BTC";
+    AssetCode quote = "USD";
+    ManageAssetTestHelper assetTestHelper(testManager);
+    assetTestHelper.createAsset(root, root.key, base, root,
+                                int32(AssetPolicy::BASE_ASSET));
+    assetTestHelper.createAsset(root, root.key, quote, root,
+                                int32(AssetPolicy::BASE_ASSET));
+    ManageAssetPairTestHelper(testManager)
+        .applyManageAssetPairTx(
+            root, base, quote, 1, 0, 0,
+            int32(AssetPairPolicy::TRADEABLE_SECONDARY_MARKET));
+
+    int64_t const amount = ONE;
+    int64_t const bestAsk = 100 * ONE;
+    int const numOffers = shape.mLevels * shape.mOffersPerLevel;
+    int const numPlaced = 20;
+    int64_t const worstAsk = bestAsk + (shape.mLevels - 1) * shape.mPriceStep;
+    uint64_t const baseNeeded =
+        amount * ((numOffers + shape.mOwners - 1) / shape.mOwners);
+    uint64_t const quoteNeeded =
+        (numOffers + numPlaced) *
+        bigDivide(amount, worstAsk, ONE, ROUND_UP);
+    IssuanceRequestHelper issuanceHelper(testManager);
+    issuanceHelper.authorizePreIssuedAmount(
+        root, root.key, base, baseNeeded * shape.mOwners, root);
+    issuanceHelper.authorizePreIssuedAmount(root, root.key, quote,
+                                            quoteNeeded, root);
+
+    struct Owner
+    {
+        Account mAccount;
+        BalanceID mBase;
+        BalanceID mQuote;
+    };
+    auto createOwner = [&](uint64_t baseAmount, uint64_t quoteAmount) {
+        auto account = createAccount(testManager, root, AccountType::GENERAL);
+        auto& db = testManager->getDB();
+        auto baseBalance = BalanceHelper::Instance()->loadBalance(
+            account.key.getPublicKey(), base, db, nullptr);
+        auto quoteBalance = BalanceHelper::Instance()->loadBalance(
+            account.key.getPublicKey(), quote, db, nullptr);
+        if (baseAmount != 0)
+        {
+            fundAccount(testManager, root, account, base, baseAmount);
+        }
+        if (quoteAmount != 0)
+        {
+            fundAccount(testManager, root, account, quote, quoteAmount);
+        }
+        return Owner{account, baseBalance->getBalanceID(),
+                     quoteBalance->getBalanceID()};
+    };
+
+    std::vector<Owner> owners;
+    for (int i = 0; i < shape.mOwners; i++)
+    {
+        owners.push_back(createOwner(baseNeeded, 0));
+    }
+
+    ManageOfferTestHelper offerTestHelper(testManager);
+    for (int level = 0; level < shape.mLevels; level++)
+    {
+        for (int i = 0; i < shape.mOffersPerLevel; i++)
+        {
+            auto& owner =
+                owners[(level * shape.mOffersPerLevel + i) % owners.size()];
+            applyTx(*testManager,
+                    offerTestHelper.creatManageOfferTx(
+                        owner.mAccount, 0, owner.mBase, owner.mQuote, amount,
+                        bestAsk + level * shape.mPriceStep, false, 0));
+        }
+    }
+
+    auto taker = createOwner(0, quoteNeeded);
+    MatchBenchResult res;
+
+    // bids resting below the book: the cost of an offer that matches nothing
+    res.mPlaceSeconds = 0;
+    res.mPlaceQueries = 0;
+    for (int i = 0; i < numPlaced; i++)
+    {
+        auto stats = applyTx(*testManager,
+                             offerTestHelper.creatManageOfferTx(
+                                 taker.mAccount, 0, taker.mBase, taker.mQuote,
+                                 amount, bestAsk / 2, true, 0));
+        res.mPlaceSeconds += stats.mSeconds / numPlaced;
+        res.mPlaceQueries += double(stats.mQueries) / numPlaced;
+    }
+
+    // one bid taking the whole ask side
+    auto sweep = offerTestHelper.creatManageOfferTx(
+        taker.mAccount, 0, taker.mBase, taker.mQuote, amount * numOffers,
+        worstAsk, true, 0);
+    auto stats = applyTx(*testManager, sweep);
+    res.mSweepSeconds = stats.mSeconds;
+    res.mSweepQueries = stats.mQueries;
+    res.mSweepMatches = sweep->getResult()
+                            .result.results()[0]
+                            .tr()
+                            .manageOfferResult()
+                            .success()
+                            .offersClaimed.size();
+    REQUIRE(res.mSweepMatches == static_cast<size_t>(numOffers));
+    return res;
+}
+
+struct SaleBenchResult
+{
+    double mParticipateSeconds;
+    double mParticipateQueries;
+    double mCloseSeconds;
+    uint64_t mCloseQueries;
+};
+
+SaleBenchResult
+runSaleBench(int numParticipants)
+{
+    Config const& cfg = getTestConfig(0, Config::TESTDB_POSTGRESQL);
+    VirtualClock clock;
+    Application::pointer app = Application::create(clock, cfg);
+    app->start();
+    auto testManager = TestManager::make(*app);
+
+    auto root = Account{getRoot(), 0};
+    AssetCode quoteAsset = "USD";
+    ManageAssetTestHelper assetTestHelper(testManager);
+    assetTestHelper.applyManageAssetTx(
+        root, 0,
+        assetTestHelper.createAssetCreationRequest(
+            quoteAsset, root.key.getPublicKey(), "{}", INT64_MAX,
+            uint32_t(AssetPolicy::BASE_ASSET)));
+
+    auto syndicate = createAccount(testManager, root, AccountType::SYNDICATE);
+    AssetCode const baseAsset = "XAAU";
+    uint64_t const preIssuedAmount = 2000 * ONE;
+    assetTestHelper.createApproveRequest(
+        root, syndicate,
+        assetTestHelper.createAssetCreationRequest(
+            baseAsset, syndicate.key.getPublicKey(), "{}", preIssuedAmount, 0,
+            preIssuedAmount));
+
+    uint64_t const price = 2 * ONE;
+    auto const hardCap = static_cast<uint64_t>(
+        bigDivide(preIssuedAmount, price, ONE, ROUND_DOWN));
+    uint64_t const softCap = hardCap / 2;
+    auto const currentTime = testManager->getLedgerManager().getCloseTime();
+    SaleRequestHelper saleRequestHelper(testManager);
+    auto saleRequest = saleRequestHelper.createSaleRequest(
+        baseAsset, quoteAsset, currentTime, currentTime + 1000, softCap,
+        hardCap, "{}",
+        {saleRequestHelper.createSaleQuoteAsset(quoteAsset, price)});
+    IssuanceRequestHelper(testManager)
+        .authorizePreIssuedAmount(root, root.key, quoteAsset,
+                                  hardCap + numParticipants, root);
+    saleRequestHelper.createApprovedSale(root, syndicate, saleRequest);
+    auto sales = SaleHelper::Instance()->loadSalesForOwner(
+        syndicate.key.getPublicKey(), testManager->getDB());
+    REQUIRE(sales.size() == 1);
+    auto const saleID = sales[0]->getID();
+
+    // every participant buys an equal share of the hard cap, the last one
+    // reaching it
+    uint64_t const quoteAmount = hardCap / numParticipants;
+    int64_t const baseAmount = bigDivide(quoteAmount, ONE, price, ROUND_UP);
+    SaleBenchResult res;
+    res.mParticipateSeconds = 0;
+    res.mParticipateQueries = 0;
+    for (int i = 0; i < numParticipants; i++)
+    {
+        auto account =
+            createAccount(testManager, root, AccountType::NOT_VERIFIED);
+        auto quoteBalance = fundAccount(testManager, root, account,
+                                        quoteAsset, quoteAmount + 1);
+        auto accountID = account.key.getPublicKey();
+        applyTx(*testManager,
+                ManageBalanceTestHelper(testManager)
+                    .createManageBalanceTx(account, accountID, baseAsset));
+        auto baseBalance = BalanceHelper::Instance()->loadBalance(
+            accountID, baseAsset, testManager->getDB(), nullptr);
+        REQUIRE(baseBalance);
+
+        auto op = OfferManager::buildManageOfferOp(
+            baseBalance->getBalanceID(), quoteBalance, true, baseAmount, price,
+            0, 0, saleID);
+        auto stats = applyTx(*testManager,
+                             ParticipateInSaleTestHelper(testManager)
+                                 .createManageOfferTx(account, op));
+        res.mParticipateSeconds += stats.mSeconds / numParticipants;
+        res.mParticipateQueries += double(stats.mQueries) / numParticipants;
+    }
+
+    auto close = CheckSaleStateHelper(testManager)
+                     .createCheckSaleStateTx(root, saleID);
+    auto stats = applyTx(*testManager, close);
+    res.mCloseSeconds = stats.mSeconds;
+    res.mCloseQueries = stats.mQueries;
+    REQUIRE(!SaleHelper::Instance()->loadSale(saleID, testManager->getDB()));
+    return res;
+}
+}
+
+TEST_CASE("offer matching", "[dexbench][bench][hide]")
+{
+    std::vector<BookShape> shapes = {{10, 1, ONE, 10},
+                                     {100, 1, ONE, 100},
+                                     {100, 10, ONE, 10},
+                                     {20, 50, ONE / 100, 1000},
+                                     {1000, 1, ONE / 100, 50}};
+
+    LOG(INFO) << fmt::format(
+        "{:>6s} {:>6s} {:>8s} {:>6s} {:>10s} {:>8s} {:>10s} {:>8s} {:>8s}",
+        "levels", "depth", "step", "owners", "place-ms", "place-q", "sweep-ms",
+        "matches", "q/match");
+    for (auto const& shape : shapes)
+    {
+        auto r = runMatchBench(shape);
+        LOG(INFO) << fmt::format(
+            "{:>6d} {:>6d} {:>8d} {:>6d} {:>10.3f} {:>8.1f} {:>10.3f} {:>8d} "
+            "{:>8.2f}",
+            shape.mLevels, shape.mOffersPerLevel, shape.mPriceStep,
+            shape.mOwners, 1000 * r.mPlaceSeconds, r.mPlaceQueries,
+            1000 * r.mSweepSeconds, r.mSweepMatches,
+            double(r.mSweepQueries) / r.mSweepMatches);
+    }
+}
+
+TEST_CASE("sale participation and close", "[dexbench][bench][hide]")
+{
+    LOG(INFO) << fmt::format("{:>8s} {:>14s} {:>10s} {:>10s} {:>8s} {:>8s}",
+                             "partic.", "participate-ms", "partic.-q",
+                             "close-ms", "close-q", "q/match");
+    for (int numParticipants : {10, 100, 1000})
+    {
+        auto r = runSaleBench(numParticipants);
+        LOG(INFO) << fmt::format(
+            "{:>8d} {:>14.3f} {:>10.1f} {:>10.3f} {:>8d} {:>8.2f}",
+            numParticipants, 1000 * r.mParticipateSeconds,
+            r.mParticipateQueries, 1000 * r.mCloseSeconds, r.mCloseQueries,
+            double(r.mCloseQueries) / numParticipants);
+    }
+}
+}
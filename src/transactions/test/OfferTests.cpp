@@ -9,14 +9,18 @@
 #include "main/test.h"
 #include "TxTests.h"
 #include "transactions/dex/OfferExchange.h"
+#include "transactions/dex/OfferManager.h"
 #include "ledger/LedgerDelta.h"
+#include "ledger/AssetPairHelper.h"
 #include "ledger/BalanceHelper.h"
 #include "ledger/OfferHelper.h"
+#include "ledger/OrderBookCache.h"
 #include "test_helper/ManageAssetTestHelper.h"
 #include "test_helper/IssuanceRequestHelper.h"
 #include "test_helper/ManageAssetPairTestHelper.h"
 #include "test_helper/ManageOfferTestHelper.h"
 #include "test/test_marshaler.h"
+#include "medida/meter.h"
 
 using namespace stellar;
 using namespace stellar::txtest;
@@ -573,6 +577,65 @@ TEST_CASE("manage offer", "[tx][offer]")
             return (rand() % INT16_MAX + 1);
         };
 
+        // the resident order book must agree with the offer table
+        auto checkOrderBook = [&base, &quote, &db]()
+        {
+            for (bool isBuy : {true, false})
+            {
+                const size_t maxOrders = 50;
+                std::vector<OfferFrame::pointer> stored;
+                OfferHelper::Instance()->loadBestOffers(maxOrders, 0, base,
+                    quote, 0, isBuy, stored, db);
+                std::vector<OfferFrame::pointer> resident;
+                db.getOrderBookCache().loadBestOffers(maxOrders, base, quote,
+                    0, isBuy, nullptr, resident, db);
+                REQUIRE(stored.size() == resident.size());
+                for (size_t i = 0; i < stored.size(); i++)
+                {
+                    REQUIRE(stored[i]->mEntry == resident[i]->mEntry);
+                }
+            }
+
+            // every price level sums up the offers stored at that price
+            uint64_t orderBookID = 0;
+            auto offers = OfferHelper::Instance()->loadOffersWithFilters(base,
+                quote, &orderBookID, nullptr, db);
+            for (bool isBuy : {true, false})
+            {
+                std::map<int64_t, OrderBookCache::DepthLevel> expected;
+                for (auto const& offer : offers)
+                {
+                    auto const& o = offer->getOffer();
+                    if (o.isBuy != isBuy)
+                    {
+                        continue;
+                    }
+                    auto& level = expected[o.price];
+                    level.price = o.price;
+                    level.baseAmount += o.baseAmount;
+                    level.quoteAmount += o.quoteAmount;
+                    level.numOffers++;
+                }
+                std::vector<OrderBookCache::DepthLevel> levels;
+                db.getOrderBookCache().loadDepth(expected.size() + 1, base,
+                    quote, 0, isBuy, levels, db);
+                REQUIRE(levels.size() == expected.size());
+                for (auto const& level : levels)
+                {
+                    auto const& e = expected[level.price];
+                    REQUIRE(level.baseAmount == e.baseAmount);
+                    REQUIRE(level.quoteAmount == e.quoteAmount);
+                    REQUIRE(level.numOffers == e.numOffers);
+                }
+                if (!levels.empty())
+                {
+                    REQUIRE(levels.front().price ==
+                            (isBuy ? expected.rbegin()->first
+                                   : expected.begin()->first));
+                }
+            }
+        };
+
         int64_t matchesLeft = 1000;
 
         // buyer and seller are placing ramdom orders untill one of them runs out of money
@@ -625,6 +688,7 @@ TEST_CASE("manage offer", "[tx][offer]")
                 sellerFee);
             matchesLeft -= offerResult.success().offersClaimed.size();
             LOG(INFO) << "matches left: " << matchesLeft;
+            checkOrderBook();
         }
 
         auto offersByAccount = offerHelper->loadAllOffers(app.getDatabase());
@@ -648,6 +712,7 @@ TEST_CASE("manage offer", "[tx][offer]")
 
         offersByAccount = offerHelper->loadAllOffers(app.getDatabase());
         REQUIRE(offersByAccount.size() == 0);
+        checkOrderBook();
 
         baseBuyerBalance = balanceHelper->loadBalance(buyer.key.getPublicKey(),
                                                       base, db, &delta);
@@ -679,3 +744,317 @@ TEST_CASE("manage offer", "[tx][offer]")
             quoteSellerBalance->getAmount() == quoteAssetAmount);
     }
 }
+
+TEST_CASE("offers sharing owners", "[tx][offer]")
+{
+    using xdr::operator==;
+
+    Config const& cfg = getTestConfig();
+    VirtualClock clock;
+    Application::pointer appPtr = Application::create(clock, cfg);
+    Application& app = *appPtr;
+    app.start();
+    auto testManager = TestManager::make(app);
+    auto& db = testManager->getDB();
+    auto& lm = testManager->getLedgerManager();
+
+    SecretKey root = getRoot();
+    auto rootAccount = Account{root, 0};
+    Salt rootSeq = 1;
+
+    AssetCode base = "BTC";
+    AssetCode quote = "USD";
+    auto assetTestHelper = ManageAssetTestHelper(testManager);
+    assetTestHelper.createAsset(rootAccount, rootAccount.key, base,
+                                rootAccount, int32(AssetPolicy::BASE_ASSET));
+    assetTestHelper.createAsset(rootAccount, rootAccount.key, quote,
+                                rootAccount, int32(AssetPolicy::BASE_ASSET));
+    ManageAssetPairTestHelper(testManager)
+        .applyManageAssetPairTx(
+            rootAccount, base, quote, ONE, 0, 0,
+            int32(AssetPairPolicy::TRADEABLE_SECONDARY_MARKET));
+
+    auto issuanceHelper = IssuanceRequestHelper(testManager);
+    auto balanceHelper = BalanceHelper::Instance();
+    auto offerHelper = OfferHelper::Instance();
+    auto offerTestHelper = ManageOfferTestHelper(testManager);
+
+    struct Owner
+    {
+        Account mAccount;
+        BalanceID mBase;
+        BalanceID mQuote;
+    };
+    auto createOwner = [&](uint64_t baseAmount, uint64_t quoteAmount) {
+        auto account = Account{SecretKey::random(), 0};
+        applyCreateAccountTx(app, root, account.key, rootSeq,
+                             AccountType::GENERAL);
+        auto accountID = account.key.getPublicKey();
+        Owner owner{
+            account,
+            balanceHelper->loadBalance(accountID, base, db, nullptr)
+                ->getBalanceID(),
+            balanceHelper->loadBalance(accountID, quote, db, nullptr)
+                ->getBalanceID()};
+        auto fund = [&](AssetCode const& asset, uint64_t amount,
+                        BalanceID const& receiver) {
+            if (amount == 0)
+            {
+                return;
+            }
+            issuanceHelper.authorizePreIssuedAmount(
+                rootAccount, rootAccount.key, asset, amount, rootAccount);
+            issuanceHelper.applyCreateIssuanceRequest(
+                rootAccount, asset, amount, receiver,
+                SecretKey::random().getStrKeyPublic());
+        };
+        fund(base, baseAmount, owner.mBase);
+        fund(quote, quoteAmount, owner.mQuote);
+        return owner;
+    };
+
+    // every owner bids for one base unit at 2 and at 3, and asks one at 10,
+    // 11 and 12
+    std::vector<Owner> owners;
+    for (int i = 0; i < 3; i++)
+    {
+        owners.push_back(createOwner(10 * ONE, 1000 * ONE));
+    }
+    for (auto& owner : owners)
+    {
+        for (int64_t price : {2, 3})
+        {
+            offerTestHelper.applyManageOffer(owner.mAccount, 0, owner.mBase,
+                                             owner.mQuote, ONE, price * ONE,
+                                             true, 0);
+        }
+        for (int64_t price : {10, 11, 12})
+        {
+            offerTestHelper.applyManageOffer(owner.mAccount, 0, owner.mBase,
+                                             owner.mQuote, ONE, price * ONE,
+                                             false, 0);
+        }
+    }
+
+    // the owners' balances as stored, in a fixed order
+    typedef std::map<std::string, BalanceEntry> Balances;
+    auto storedBalances = [&]() {
+        std::vector<BalanceFrame::pointer> balances;
+        for (auto& owner : owners)
+        {
+            balanceHelper->loadBalances(owner.mAccount.key.getPublicKey(),
+                                        balances, db);
+        }
+        Balances byID;
+        for (auto const& balance : balances)
+        {
+            byID[BalanceKeyUtils::toStrKey(balance->getBalanceID())] =
+                balance->getBalance();
+        }
+        return byID;
+    };
+    auto requireSameBalances = [](Balances const& a, Balances const& b) {
+        REQUIRE(a.size() == b.size());
+        for (auto const& kv : a)
+        {
+            REQUIRE(b.count(kv.first) == 1);
+            REQUIRE(b.at(kv.first) == kv.second);
+        }
+    };
+    // each balance the changes leave updated is stored as they leave it
+    auto requireChangesStored = [&](LedgerEntryChanges const& changes) {
+        auto stored = storedBalances();
+        size_t updated = 0;
+        for (auto const& change : changes)
+        {
+            if (change.type() != LedgerEntryChangeType::UPDATED ||
+                change.updated().data.type() != LedgerEntryType::BALANCE)
+            {
+                continue;
+            }
+            auto const& balance = change.updated().data.balance();
+            auto it = stored.find(BalanceKeyUtils::toStrKey(balance.balanceID));
+            if (it != stored.end())
+            {
+                REQUIRE(it->second == balance);
+                ++updated;
+            }
+        }
+        return updated;
+    };
+
+    uint64_t orderBookID = ManageOfferOpFrame::SECONDARY_MARKET_ORDER_BOOK_ID;
+    auto offers = offerHelper->loadOffersWithFilters(base, quote, &orderBookID,
+                                                     nullptr, db);
+    REQUIRE(offers.size() == 5 * owners.size());
+
+    SECTION("cancelling in bulk changes what cancelling one by one does")
+    {
+        // cancels the whole book, then rolls it back
+        auto cancel = [&](bool bulk) {
+            soci::transaction sqlTx(db.getSession());
+            LedgerDelta delta(lm.getCurrentLedgerHeader(), db);
+            if (bulk)
+            {
+                OfferManager::deleteOffers(offers, db, delta);
+            }
+            else
+            {
+                for (auto& offer : offers)
+                {
+                    delta.recordEntry(*offer);
+                    OfferManager::deleteOffer(offer, db, delta);
+                }
+            }
+            REQUIRE(offerHelper
+                        ->loadOffersWithFilters(base, quote, &orderBookID,
+                                                nullptr, db)
+                        .empty());
+            auto res = std::make_pair(delta.getChanges(), storedBalances());
+            REQUIRE(requireChangesStored(res.first) == 2 * owners.size());
+            delta.rollback();
+            return res;
+        };
+
+        auto before = storedBalances();
+        auto oneByOne = cancel(false);
+        requireSameBalances(storedBalances(), before);
+        auto bulk = cancel(true);
+        requireSameBalances(storedBalances(), before);
+
+        REQUIRE(oneByOne.first == bulk.first);
+        requireSameBalances(oneByOne.second, bulk.second);
+        for (auto const& kv : bulk.second)
+        {
+            REQUIRE(kv.second.locked == 0);
+        }
+    }
+
+    SECTION("sweeping the asks stores each owner's balances as in the meta")
+    {
+        auto taker = createOwner(0, 200 * ONE);
+        auto tx = offerTestHelper.creatManageOfferTx(
+            taker.mAccount, 0, taker.mBase, taker.mQuote,
+            3 * owners.size() * ONE, 12 * ONE, true, 0);
+        LedgerDelta delta(lm.getCurrentLedgerHeader(), db);
+        tx->clearCached();
+        REQUIRE(tx->checkValid(app));
+        tx->processSeqNum();
+        REQUIRE(tx->apply(delta, app));
+        REQUIRE(tx->getResult()
+                    .result.results()[0]
+                    .tr()
+                    .manageOfferResult()
+                    .success()
+                    .offersClaimed.size() == 3 * owners.size());
+
+        // both balances of every owner, each once
+        REQUIRE(requireChangesStored(delta.getChanges()) ==
+                2 * owners.size());
+        for (auto& owner : owners)
+        {
+            auto baseBalance = loadBalance(owner.mBase, app);
+            REQUIRE(baseBalance->getAmount() == 7 * ONE);
+            REQUIRE(baseBalance->getLocked() == 0);
+            auto quoteBalance = loadBalance(owner.mQuote, app);
+            REQUIRE(quoteBalance->getAmount() == (995 + 33) * ONE);
+            REQUIRE(quoteBalance->getLocked() == 5 * ONE);
+        }
+        delta.commit();
+    }
+
+    SECTION("offers below the pair's minimal price are taken as they were")
+    {
+        // the bids are all below the minimal price, as if the physical price
+        // had just gone up
+        auto assetPair = AssetPairHelper::Instance()->loadAssetPair(base, quote,
+                                                                    db);
+        auto& assetPairEntry = assetPair->mEntry.data.assetPair();
+        assetPairEntry.policies |=
+            int32(AssetPairPolicy::PHYSICAL_PRICE_RESTRICTION);
+        assetPairEntry.physicalPrice = 100 * ONE;
+        assetPairEntry.physicalPriceCorrection = 100 * ONE;
+
+        auto seller = createOwner(10 * ONE, 0);
+        auto sellerID = seller.mAccount.key.getPublicKey();
+        auto sellOffer = OfferManager::buildOffer(
+            sellerID,
+            OfferManager::buildManageOfferOp(seller.mBase, seller.mQuote,
+                                             false, 2 * ONE, ONE, 0, 0,
+                                             orderBookID),
+            base, quote);
+
+        auto before = storedBalances();
+        LedgerDelta delta(lm.getCurrentLedgerHeader(), db);
+        AccountManager accountManager(app, db, delta, lm);
+        auto commissionBalance =
+            AccountManager::loadOrCreateBalanceFrameForAsset(
+                app.getCommissionID(), quote, db, delta);
+        OfferExchange oe(accountManager, delta, lm, assetPair,
+                         commissionBalance, orderBookID);
+        oe.convertWithOffers(
+            sellOffer->getOffer(), balanceHelper->loadBalance(seller.mBase, db),
+            balanceHelper->loadBalance(seller.mQuote, db),
+            [](OfferFrame const&) { return OfferExchange::eKeep; });
+        REQUIRE(oe.getOfferTrail().empty());
+
+        // the bids are gone, but their quote stays locked: only the base
+        // balances, which lock nothing for a bid, are stored
+        for (auto const& offer : offerHelper->loadOffersWithFilters(
+                 base, quote, &orderBookID, nullptr, db))
+        {
+            REQUIRE(!offer->getOffer().isBuy);
+        }
+        requireSameBalances(storedBalances(), before);
+        REQUIRE(requireChangesStored(delta.getChanges()) == owners.size());
+        for (auto const& change : delta.getChanges())
+        {
+            if (change.type() == LedgerEntryChangeType::UPDATED &&
+                change.updated().data.type() == LedgerEntryType::BALANCE)
+            {
+                for (auto& owner : owners)
+                {
+                    REQUIRE(!(change.updated().data.balance().balanceID ==
+                              owner.mQuote));
+                }
+            }
+        }
+        delta.commit();
+    }
+}
+
+TEST_CASE("resident order books are bounded", "[tx][offer]")
+{
+    Config const& cfg = getTestConfig();
+    VirtualClock clock;
+    Application::pointer appPtr = Application::create(clock, cfg);
+    Application& app = *appPtr;
+    app.start();
+    auto& db = app.getDatabase();
+
+    OrderBookCache orderBooks(2);
+    AssetCode quote = "USD";
+    auto load = [&](AssetCode const& base) {
+        // how many queries loading the book took
+        auto queries = db.getQueryMeter().count();
+        std::vector<OrderBookCache::DepthLevel> levels;
+        orderBooks.loadDepth(1, base, quote, 0, true, levels, db);
+        return db.getQueryMeter().count() - queries;
+    };
+
+    REQUIRE(load("AAA") != 0);
+    REQUIRE(load("BBB") != 0);
+    REQUIRE(load("AAA") == 0);
+    REQUIRE(orderBooks.numLoadedBooks() == 2);
+
+    // the book asked for least recently makes way
+    REQUIRE(load("CCC") != 0);
+    REQUIRE(orderBooks.numLoadedBooks() == 2);
+    REQUIRE(load("AAA") == 0);
+    REQUIRE(load("BBB") != 0);
+    REQUIRE(orderBooks.numLoadedBooks() == 2);
+
+    orderBooks.clear();
+    REQUIRE(orderBooks.numLoadedBooks() == 0);
+    REQUIRE(load("CCC") != 0);
+}
@@ -15,6 +15,8 @@
 #include "crypto/SHA.h"
 #include "test/test_marshaler.h"
 #include "ledger/AssetHelper.h"
+#include "ledger/ReferenceHelper.h"
+#include "medida/meter.h"
 
 using namespace stellar;
 using namespace stellar::txtest;
@@ -84,6 +86,25 @@ TEST_CASE("payment", "[dep_tx][payment]")
         soci::session& sess = app.getDatabase().getSession();
         REQUIRE(paymentRequestHelper->countObjects(sess) == 0);
 	}
+    SECTION("Reference duplication")
+    {
+        auto account = SecretKey::random();
+        applyCreateAccountTx(app, root, account, rootSeq++, AccountType::GENERAL);
+        std::string reference = "payment-reference";
+        applyPaymentTx(app, aWM, account, rootSeq++, paymentAmount, getNoPaymentFee(), false, "", reference);
+        applyPaymentTx(app, aWM, account, rootSeq++, paymentAmount, getNoPaymentFee(), false, "", reference,
+                       PaymentResultCode::REFERENCE_DUPLICATION);
+
+        // answered by the reference index alone
+        auto& db = app.getDatabase();
+        auto referenceHelper = ReferenceHelper::Instance();
+        const auto queries = db.getQueryMeter().count();
+        REQUIRE(referenceHelper->exists(db, reference, aWM.getPublicKey()));
+        REQUIRE(!referenceHelper->exists(db, reference + "-2", aWM.getPublicKey()));
+        REQUIRE(!referenceHelper->exists(db, reference, account.getPublicKey()));
+        REQUIRE(db.getQueryMeter().count() == queries);
+        REQUIRE(referenceHelper->queryExists(db, reference, aWM.getPublicKey()));
+    }
     SECTION("send to self")
     {
         auto balanceBefore = getAccountBalance(aWM, app);
@@ -21,12 +21,16 @@
 #include "test_helper/ParticipateInSaleTestHelper.h"
 #include "transactions/dex/OfferManager.h"
 #include "ledger/SaleHelper.h"
+#include "transactions/CheckSaleStateOpFrame.h"
 #include "test_helper/CheckSaleStateTestHelper.h"
 #include "test_helper/ReviewAssetRequestHelper.h"
 #include "test_helper/ReviewSaleRequestHelper.h"
 #include "test/test_marshaler.h"
 #include "ledger/OfferHelper.h"
 #include "test_helper/ManageAssetPairTestHelper.h"
+#include "transactions/dex/SaleSettlement.h"
+#include "transactions/AccountManager.h"
+#include "ledger/AccountHelper.h"
 
 using namespace stellar;
 using namespace stellar::txtest;
@@ -195,6 +199,12 @@ TEST_CASE("Sale", "[tx][sale]")
         auto sales = SaleHelper::Instance()->loadSalesForOwner(syndicate.key.getPublicKey(), testManager->getDB());
         REQUIRE(sales.size() == 1);
         const auto saleID = sales[0]->getID();
+        auto loadDueSales = [&db](uint64_t closeTime)
+        {
+            std::vector<SaleSchedule::DueSale> dueSales;
+            CheckSaleStateOpFrame::loadDueSales(closeTime, db, dueSales);
+            return dueSales;
+        };
         SECTION("Try to cancel sale offer as regular one")
         {
             auto account = Account{ SecretKey::random(), 0 };
@@ -224,11 +234,17 @@ TEST_CASE("Sale", "[tx][sale]")
                 addNewParticipant(testManager, root, saleID, baseAsset, quoteAsset, quoteAssetAmount, price, feeToPay);
                 if (i < numberOfParticipants - 1)
                 {
+                    REQUIRE(loadDueSales(currentTime).empty());
                     CheckSaleStateHelper(testManager).applyCheckSaleStateTx(root, saleID, CheckSaleStateResultCode::NOT_READY);
                 }
             }
 
+            auto dueSales = loadDueSales(currentTime);
+            REQUIRE(dueSales.size() == 1);
+            REQUIRE(dueSales[0].saleID == saleID);
+            REQUIRE(dueSales[0].hardCapReached);
             CheckSaleStateHelper(testManager).applyCheckSaleStateTx(root, saleID);
+            REQUIRE(loadDueSales(currentTime).empty());
         }
 
         SECTION("Reached soft cap")
@@ -264,6 +280,11 @@ TEST_CASE("Sale", "[tx][sale]")
             }
             // softcap is not reached, so no sale to close
             CheckSaleStateHelper(testManager).applyCheckSaleStateTx(root, saleID, CheckSaleStateResultCode::NOT_READY);
+            REQUIRE(loadDueSales(endTime - 1).empty());
+            auto dueSales = loadDueSales(endTime);
+            REQUIRE(dueSales.size() == 1);
+            REQUIRE(dueSales[0].saleID == saleID);
+            REQUIRE(!dueSales[0].hardCapReached);
             // close ledger after end time
             testManager->advanceToTime(endTime + 1);
             auto checkRes = checkStateHelper.applyCheckSaleStateTx(root, saleID, CheckSaleStateResultCode::SUCCESS);
@@ -679,3 +700,264 @@ TEST_CASE("Sale", "[tx][sale]")
         }
     }
 }
+
+TEST_CASE("Sale settlement", "[tx][sale][sale_settlement]")
+{
+    using xdr::operator==;
+
+    Config const& cfg = getTestConfig();
+    VirtualClock clock;
+    Application::pointer appPtr = Application::create(clock, cfg);
+    Application& app = *appPtr;
+    app.start();
+    auto testManager = TestManager::make(app);
+
+    Database& db = testManager->getDB();
+    auto& lm = testManager->getLedgerManager();
+
+    auto root = Account{ getRoot(), Salt(0) };
+
+    AssetCode quoteAsset = "USD";
+    auto assetTestHelper = ManageAssetTestHelper(testManager);
+    auto assetCreationRequest = assetTestHelper.createAssetCreationRequest(quoteAsset, root.key.getPublicKey(), "{}", INT64_MAX,
+                                                                           uint32_t(AssetPolicy::BASE_ASSET));
+    assetTestHelper.applyManageAssetTx(root, 0, assetCreationRequest);
+
+    SaleRequestHelper saleRequestHelper(testManager);
+    CheckSaleStateHelper checkStateHelper(testManager);
+
+    auto syndicate = Account{ SecretKey::random(), 0 };
+    auto syndicatePubKey = syndicate.key.getPublicKey();
+    CreateAccountTestHelper(testManager).applyCreateAccountTx(root, syndicatePubKey, AccountType::SYNDICATE);
+    const AssetCode baseAsset = "BTC";
+    const uint64_t maxIssuanceAmount = 2000 * ONE;
+    assetCreationRequest = assetTestHelper.createAssetCreationRequest(baseAsset, syndicatePubKey, "{}",
+                                                                      maxIssuanceAmount, 0, maxIssuanceAmount);
+    assetTestHelper.createApproveRequest(root, syndicate, assetCreationRequest);
+    const uint64_t price = 2 * ONE;
+    const auto hardCap = static_cast<const uint64_t>(bigDivide(maxIssuanceAmount, price, ONE, ROUND_DOWN));
+
+    // the owner and the participants pay offer fees, so that commission is
+    // collected as well
+    auto sellerFeeFrame = FeeFrame::create(FeeType::OFFER_FEE, 0, int64_t(2 * ONE), quoteAsset, &syndicatePubKey);
+    auto participantsFeeFrame = FeeFrame::create(FeeType::OFFER_FEE, 0, int64_t(1 * ONE), quoteAsset, nullptr);
+    {
+        LedgerDelta delta(lm.getCurrentLedgerHeader(), db);
+        EntryHelperProvider::storeAddEntry(delta, db, sellerFeeFrame->mEntry);
+        EntryHelperProvider::storeAddEntry(delta, db, participantsFeeFrame->mEntry);
+        delta.commit();
+    }
+    uint64_t quotePreIssued(0);
+    participantsFeeFrame->calculatePercentFee(hardCap, quotePreIssued, ROUND_UP);
+    quotePreIssued += hardCap + 10 * ONE;
+    IssuanceRequestHelper(testManager).authorizePreIssuedAmount(root, root.key, quoteAsset, quotePreIssued, root);
+
+    const auto currentTime = lm.getCloseTime();
+    auto saleRequest = saleRequestHelper.createSaleRequest(baseAsset, quoteAsset, currentTime, currentTime + 1000, hardCap / 2,
+                                                           hardCap, "{}", { saleRequestHelper.createSaleQuoteAsset(quoteAsset, price) });
+    saleRequestHelper.createApprovedSale(root, syndicate, saleRequest);
+    auto sales = SaleHelper::Instance()->loadSalesForOwner(syndicatePubKey, db);
+    REQUIRE(sales.size() == 1);
+    uint64_t saleID = sales[0]->getID();
+
+    // three participants, one of them taking part twice
+    std::vector<AccountID> accounts = { syndicatePubKey, app.getCommissionID() };
+    std::vector<Account> participants;
+    for (int i = 0; i < 3; i++)
+    {
+        participants.push_back(Account{ SecretKey::random(), 0 });
+        CreateAccountTestHelper(testManager).applyCreateAccountTx(root, participants.back().key.getPublicKey(),
+                                                                  AccountType::NOT_VERIFIED);
+        accounts.push_back(participants.back().key.getPublicKey());
+    }
+    auto participate = [&](Account& participant, uint64_t quoteAmount)
+    {
+        uint64_t feeToPay(0);
+        participantsFeeFrame->calculatePercentFee(quoteAmount, feeToPay, ROUND_UP);
+        addNewParticipant(testManager, root, participant, saleID, baseAsset, quoteAsset, quoteAmount, price, feeToPay);
+    };
+    participate(participants[0], hardCap / 10);
+    participate(participants[1], hardCap / 5);
+    participate(participants[2], hardCap / 4);
+    participate(participants[0], hardCap / 8);
+
+    // the base asset CheckSaleState issues to the owner before closing the
+    // sale in each quote asset
+    {
+        LedgerDelta delta(lm.getCurrentLedgerHeader(), db);
+        auto sale = SaleHelper::Instance()->loadSale(saleID, db);
+        auto baseBalance = BalanceHelper::Instance()->mustLoadBalance(sale->getBaseBalanceID(), db, &delta);
+        REQUIRE(baseBalance->tryFundAccount(sale->getBaseAmountForCurrentCap()));
+        EntryHelperProvider::storeChangeEntry(delta, db, baseBalance->mEntry);
+        delta.commit();
+    }
+
+    // the balances of everyone involved as stored
+    typedef std::map<std::string, BalanceEntry> Balances;
+    auto storedBalances = [&]()
+    {
+        std::vector<BalanceFrame::pointer> balances;
+        for (auto const& accountID : accounts)
+        {
+            BalanceHelper::Instance()->loadBalances(accountID, balances, db);
+        }
+        Balances byID;
+        for (auto const& balance : balances)
+        {
+            byID[BalanceKeyUtils::toStrKey(balance->getBalanceID())] = balance->getBalance();
+        }
+        return byID;
+    };
+    auto requireSameBalances = [](Balances const& a, Balances const& b)
+    {
+        REQUIRE(a.size() == b.size());
+        for (auto const& kv : a)
+        {
+            REQUIRE(b.count(kv.first) == 1);
+            REQUIRE(b.at(kv.first) == kv.second);
+        }
+    };
+    auto countOffers = [&]()
+    {
+        return OfferHelper::Instance()->countObjects(db.getSession());
+    };
+
+    SECTION("settling in bulk closes the sale as closing it offer by offer does")
+    {
+        struct Closed
+        {
+            ManageOfferSuccessResult mResult;
+            LedgerEntryChanges mChanges;
+            LedgerHeader mHeader;
+            Balances mBalances;
+            uint64_t mOffers;
+        };
+        // closes the sale in its quote asset, then rolls that back
+        auto close = [&](bool inBulk)
+        {
+            soci::transaction sqlTx(db.getSession());
+            LedgerDelta delta(lm.getCurrentLedgerHeader(), db);
+            auto sale = SaleHelper::Instance()->loadSale(saleID, db);
+            auto const& saleQuoteAsset = sale->getSaleEntry().quoteAssets[0];
+            auto saleOwner = AccountHelper::Instance()->mustLoadAccount(syndicatePubKey, db);
+            Closed closed;
+            if (inBulk)
+            {
+                SaleSettlement settlement(app, lm, delta, sale, saleQuoteAsset, saleOwner);
+                REQUIRE(settlement.settle(closed.mResult));
+            }
+            else
+            {
+                auto tx = checkStateHelper.createCheckSaleStateTx(root, saleID);
+                OperationResult opRes;
+                CheckSaleStateOpFrame opFrame(tx->getEnvelope().tx.operations[0], opRes, *tx);
+                closed.mResult = opFrame.closeOfferByOffer(saleOwner, sale, saleQuoteAsset, app, lm, delta);
+            }
+            REQUIRE(OfferHelper::Instance()->loadOffersWithFilters(baseAsset, quoteAsset, &saleID, nullptr, db).empty());
+            closed.mChanges = delta.getChanges();
+            closed.mHeader = delta.getHeader();
+            closed.mBalances = storedBalances();
+            closed.mOffers = countOffers();
+            delta.rollback();
+            return closed;
+        };
+
+        auto before = storedBalances();
+        auto offersBefore = countOffers();
+        auto offerByOffer = close(false);
+        requireSameBalances(storedBalances(), before);
+        REQUIRE(countOffers() == offersBefore);
+        auto bulk = close(true);
+        requireSameBalances(storedBalances(), before);
+
+        REQUIRE(bulk.mResult.offersClaimed.size() == 4);
+        REQUIRE(bulk.mResult == offerByOffer.mResult);
+        REQUIRE(bulk.mChanges == offerByOffer.mChanges);
+        REQUIRE(bulk.mHeader == offerByOffer.mHeader);
+        requireSameBalances(bulk.mBalances, offerByOffer.mBalances);
+        REQUIRE(bulk.mOffers == offerByOffer.mOffers);
+    }
+
+    SECTION("what settling in bulk doesn't account for is left untouched")
+    {
+        // adds an offer to the book that no operation would have; it's
+        // matched before all the participations
+        auto addOffer = [&](std::function<void(OfferEntry&)> const& tweak)
+        {
+            auto offers = OfferHelper::Instance()->loadOffersWithFilters(baseAsset, quoteAsset, &saleID, nullptr, db);
+            REQUIRE(!offers.empty());
+            LedgerDelta delta(lm.getCurrentLedgerHeader(), db);
+            auto offer = std::make_shared<OfferFrame>(offers[0]->mEntry);
+            auto& entry = offer->getOffer();
+            entry.offerID = delta.getHeaderFrame().generateID(LedgerEntryType::OFFER_ENTRY);
+            entry.price += 1;
+            tweak(entry);
+            EntryHelperProvider::storeAddEntry(delta, db, offer->mEntry);
+            delta.commit();
+        };
+        auto sale = SaleHelper::Instance()->loadSale(saleID, db);
+
+        SECTION("an offer of the sale's owner")
+        {
+            addOffer([&](OfferEntry& offer) { offer.ownerID = syndicatePubKey; });
+        }
+        SECTION("an offer on the sale's base balance")
+        {
+            addOffer([&](OfferEntry& offer) { offer.baseBalance = sale->getBaseBalanceID(); });
+        }
+        SECTION("an offer on the sale's quote balance")
+        {
+            addOffer([&](OfferEntry& offer) { offer.quoteBalance = sale->getSaleEntry().quoteAssets[0].quoteBalance; });
+        }
+        SECTION("an offer on the commission balance")
+        {
+            BalanceID commissionBalanceID;
+            {
+                LedgerDelta delta(lm.getCurrentLedgerHeader(), db);
+                commissionBalanceID = AccountManager::loadOrCreateBalanceFrameForAsset(app.getCommissionID(), quoteAsset,
+                                                                                       db, delta)->getBalanceID();
+                delta.commit();
+            }
+            addOffer([&](OfferEntry& offer) { offer.quoteBalance = commissionBalanceID; });
+        }
+        SECTION("offers below the asset pair's minimal price")
+        {
+            LedgerDelta delta(lm.getCurrentLedgerHeader(), db);
+            auto assetPair = AssetPairHelper::Instance()->loadAssetPair(baseAsset, quoteAsset, db, &delta);
+            REQUIRE(!!assetPair);
+            auto& assetPairEntry = assetPair->mEntry.data.assetPair();
+            assetPairEntry.policies |= int32(AssetPairPolicy::PHYSICAL_PRICE_RESTRICTION);
+            assetPairEntry.physicalPrice = 100 * ONE;
+            assetPairEntry.physicalPriceCorrection = 100 * ONE;
+            EntryHelperProvider::storeChangeEntry(delta, db, assetPair->mEntry);
+            delta.commit();
+        }
+        SECTION("an offer that can't be converted")
+        {
+            // the quote amount its fee covers overflows
+            addOffer([](OfferEntry& offer)
+            {
+                offer.percentFee = 1;
+                offer.fee = INT64_MAX / 2;
+            });
+        }
+
+        auto before = storedBalances();
+        auto offersBefore = countOffers();
+        sale = SaleHelper::Instance()->loadSale(saleID, db);
+        auto saleOwner = AccountHelper::Instance()->mustLoadAccount(syndicatePubKey, db);
+        LedgerDelta delta(lm.getCurrentLedgerHeader(), db);
+        SaleSettlement settlement(app, lm, delta, sale, sale->getSaleEntry().quoteAssets[0], saleOwner);
+        ManageOfferSuccessResult result;
+        REQUIRE(!settlement.settle(result));
+
+        // nothing written, recorded or generated for closing offer by offer
+        // to run into
+        REQUIRE(result.offersClaimed.empty());
+        REQUIRE(delta.getChanges().empty());
+        REQUIRE(delta.getState().empty());
+        REQUIRE(delta.getHeader() == lm.getCurrentLedgerHeader());
+        requireSameBalances(storedBalances(), before);
+        REQUIRE(countOffers() == offersBefore);
+    }
+}
@@ -0,0 +1,84 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/BloomFilter.h"
+#include <algorithm>
+
+namespace stellar
+{
+
+uint32_t const BloomFilter::kBitsPerKey;
+uint32_t const BloomFilter::kHashes;
+
+BloomFilter::BloomFilter(size_t nKeys)
+{
+    uint64_t nBits = std::max<uint64_t>(64, nKeys * kBitsPerKey);
+    mBits.assign(static_cast<size_t>((nBits + 7) / 8), 0);
+}
+
+BloomFilter::BloomFilter(std::vector<uint8_t> bits) : mBits(std::move(bits))
+{
+}
+
+uint64_t
+BloomFilter::hash(uint8_t const* data, size_t size)
+{
+    // 64-bit FNV-1a
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i)
+    {
+        h ^= data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+uint64_t
+BloomFilter::hash(std::string const& key)
+{
+    return hash(reinterpret_cast<uint8_t const*>(key.data()), key.size());
+}
+
+void
+BloomFilter::add(uint64_t keyHash)
+{
+    uint64_t nBits = mBits.size() * 8;
+    if (nBits == 0)
+    {
+        return;
+    }
+    uint64_t h2 = (keyHash >> 32) | 1;
+    for (uint32_t i = 0; i < kHashes; ++i)
+    {
+        uint64_t bit = (keyHash + i * h2) % nBits;
+        mBits[bit / 8] |= static_cast<uint8_t>(1 << (bit % 8));
+    }
+}
+
+bool
+BloomFilter::mayContain(uint64_t keyHash) const
+{
+    uint64_t nBits = mBits.size() * 8;
+    if (nBits == 0)
+    {
+        return false;
+    }
+    uint64_t h2 = (keyHash >> 32) | 1;
+    for (uint32_t i = 0; i < kHashes; ++i)
+    {
+        uint64_t bit = (keyHash + i * h2) % nBits;
+        if ((mBits[bit / 8] & (1 << (bit % 8))) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+BloomFilter::clear()
+{
+    mBits.clear();
+}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace stellar
+{
+
+/**
+ * A bloom filter over 64-bit key hashes, sized at kBitsPerKey bits per key,
+ * each key setting kHashes bits by double hashing. Keys are hashed with
+ * 64-bit FNV-1a, which is stable across runs and platforms, so the filter's
+ * bits can be persisted as they are.
+ */
+class BloomFilter
+{
+    std::vector<uint8_t> mBits;
+
+  public:
+    static uint32_t const kBitsPerKey = 10;
+    static uint32_t const kHashes = 7;
+
+    // An empty filter, which contains nothing and can't be added to.
+    BloomFilter() = default;
+
+    // A filter sized for `nKeys` keys, and at least 64 bits.
+    explicit BloomFilter(size_t nKeys);
+
+    // A filter with the bits of another, as returned by getBits().
+    explicit BloomFilter(std::vector<uint8_t> bits);
+
+    static uint64_t hash(uint8_t const* data, size_t size);
+    static uint64_t hash(std::string const& key);
+
+    void add(uint64_t keyHash);
+
+    // Whether a key of hash `keyHash` may have been added; false if it
+    // definitely wasn't.
+    bool mayContain(uint64_t keyHash) const;
+
+    std::vector<uint8_t> const&
+    getBits() const
+    {
+        return mBits;
+    }
+
+    bool
+    empty() const
+    {
+        return mBits.empty();
+    }
+
+    void clear();
+};
+}
@@ -0,0 +1,63 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "main/test.h"
+#include "util/BloomFilter.h"
+#include <string>
+
+using namespace stellar;
+
+TEST_CASE("bloom filter hash is 64-bit FNV-1a", "[bloom]")
+{
+    // bucket indexes persist filters built with it
+    REQUIRE(BloomFilter::hash("") == 0xcbf29ce484222325ULL);
+    REQUIRE(BloomFilter::hash("a") == 0xaf63dc4c8601ec8cULL);
+    REQUIRE(BloomFilter::hash("foobar") == 0x85944171f73967e8ULL);
+}
+
+TEST_CASE("bloom filter", "[bloom]")
+{
+    size_t const nKeys = 1000;
+    BloomFilter bloom(nKeys);
+    REQUIRE(bloom.getBits().size() == nKeys * BloomFilter::kBitsPerKey / 8);
+    for (size_t i = 0; i < nKeys; ++i)
+    {
+        bloom.add(BloomFilter::hash("key" + std::to_string(i)));
+    }
+
+    for (size_t i = 0; i < nKeys; ++i)
+    {
+        REQUIRE(bloom.mayContain(BloomFilter::hash("key" + std::to_string(i))));
+    }
+
+    // at 10 bits per key and 7 hashes, about 1% of other keys get through
+    size_t positives = 0;
+    for (size_t i = 0; i < nKeys; ++i)
+    {
+        if (bloom.mayContain(BloomFilter::hash("other" + std::to_string(i))))
+        {
+            ++positives;
+        }
+    }
+    REQUIRE(positives < nKeys / 20);
+
+    SECTION("copied through its bits")
+    {
+        BloomFilter copy(bloom.getBits());
+        for (size_t i = 0; i < nKeys; ++i)
+        {
+            REQUIRE(copy.mayContain(BloomFilter::hash("key" +
+                                                      std::to_string(i))));
+        }
+    }
+
+    SECTION("empty")
+    {
+        bloom.clear();
+        REQUIRE(bloom.empty());
+        REQUIRE(!bloom.mayContain(BloomFilter::hash("key0")));
+        BloomFilter small(1);
+        REQUIRE(small.getBits().size() == 8);
+    }
+}
@@ -0,0 +1,189 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/Gzip.h"
+#include "crypto/ByteSlice.h"
+#include "crypto/SHA.h"
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
+
+namespace stellar
+{
+namespace gz
+{
+
+namespace
+{
+
+size_t const kChunkSize = 256 * 1024;
+
+// windowBits for zlib's gzip wrapper (and, when inflating, automatic
+// detection of gzip or zlib headers).
+int const kGzipWindowBits = 15 + 16;
+int const kAutoWindowBits = 15 + 32;
+
+void
+fail(std::string const& what, std::string const& file,
+     std::string const& out)
+{
+    std::remove(out.c_str());
+    throw std::runtime_error(what + ": " + file);
+}
+}
+
+void
+compressFile(std::string const& in, std::string const& out)
+{
+    std::ifstream ifs(in, std::ifstream::binary);
+    if (!ifs)
+    {
+        throw std::runtime_error("failed to open file: " + in);
+    }
+    std::ofstream ofs(out, std::ofstream::binary | std::ofstream::trunc);
+    if (!ofs)
+    {
+        throw std::runtime_error("failed to open file: " + out);
+    }
+
+    z_stream zs{};
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, kGzipWindowBits,
+                     8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        fail("failed to initialize compression", in, out);
+    }
+
+    std::vector<char> inBuf(kChunkSize);
+    std::vector<char> outBuf(kChunkSize);
+    int flush = Z_NO_FLUSH;
+    int res = Z_OK;
+    do
+    {
+        ifs.read(inBuf.data(), inBuf.size());
+        if (ifs.bad())
+        {
+            deflateEnd(&zs);
+            fail("failed reading", in, out);
+        }
+        zs.next_in = reinterpret_cast<Bytef*>(inBuf.data());
+        zs.avail_in = static_cast<uInt>(ifs.gcount());
+        flush = ifs.eof() ? Z_FINISH : Z_NO_FLUSH;
+        do
+        {
+            zs.next_out = reinterpret_cast<Bytef*>(outBuf.data());
+            zs.avail_out = static_cast<uInt>(outBuf.size());
+            res = deflate(&zs, flush);
+            // Z_BUF_ERROR only means no progress was possible, which is
+            // expected once the output buffer has been drained exactly; but
+            // with Z_FINISH there is always something left to do.
+            if (res == Z_STREAM_ERROR ||
+                (res == Z_BUF_ERROR && flush == Z_FINISH))
+            {
+                deflateEnd(&zs);
+                fail("failed compressing", in, out);
+            }
+            ofs.write(outBuf.data(), outBuf.size() - zs.avail_out);
+        } while (zs.avail_out == 0);
+    } while (flush != Z_FINISH);
+    deflateEnd(&zs);
+
+    // Anything else would leave a gzip file without its trailer.
+    if (res != Z_STREAM_END)
+    {
+        fail("failed compressing", in, out);
+    }
+
+    ofs.close();
+    if (!ofs)
+    {
+        fail("failed writing", out, out);
+    }
+}
+
+void
+decompressFile(std::string const& in, std::string const& out, SHA256* hasher)
+{
+    std::ifstream ifs(in, std::ifstream::binary);
+    if (!ifs)
+    {
+        throw std::runtime_error("failed to open file: " + in);
+    }
+    std::ofstream ofs(out, std::ofstream::binary | std::ofstream::trunc);
+    if (!ofs)
+    {
+        throw std::runtime_error("failed to open file: " + out);
+    }
+
+    z_stream zs{};
+    if (inflateInit2(&zs, kAutoWindowBits) != Z_OK)
+    {
+        fail("failed to initialize decompression", in, out);
+    }
+
+    std::vector<char> inBuf(kChunkSize);
+    std::vector<char> outBuf(kChunkSize);
+    int res = Z_OK;
+    bool outputFull = false;
+    while (true)
+    {
+        // Only go back for input once inflate has drained what it has.
+        if (zs.avail_in == 0 && !outputFull)
+        {
+            ifs.read(inBuf.data(), inBuf.size());
+            if (ifs.bad())
+            {
+                inflateEnd(&zs);
+                fail("failed reading", in, out);
+            }
+            zs.next_in = reinterpret_cast<Bytef*>(inBuf.data());
+            zs.avail_in = static_cast<uInt>(ifs.gcount());
+            if (zs.avail_in == 0)
+            {
+                break;
+            }
+        }
+
+        zs.next_out = reinterpret_cast<Bytef*>(outBuf.data());
+        zs.avail_out = static_cast<uInt>(outBuf.size());
+        res = inflate(&zs, Z_NO_FLUSH);
+        if (res != Z_OK && res != Z_STREAM_END && res != Z_BUF_ERROR)
+        {
+            inflateEnd(&zs);
+            fail("corrupt gzip file", in, out);
+        }
+
+        outputFull = (zs.avail_out == 0);
+        size_t have = outBuf.size() - zs.avail_out;
+        ofs.write(outBuf.data(), have);
+        if (hasher)
+        {
+            hasher->add(ByteSlice(outBuf.data(), have));
+        }
+
+        if (res == Z_STREAM_END)
+        {
+            // gzip allows several members to be concatenated; carry on with
+            // the next one, if there is one.
+            inflateReset(&zs);
+        }
+    }
+    inflateEnd(&zs);
+
+    // A truncated file ends mid-stream.
+    if (res != Z_STREAM_END)
+    {
+        fail("truncated gzip file", in, out);
+    }
+
+    ofs.close();
+    if (!ofs)
+    {
+        fail("failed writing", out, out);
+    }
+}
+}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include <string>
+
+namespace stellar
+{
+
+class SHA256;
+
+namespace gz
+{
+
+////
+// In-process streaming gzip (de)compression of files, producing and accepting
+// the same format as the gzip tool. Both throw std::runtime_error on failure,
+// leaving no partial output file behind.
+////
+
+// Compress `in` into the gzip file `out`.
+void compressFile(std::string const& in, std::string const& out);
+
+// Decompress the gzip file `in` into `out`. If `hasher` is given, every
+// decompressed byte is also fed to it, so the output can be verified without
+// reading it back.
+void decompressFile(std::string const& in, std::string const& out,
+                    SHA256* hasher = nullptr);
+}
+}
@@ -0,0 +1,144 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/MappedFile.h"
+#include "util/Logging.h"
+
+#include <cerrno>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace stellar
+{
+
+static void
+failToMap(std::string const& filename, int reason)
+{
+    std::string msg("failed to map file: ");
+    msg += filename;
+    msg += ", reason: ";
+    msg += std::to_string(reason);
+    CLOG(ERROR, "Fs") << msg;
+    throw std::runtime_error(msg);
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+void
+MappedFile::open(std::string const& filename)
+{
+    close();
+    HANDLE f = ::CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                            nullptr);
+    if (f == INVALID_HANDLE_VALUE)
+    {
+        failToMap(filename, static_cast<int>(::GetLastError()));
+    }
+    LARGE_INTEGER size;
+    if (!::GetFileSizeEx(f, &size))
+    {
+        auto err = ::GetLastError();
+        ::CloseHandle(f);
+        failToMap(filename, static_cast<int>(err));
+    }
+    if (size.QuadPart != 0)
+    {
+        HANDLE m = ::CreateFileMapping(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void* p = m ? ::MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        auto err = ::GetLastError();
+        if (m)
+        {
+            ::CloseHandle(m);
+        }
+        if (!p)
+        {
+            ::CloseHandle(f);
+            failToMap(filename, static_cast<int>(err));
+        }
+        mData = static_cast<char const*>(p);
+        mSize = static_cast<size_t>(size.QuadPart);
+    }
+    ::CloseHandle(f);
+    mOpen = true;
+}
+
+void
+MappedFile::close()
+{
+    if (mData)
+    {
+        ::UnmapViewOfFile(mData);
+    }
+    mData = nullptr;
+    mSize = 0;
+    mOpen = false;
+}
+
+#else
+
+void
+MappedFile::open(std::string const& filename)
+{
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        failToMap(filename, errno);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        int err = errno;
+        ::close(fd);
+        failToMap(filename, err);
+    }
+    if (st.st_size != 0)
+    {
+        void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                         MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            int err = errno;
+            ::close(fd);
+            failToMap(filename, err);
+        }
+        // only a hint; nothing to do if it isn't taken
+        ::madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        mData = static_cast<char const*>(p);
+        mSize = static_cast<size_t>(st.st_size);
+    }
+    // the mapping keeps the file referenced
+    ::close(fd);
+    mOpen = true;
+}
+
+void
+MappedFile::close()
+{
+    if (mData)
+    {
+        ::munmap(const_cast<char*>(mData), mSize);
+    }
+    mData = nullptr;
+    mSize = 0;
+    mOpen = false;
+}
+
+#endif
+}
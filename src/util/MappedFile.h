@@ -0,0 +1,48 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+#include <cstddef>
+#include <string>
+
+namespace stellar
+{
+
+/**
+ * A read-only memory mapping of a whole file. The mapping is advised for
+ * sequential access, so the kernel reads ahead aggressively and drops pages
+ * behind the reader. An empty file maps to no memory at all.
+ */
+class MappedFile : NonMovableOrCopyable
+{
+    char const* mData{nullptr};
+    size_t mSize{0};
+    bool mOpen{false};
+
+  public:
+    ~MappedFile();
+
+    // Throws std::runtime_error if the file can't be opened or mapped.
+    void open(std::string const& filename);
+    void close();
+
+    bool
+    isOpen() const
+    {
+        return mOpen;
+    }
+    char const*
+    data() const
+    {
+        return mData;
+    }
+    size_t
+    size() const
+    {
+        return mSize;
+    }
+};
+}
@@ -6,11 +6,15 @@
 
 #include <string>
 #include <fstream>
+#include <map>
+#include <memory>
 #include <vector>
 #include "xdrpp/marshal.h"
 #include "crypto/SHA.h"
 #include "crypto/ByteSlice.h"
 #include "util/Logging.h"
+#include "util/MappedFile.h"
+#include "util/make_unique.h"
 
 namespace stellar
 {
@@ -51,6 +55,20 @@ class XDRInputFileStream
         return mIn.good();
     }
 
+    // Offset of the next record to be read.
+    size_t
+    pos()
+    {
+        return static_cast<size_t>(mIn.tellg());
+    }
+
+    // Positions the stream at `offset`, which must be the start of a record.
+    void
+    seek(size_t offset)
+    {
+        mIn.seekg(offset);
+    }
+
     template <typename T>
     bool
     readOne(T& out)
@@ -84,6 +102,194 @@ class XDRInputFileStream
         xdr::xdr_argpack_archive(g, out);
         return true;
     }
+
+    // As readOne, but also leaves the complete record, size header included,
+    // in `record`, exactly as XDROutputFileStream::writeOne would produce it
+    // for `out`. The record can then be passed to writeRecord to copy the
+    // object to another stream without re-encoding it.
+    template <typename T>
+    bool
+    readOne(T& out, std::vector<char>& record)
+    {
+        if (record.size() < 4)
+        {
+            record.resize(4);
+        }
+        if (!mIn.read(record.data(), 4))
+        {
+            return false;
+        }
+
+        uint32_t sz = 0;
+        sz |= static_cast<uint8_t>(record[0] & '\x7f');
+        sz <<= 8;
+        sz |= static_cast<uint8_t>(record[1]);
+        sz <<= 8;
+        sz |= static_cast<uint8_t>(record[2]);
+        sz <<= 8;
+        sz |= static_cast<uint8_t>(record[3]);
+        record[0] |= '\x80';
+
+        record.resize(sz + 4);
+        if (!mIn.read(record.data() + 4, sz))
+        {
+            throw xdr::xdr_runtime_error("malformed XDR file");
+        }
+        xdr::xdr_get g(record.data() + 4, record.data() + 4 + sz);
+        xdr::xdr_argpack_archive(g, out);
+        return true;
+    }
+};
+
+/**
+ * A complete record, size header included, in the form
+ * XDROutputFileStream::writeOne produces, viewed where it lies in memory.
+ */
+struct XDRRecordView
+{
+    char const* data{nullptr};
+    size_t size{0};
+};
+
+/**
+ * Reads the same files as XDRInputFileStream, through the same interface, but
+ * from a memory mapping of the whole file: records are decoded in place, and
+ * can be handed on as views into the mapping -- valid until the stream is
+ * closed -- instead of being copied out. Meant for long sequential passes
+ * over large files, such as merging or applying buckets. The rare record
+ * written without its continuation bit is viewed in a marked copy instead,
+ * which lives as long.
+ */
+class XDRMappedInputFileStream
+{
+    std::unique_ptr<MappedFile> mFile;
+    size_t mPos{0};
+    bool mGood{false};
+    // marked copies of the records written without the continuation bit, by
+    // offset; kept until the stream is closed, as views into them may be
+    std::map<size_t, std::vector<char>> mFixups;
+
+    // Finds the record at mPos and moves past it; false at the end of the
+    // file.
+    bool
+    nextRecord(XDRRecordView& record)
+    {
+        if (!mGood || mFile->size() < mPos + 4)
+        {
+            mGood = false;
+            return false;
+        }
+
+        auto p = reinterpret_cast<unsigned char const*>(mFile->data() + mPos);
+        uint32_t sz = 0;
+        sz |= static_cast<uint8_t>(p[0] & 0x7f);
+        sz <<= 8;
+        sz |= p[1];
+        sz <<= 8;
+        sz |= p[2];
+        sz <<= 8;
+        sz |= p[3];
+
+        if (mFile->size() - mPos - 4 < sz)
+        {
+            mGood = false;
+            throw xdr::xdr_runtime_error("malformed XDR file");
+        }
+        record.data = mFile->data() + mPos;
+        record.size = sz + 4;
+
+        if ((p[0] & 0x80) == 0)
+        {
+            // not as writeOne would have written it; copy and mark it
+            auto& fixup = mFixups[mPos];
+            if (fixup.empty())
+            {
+                fixup.assign(record.data, record.data + record.size);
+                fixup[0] |= '\x80';
+            }
+            record.data = fixup.data();
+        }
+        mPos += sz + 4;
+        return true;
+    }
+
+  public:
+    void
+    close()
+    {
+        mFile.reset();
+        mFixups.clear();
+        mGood = false;
+    }
+
+    void
+    open(std::string const& filename)
+    {
+        auto file = make_unique<MappedFile>();
+        file->open(filename);
+        mFile = std::move(file);
+        mFixups.clear();
+        mPos = 0;
+        mGood = true;
+    }
+
+    operator bool() const
+    {
+        return mGood;
+    }
+
+    // Offset of the next record to be read.
+    size_t
+    pos()
+    {
+        return mPos;
+    }
+
+    // Positions the stream at `offset`, which must be the start of a record;
+    // this works even once the end of the file has been reached.
+    void
+    seek(size_t offset)
+    {
+        mPos = offset;
+        mGood = static_cast<bool>(mFile);
+    }
+
+    template <typename T>
+    bool
+    readOne(T& out)
+    {
+        XDRRecordView record;
+        return readOne(out, record);
+    }
+
+    // As readOne, but also leaves `record` viewing the complete record,
+    // exactly as XDROutputFileStream::writeOne would produce it for `out`.
+    template <typename T>
+    bool
+    readOne(T& out, XDRRecordView& record)
+    {
+        if (!nextRecord(record))
+        {
+            return false;
+        }
+        xdr::xdr_get g(record.data + 4, record.data + record.size);
+        xdr::xdr_argpack_archive(g, out);
+        return true;
+    }
+
+    // As XDRInputFileStream's, copying the record out.
+    template <typename T>
+    bool
+    readOne(T& out, std::vector<char>& record)
+    {
+        XDRRecordView view;
+        if (!readOne(out, view))
+        {
+            return false;
+        }
+        record.assign(view.data, view.data + view.size);
+        return true;
+    }
 };
 
 class XDROutputFileStream
@@ -118,39 +324,64 @@ class XDROutputFileStream
         return mOut.good();
     }
 
+    // Encodes t into `record` as a size-prefixed record, the form in which
+    // writeOne writes it to the stream.
     template <typename T>
-    bool
-    writeOne(T const& t, SHA256* hasher = nullptr, size_t* bytesPut = nullptr)
+    static void
+    encodeRecord(T const& t, std::vector<char>& record)
     {
         uint32_t sz = (uint32_t)xdr::xdr_size(t);
         assert(sz < 0x80000000);
 
-        if (mBuf.size() < sz + 4)
-        {
-            mBuf.resize(sz + 4);
-        }
+        record.resize(sz + 4);
 
         // Write 4 bytes of size, big-endian, with XDR 'continuation' bit set on
         // high bit of high byte.
-        mBuf[0] = static_cast<char>((sz >> 24) & 0xFF) | '\x80';
-        mBuf[1] = static_cast<char>((sz >> 16) & 0xFF);
-        mBuf[2] = static_cast<char>((sz >> 8) & 0xFF);
-        mBuf[3] = static_cast<char>(sz & 0xFF);
+        record[0] = static_cast<char>((sz >> 24) & 0xFF) | '\x80';
+        record[1] = static_cast<char>((sz >> 16) & 0xFF);
+        record[2] = static_cast<char>((sz >> 8) & 0xFF);
+        record[3] = static_cast<char>(sz & 0xFF);
 
-        xdr::xdr_put p(mBuf.data() + 4, mBuf.data() + 4 + sz);
+        xdr::xdr_put p(record.data() + 4, record.data() + 4 + sz);
         xdr_argpack_archive(p, t);
+    }
 
-        if (!mOut.write(mBuf.data(), sz + 4))
+    template <typename T>
+    bool
+    writeOne(T const& t, SHA256* hasher = nullptr, size_t* bytesPut = nullptr)
+    {
+        encodeRecord(t, mBuf);
+        return writeRecord(mBuf, hasher, bytesPut);
+    }
+
+    // Writes a record captured by an input stream's readOne as-is, hashing
+    // and counting it exactly as writeOne would for the decoded object.
+    bool
+    writeRecord(std::vector<char> const& record, SHA256* hasher = nullptr,
+                size_t* bytesPut = nullptr)
+    {
+        XDRRecordView view;
+        view.data = record.data();
+        view.size = record.size();
+        return writeRecord(view, hasher, bytesPut);
+    }
+
+    bool
+    writeRecord(XDRRecordView const& record, SHA256* hasher = nullptr,
+                size_t* bytesPut = nullptr)
+    {
+        assert(record.size >= 4);
+        if (!mOut.write(record.data, record.size))
         {
             return false;
         }
         if (hasher)
         {
-            hasher->add(ByteSlice(mBuf.data(), sz + 4));
+            hasher->add(ByteSlice(record.data, record.size));
         }
         if (bytesPut)
         {
-            *bytesPut += (sz + 4);
+            *bytesPut += record.size;
         }
         return true;
     }